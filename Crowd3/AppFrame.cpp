@@ -144,9 +144,10 @@ void AppFrame::help(wxMouseEvent &event) {
     myHelp->Show();
 }
 
-/** Find People command button. CMD down indicates a rescan request. */
+/** Find People command button. CMD down indicates a rescan request. SHIFT down
+ * asks which face detector to use. */
 void AppFrame::findPeople(wxMouseEvent &event) {
-    myPF->searchFolder(this, event.CmdDown());
+    myPF->searchFolder(this, event.CmdDown(), event.ShiftDown());
 }
 
 /** Make crowd photo command button.*/
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef BOUNDEDQUEUE_H
+#define	BOUNDEDQUEUE_H
+
+#include <wx/thread.h>
+#include <deque>
+
+/**
+ * A first-in first-out queue shared between threads. push() blocks while the
+ * queue is full so that a fast producer cannot run ahead of a slow consumer.
+ * After close(), push() fails and pop() returns the remaining items, then fails.<p>
+ * Usage:<p><code>
+ * BoundedQueue<Job*> q(4);<p>
+ * producer: if ( ! q.push(job)) delete job; ... q.close();<p>
+ * consumer: while (q.pop(job)) { ... }<p></code>
+ */
+template <class T>
+class BoundedQueue {
+public:
+    /**
+     * Create an empty queue.
+     * @param capacity The maximum number of items held.
+     */
+    BoundedQueue(size_t capacity) : myNotEmpty(myLock), myNotFull(myLock) {
+        myCapacity = capacity;
+        myClosed = false;
+    }
+    
+    /**
+     * Add an item, waiting while the queue is full.
+     * @param item The item.
+     * @return false if the queue is closed. The item was not added.
+     */
+    bool push(const T& item) {
+        wxMutexLocker lock(myLock);
+        while (myItems.size() >= myCapacity && ! myClosed) {
+            myNotFull.Wait();
+        }
+        return add(item);
+    }
+    
+    /**
+     * Add an item, waiting a limited time while the queue is full.
+     * @param item The item.
+     * @param milliseconds The longest time to wait.
+     * @return false if the queue is closed or still full. The item was not added.
+     */
+    bool push(const T& item, unsigned long milliseconds) {
+        wxMutexLocker lock(myLock);
+        if (myItems.size() >= myCapacity && ! myClosed) {
+            myNotFull.WaitTimeout(milliseconds);
+        }
+        if (myItems.size() >= myCapacity) {
+            return false;
+        }
+        return add(item);
+    }
+    
+    /**
+     * Remove the oldest item, waiting while the queue is empty and open.
+     * @param item Receives the item.
+     * @return false if the queue is closed and empty.
+     */
+    bool pop(T& item) {
+        wxMutexLocker lock(myLock);
+        while (myItems.empty() && ! myClosed) {
+            myNotEmpty.Wait();
+        }
+        return remove(item);
+    }
+    
+    /**
+     * Remove the oldest item, waiting a limited time while the queue is empty
+     * and open.
+     * @param item Receives the item.
+     * @param milliseconds The longest time to wait.
+     * @return false if the queue is still empty.
+     */
+    bool pop(T& item, unsigned long milliseconds) {
+        wxMutexLocker lock(myLock);
+        if (myItems.empty() && ! myClosed) {
+            myNotEmpty.WaitTimeout(milliseconds);
+        }
+        return remove(item);
+    }
+    
+    /**
+     * Remove the oldest item if there is one. Never waits.
+     * @param item Receives the item.
+     * @return false if the queue is empty.
+     */
+    bool tryPop(T& item) {
+        wxMutexLocker lock(myLock);
+        return remove(item);
+    }
+    
+    /** Refuse new items and wake all waiting threads. */
+    void close() {
+        wxMutexLocker lock(myLock);
+        myClosed = true;
+        myNotEmpty.Broadcast();
+        myNotFull.Broadcast();
+    }
+    
+    /** @return true if the queue is closed and empty. */
+    bool isFinished() {
+        wxMutexLocker lock(myLock);
+        return myClosed && myItems.empty();
+    }
+    
+private:
+    /** Add an item. Called with myLock held. */
+    bool add(const T& item) {
+        if (myClosed) {
+            return false;
+        }
+        myItems.push_back(item);
+        myNotEmpty.Signal();
+        return true;
+    }
+    
+    /** Remove the oldest item. Called with myLock held. */
+    bool remove(T& item) {
+        if (myItems.empty()) {
+            return false;
+        }
+        item = myItems.front();
+        myItems.pop_front();
+        myNotFull.Signal();
+        return true;
+    }
+    
+    /** Guards all members. */
+    wxMutex myLock;
+    
+    /** Signalled when an item is added or the queue is closed. */
+    wxCondition myNotEmpty;
+    
+    /** Signalled when an item is removed or the queue is closed. */
+    wxCondition myNotFull;
+    
+    /** The items, oldest first. */
+    std::deque<T> myItems;
+    
+    /** The maximum number of items held. */
+    size_t myCapacity;
+    
+    /** true after close(). */
+    bool myClosed;
+};
+
+#endif	/* BOUNDEDQUEUE_H */
@@ -0,0 +1,652 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "Compositor.h"
+
+/** Create a compositor with an empty canvas. */
+Compositor::Compositor() {
+    myWidth = 0;
+    myHeight = 0;
+    myClipped = false;
+}
+
+/** @return The canvas width. */
+wxInt32 Compositor::getWidth() {
+    return myWidth;
+}
+
+/** @return The canvas height. */
+wxInt32 Compositor::getHeight() {
+    return myHeight;
+}
+
+/** Mark every canvas pixel unpainted, before painting people front-to-back. */
+void Compositor::startCoverage() {
+    myCoverage.assign(myWidth * myHeight, 0);
+}
+
+/** Release the coverage buffer after painting front-to-back. */
+void Compositor::endCoverage() {
+    myCoverage.clear();
+}
+
+/**
+ * Test whether every canvas pixel under a placement is already painted.
+ * Pixels outside the canvas count as painted.
+ * @param at A person's placement on the canvas.
+ * @return true if the person would be completely hidden, else false.
+ */
+bool Compositor::isCovered(const Placement& at) {
+    wxInt32 x0 = max(0, at.left);
+    wxInt32 x1 = min(myWidth, at.left + at.width);
+    wxInt32 y0 = max(0, at.top);
+    wxInt32 y1 = min(myHeight, at.top + at.height);
+    for (wxInt32 cy = y0; cy < y1; cy++) {
+        const unsigned char *covered = &myCoverage[cy * myWidth];
+        for (wxInt32 cx = x0; cx < x1; cx++) {
+            if ( ! covered[cx]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Paint people only inside an area of the canvas until unclip().
+ * @param area The canvas area.
+ */
+void Compositor::clip(const wxRect& area) {
+    myClip = area;
+    myClipped = true;
+}
+
+/** Paint people anywhere on the canvas again. */
+void Compositor::unclip() {
+    myClipped = false;
+}
+
+/**
+ * Hand over the errors of the person image files that could not be read, and
+ * forget them.
+ * @param errors The error messages are appended to this.
+ */
+void Compositor::takeReadErrors(std::vector<string>& errors) {
+    errors.insert(errors.end(), myReadErrors.begin(), myReadErrors.end());
+    myReadErrors.clear();
+}
+
+/**
+ * Remember a person image file that could not be read, for takeReadErrors().
+ * @param path The file path.
+ */
+void Compositor::readFailed(const wxString& path) {
+    myReadErrors.push_back("An error occurred while trying to read " + Tools::wx2str(path));
+}
+
+/** @return The canvas area people are painted in: the clip() area, if any, on the canvas. */
+wxRect Compositor::paintArea() {
+    wxRect canvas(0, 0, myWidth, myHeight);
+    return myClipped ? canvas.Intersect(myClip) : canvas;
+}
+
+/**
+ * Create a compositor.
+ * @param name One of the COMPOSITOR_ constants.
+ * @return The compositor, or NULL if the name is unknown.
+ */
+Compositor* Compositor::create(wxString name) {
+    if (name.IsSameAs(COMPOSITOR_OPENCV)) {
+        return new MatCompositor();
+    }
+    if (name.IsSameAs(COMPOSITOR_WX)) {
+        return new WxCompositor();
+    }
+    return NULL;
+}
+
+/** @return The names of the compositors. */
+wxArrayString Compositor::available() {
+    wxArrayString names;
+    names.Add(COMPOSITOR_WX);
+    names.Add(COMPOSITOR_OPENCV);
+    return names;
+}
+
+/** Create a wxImage compositor. */
+WxCompositor::WxCompositor() {
+    clear(1, 1);
+}
+
+/** @return The compositor's name. */
+wxString WxCompositor::name() {
+    return COMPOSITOR_WX;
+}
+
+/** Start a new black canvas. See Compositor::clear(). */
+void WxCompositor::clear(wxInt32 width, wxInt32 height) {
+    setCrowd(SharedImage(width, height));
+}
+
+/** Start a new canvas from a background image. See Compositor::setBackground(). */
+void WxCompositor::setBackground(Mat& background, wxInt32 width, wxInt32 height,
+                                 wxInt32 radius) {
+    wxImage anImage;
+    Tools::Mat2WxImage(&background, anImage);
+    background.release();
+    if (anImage.GetWidth() != width || anImage.GetHeight() != height) {
+        anImage.Rescale(width, height, wxIMAGE_QUALITY_HIGH);
+    }
+    setCrowd(anImage.Blur(radius));
+}
+
+/** Remember the canvas. See Compositor::keepBackground(). */
+void WxCompositor::keepBackground() {
+    myBackground = myCrowd.Copy();
+}
+
+/** Restore the kept canvas. See Compositor::restoreBackground(). */
+void WxCompositor::restoreBackground() {
+    setCrowd(myBackground);
+}
+
+/** Restore an area of the kept canvas. See Compositor::restoreBackground(). */
+void WxCompositor::restoreBackground(const wxRect& area) {
+    myCrowd.Paste(myBackground.GetSubImage(area), area.x, area.y);
+}
+
+/** Remember an area of the people. See Compositor::keepPeople(). */
+void WxCompositor::keepPeople(const wxRect& area) {
+    if (myPeople.GetWidth() != myWidth || myPeople.GetHeight() != myHeight ||
+            area == wxRect(0, 0, myWidth, myHeight)) {
+        myPeople = myCrowd.Copy();
+    }
+    else {
+        myPeople.Paste(myCrowd.GetSubImage(area), area.x, area.y);
+    }
+}
+
+/** Start a copy of the canvas. See Compositor::reopen(). */
+void WxCompositor::reopen() {
+    setCrowd(myCrowd);
+}
+
+/**
+ * Paint a person. See Compositor::paintPerson(). The person is resampled
+ * while it is painted, so no scaled copy is made. People entirely outside
+ * the paint area are not read.
+ */
+bool WxCompositor::paintPerson(const wxString& path, const Placement& at,
+                               bool fromMip, bool uncovered) {
+    wxRect placed(at.left, at.top, at.width, at.height);
+    wxRect area = paintArea();
+    if (at.width <= 0 || at.height <= 0 || ! area.Intersects(placed)) {
+        return true; // Nothing to paint.
+    }
+    wxImage aPerson;
+    if ( ! sourcePerson(path, at, fromMip, aPerson)) {
+        return false;
+    }
+    myKernel.paint(ResampleKernel::view(aPerson), placed, ResampleKernel::view(myCrowd),
+                   area, uncovered ? &myCoverage[0] : NULL);
+    return true;
+}
+
+/** Scale a person. See Compositor::scalePerson(). */
+bool WxCompositor::scalePerson(const wxString& path, const Placement& at,
+                               bool fromMip, Mat& aPerson) {
+    aPerson.release();
+    if (at.width <= 0 || at.height <= 0) {
+        return true; // Nothing to scale.
+    }
+    wxImage anImage;
+    if ( ! loadPerson(path, at, fromMip, anImage)) {
+        return false;
+    }
+    Mat rgb(anImage.GetHeight(), anImage.GetWidth(), CV_8UC3, anImage.GetData());
+    if ( ! anImage.HasAlpha()) {
+        cvtColor(rgb, aPerson, CV_RGB2RGBA);
+        return true;
+    }
+    Mat alpha(anImage.GetHeight(), anImage.GetWidth(), CV_8UC1, anImage.GetAlpha());
+    aPerson.create(rgb.size(), CV_8UC4);
+    Mat planes[] = {rgb, alpha};
+    wxInt32 toRGBA[] = {0, 0, 1, 1, 2, 2, 3, 3};
+    mixChannels(planes, 2, &aPerson, 1, toRGBA, 4);
+    return true;
+}
+
+/** Copy an image onto a new canvas. See Compositor::setCanvas(). */
+void WxCompositor::setCanvas(const Mat& rgb) {
+    setCrowd(SharedImage(rgb.clone()));
+}
+
+/** Forget the people's mips. See Compositor::forgetPeople(). */
+void WxCompositor::forgetPeople() {
+    myMips.clear();
+}
+
+/** Blur a band of the canvas. See Compositor::blurBand(). */
+void WxCompositor::blurBand(wxInt32 top, wxInt32 rows, wxInt32 radius) {
+    wxImage aStrip = myCrowd.GetSubImage(wxRect(0, top, myWidth, rows));
+    if (radius > 0) {
+        aStrip = aStrip.Blur(radius);
+    }
+    myCrowd.Paste(aStrip, 0, top);
+}
+
+/**
+ * Blur a band of the kept people into an area. See Compositor::reblurBand().
+ * Only the pixels within the blur radius of the area are blurred. Both blur
+ * passes reach radius pixels, so those are all the area's pixels depend on.
+ */
+void WxCompositor::reblurBand(wxInt32 top, wxInt32 rows, wxInt32 radius,
+                              const wxRect& area) {
+    wxRect band = wxRect(0, top, myWidth, rows).Intersect(area);
+    if (band.IsEmpty()) {
+        return;
+    }
+    wxRect source = band;
+    source.Inflate(max(0, radius));
+    source = source.Intersect(wxRect(0, top, myWidth, rows));
+    wxImage aStrip = myPeople.GetSubImage(source);
+    if (radius > 0) {
+        aStrip = aStrip.Blur(radius);
+    }
+    myCrowd.Paste(aStrip.GetSubImage(wxRect(band.x - source.x, band.y - source.y,
+                                            band.width, band.height)),
+                  band.x, band.y);
+}
+
+/** @return The canvas, from its Mat. See Compositor::getImage(). */
+SharedImage WxCompositor::getImage() {
+    return myCanvas;
+}
+
+/** Get a small copy of the canvas. See Compositor::getPreview(). */
+wxImage WxCompositor::getPreview(wxInt32 width, wxInt32 height) {
+    return myCrowd.Scale(width, height);
+}
+
+/**
+ * Start a new canvas with a copy of an image's pixels.
+ * @param anImage The image.
+ */
+void WxCompositor::setCrowd(const wxImage& anImage) {
+    Mat rgb(anImage.GetHeight(), anImage.GetWidth(), CV_8UC3, anImage.GetData());
+    setCrowd(SharedImage(rgb.clone()));
+}
+
+/**
+ * Start a new canvas in a buffer owned by a Mat. myCrowd sees the buffer as
+ * static data, so wx neither frees it nor counts references to it in a
+ * wxImage shared with other threads.
+ * @param pixels The canvas pixels, not shared with any other owner.
+ */
+void WxCompositor::setCrowd(const SharedImage& pixels) {
+    myCanvas = pixels;
+    myCrowd = myCanvas.wx();
+    myWidth = myCanvas.getWidth();
+    myHeight = myCanvas.getHeight();
+}
+
+/**
+ * Get the image a person is scaled from, with its invisible pixels marked:
+ * in drafts, the person's small mip image when it is large enough, else the
+ * person image file.
+ * @param path The person image file path.
+ * @param at The person's placement on the canvas.
+ * @param fromMip true to use the person's mip when it is large enough.
+ * @param aPerson The returned person image. Shares the mip's pixels.
+ * @return true if the image was read, else false.
+ */
+bool WxCompositor::sourcePerson(const wxString& path, const Placement& at,
+                                bool fromMip, wxImage& aPerson) {
+    if (fromMip) {
+        std::map<wxString, wxImage>::iterator mip = myMips.find(path);
+        if (mip == myMips.end()) {
+            // First use of this person in a draft. Make its mip.
+            wxImage aMip;
+            if ( ! readPerson(path, aMip)) {
+                return false;
+            }
+            while (aMip.GetWidth() / 2 >= MIPWIDTH && aMip.GetHeight() / 2 > 0) {
+                aMip.Rescale(aMip.GetWidth() / 2, aMip.GetHeight() / 2, 
+                             wxIMAGE_QUALITY_HIGH);
+            }
+            mip = myMips.insert(std::make_pair(path, aMip)).first;
+        }
+        if (mip->second.GetWidth() >= at.width) {
+            aPerson = mip->second;
+            return true;
+        }
+    }
+    return readPerson(path, aPerson);
+}
+
+/**
+ * Get a person image with its invisible pixels marked, scaled to the size
+ * given by its placement. See sourcePerson().
+ * @param path The person image file path.
+ * @param at The person's placement on the canvas.
+ * @param fromMip true to scale from the person's mip when it is large enough.
+ * @param aPerson The returned person image.
+ * @return true if the image was read, else false.
+ */
+bool WxCompositor::loadPerson(const wxString& path, const Placement& at,
+                              bool fromMip, wxImage& aPerson) {
+    if ( ! sourcePerson(path, at, fromMip, aPerson)) {
+        return false;
+    }
+    
+    // Scale the person image to its placement size. Apply perspective.
+    aPerson = aPerson.Scale(at.width, at.height, wxIMAGE_QUALITY_HIGH);
+    return true;
+}
+
+/**
+ * Read a person image file and mark its invisible pixels.
+ * @param path The person image file path.
+ * @param aPerson The returned person image.
+ * @return true if the image was read, else false.
+ */
+bool WxCompositor::readPerson(const wxString& path, wxImage& aPerson) {
+    // LoadFile() logs a missing file itself, so look for it first.
+    if ( ! wxFileExists(path) || ! aPerson.LoadFile(path, wxBITMAP_TYPE_PNG)) {
+        readFailed(path);
+        return false;
+    }
+  
+    // Mark the invisible pixels using the color mask and the alpha channel.
+    aPerson.SetMaskColour(
+        WX_COLOR_TRANSPARENT[0], 
+        WX_COLOR_TRANSPARENT[1], 
+        WX_COLOR_TRANSPARENT[2]);
+    aPerson.InitAlpha();
+    return true;
+}
+
+/** Create an OpenCV compositor. */
+MatCompositor::MatCompositor() {
+    clear(1, 1);
+}
+
+/** @return The compositor's name. */
+wxString MatCompositor::name() {
+    return COMPOSITOR_OPENCV;
+}
+
+/** Start a new black canvas. See Compositor::clear(). */
+void MatCompositor::clear(wxInt32 width, wxInt32 height) {
+    myCrowd = Mat::zeros(height, width, CV_8UC3);
+    myWidth = width;
+    myHeight = height;
+}
+
+/** Start a new canvas from a background image. See Compositor::setBackground(). */
+void MatCompositor::setBackground(Mat& background, wxInt32 width, wxInt32 height,
+                                  wxInt32 radius) {
+    Mat rgb;
+    cvtColor(background, rgb, CV_BGR2RGB);
+    background.release();
+    // Never paint into a canvas handed out by getImage().
+    myCrowd.release();
+    scale(rgb, myCrowd, Size(width, height));
+    blur(myCrowd, radius);
+    myWidth = width;
+    myHeight = height;
+}
+
+/** Remember the canvas. See Compositor::keepBackground(). */
+void MatCompositor::keepBackground() {
+    myBackground = myCrowd.clone();
+}
+
+/** Restore the kept canvas. See Compositor::restoreBackground(). */
+void MatCompositor::restoreBackground() {
+    myCrowd = myBackground.clone();
+    myWidth = myCrowd.cols;
+    myHeight = myCrowd.rows;
+}
+
+/** Restore an area of the kept canvas. See Compositor::restoreBackground(). */
+void MatCompositor::restoreBackground(const wxRect& area) {
+    Rect r(area.x, area.y, area.width, area.height);
+    Mat target = myCrowd(r);
+    myBackground(r).copyTo(target);
+}
+
+/** Remember an area of the people. See Compositor::keepPeople(). */
+void MatCompositor::keepPeople(const wxRect& area) {
+    if (myPeople.size() != myCrowd.size() || area == wxRect(0, 0, myWidth, myHeight)) {
+        myPeople = myCrowd.clone();
+    }
+    else {
+        Rect r(area.x, area.y, area.width, area.height);
+        Mat target = myPeople(r);
+        myCrowd(r).copyTo(target);
+    }
+}
+
+/** Start a copy of the canvas. See Compositor::reopen(). */
+void MatCompositor::reopen() {
+    myCrowd = myCrowd.clone();
+}
+
+/**
+ * Paint a person. See Compositor::paintPerson(). The person is resampled
+ * while it is painted, so no scaled copy is made. People entirely outside
+ * the paint area are not read.
+ */
+bool MatCompositor::paintPerson(const wxString& path, const Placement& at,
+                                bool fromMip, bool uncovered) {
+    wxRect placed(at.left, at.top, at.width, at.height);
+    wxRect area = paintArea();
+    if (at.width <= 0 || at.height <= 0 || ! area.Intersects(placed)) {
+        return true; // Nothing to paint.
+    }
+    Mat aPerson;
+    if ( ! sourcePerson(path, at, fromMip, aPerson)) {
+        return false;
+    }
+    myKernel.paint(ResampleKernel::view(aPerson), placed, ResampleKernel::view(myCrowd),
+                   area, uncovered ? &myCoverage[0] : NULL);
+    return true;
+}
+
+/** Scale a person. See Compositor::scalePerson(). */
+bool MatCompositor::scalePerson(const wxString& path, const Placement& at,
+                                bool fromMip, Mat& aPerson) {
+    aPerson.release();
+    if (at.width <= 0 || at.height <= 0) {
+        return true; // Nothing to scale.
+    }
+    Mat source;
+    if ( ! sourcePerson(path, at, fromMip, source)) {
+        return false;
+    }
+    scale(source, aPerson, Size(at.width, at.height));
+    return true;
+}
+
+/**
+ * Get the image a person is scaled from: in drafts, the person's small mip
+ * image when it is large enough, else the person image file.
+ * @param path The person image file path.
+ * @param at The person's placement on the canvas.
+ * @param fromMip true to use the person's mip when it is large enough.
+ * @param aPerson The returned person image, 8-bit RGBA with invisible pixels
+ * transparent. Shares the mip's pixels.
+ * @return true if the image was read, else false.
+ */
+bool MatCompositor::sourcePerson(const wxString& path, const Placement& at,
+                                 bool fromMip, Mat& aPerson) {
+    if (fromMip) {
+        std::map<wxString, Mat>::iterator mip = myMips.find(path);
+        if (mip == myMips.end()) {
+            // First use of this person in a draft. Make its mip.
+            Mat aMip;
+            if ( ! readPerson(path, aMip)) {
+                return false;
+            }
+            while (aMip.cols / 2 >= MIPWIDTH && aMip.rows / 2 > 0) {
+                resize(aMip, aMip, Size(aMip.cols / 2, aMip.rows / 2), 0, 0, INTER_AREA);
+            }
+            mip = myMips.insert(std::make_pair(path, aMip)).first;
+        }
+        if (mip->second.cols >= at.width) {
+            aPerson = mip->second;
+            return true;
+        }
+    }
+    return readPerson(path, aPerson);
+}
+
+/** Share an image as the new canvas. See Compositor::setCanvas(). */
+void MatCompositor::setCanvas(const Mat& rgb) {
+    myCrowd = rgb;
+    myWidth = rgb.cols;
+    myHeight = rgb.rows;
+}
+
+/** Forget the people's mips. See Compositor::forgetPeople(). */
+void MatCompositor::forgetPeople() {
+    myMips.clear();
+}
+
+/** Blur a band of the canvas. See Compositor::blurBand(). */
+void MatCompositor::blurBand(wxInt32 top, wxInt32 rows, wxInt32 radius) {
+    Mat band = myCrowd.rowRange(top, top + rows);
+    blur(band, radius);
+}
+
+/**
+ * Blur a band of the kept people into an area. See Compositor::reblurBand().
+ * Only the pixels within the Gaussian kernel's reach of the area are blurred.
+ */
+void MatCompositor::reblurBand(wxInt32 top, wxInt32 rows, wxInt32 radius,
+                               const wxRect& area) {
+    Rect whole(0, top, myWidth, rows);
+    Rect band = whole & Rect(area.x, area.y, area.width, area.height);
+    if (band.area() == 0) {
+        return;
+    }
+    // GaussianBlur's 8-bit kernel reaches 3 sigma, rounded.
+    wxInt32 reach = radius > 0 ? (wxInt32) ceil(3 * blurSigma(radius)) + 1 : 0;
+    Rect source = Rect(band.x - reach, band.y - reach,
+                       band.width + 2 * reach, band.height + 2 * reach) & whole;
+    Mat blurred = myPeople(source).clone();
+    blur(blurred, radius);
+    Mat target = myCrowd(band);
+    blurred(Rect(band.x - source.x, band.y - source.y,
+                 band.width, band.height)).copyTo(target);
+}
+
+/** @return The canvas. See Compositor::getImage(). */
+SharedImage MatCompositor::getImage() {
+    return SharedImage(myCrowd);
+}
+
+/**
+ * Get a small copy of the canvas. See Compositor::getPreview(). The canvas is
+ * scaled straight into the copy's pixels.
+ */
+wxImage MatCompositor::getPreview(wxInt32 width, wxInt32 height) {
+    wxImage small(width, height, false);
+    Mat view(height, width, CV_8UC3, small.GetData());
+    resize(myCrowd, view, view.size(), 0, 0, INTER_AREA);
+    return small;
+}
+
+/**
+ * Read a person image file and make its invisible pixels transparent.
+ * @param path The person image file path.
+ * @param aPerson The returned person image, 8-bit RGBA.
+ * @return true if the image was read, else false.
+ */
+bool MatCompositor::readPerson(const wxString& path, Mat& aPerson) {
+    Mat bgr = imread(Tools::wx2str(path), CV_LOAD_IMAGE_COLOR);
+    if (bgr.empty()) {
+        readFailed(path);
+        return false;
+    }
+    
+    // Zero alpha for the transparent colour, as wxImage::InitAlpha() gives a
+    // mask colour.
+    Scalar transparent = Scalar(CV_COLOR_TRANSPARENT[0], CV_COLOR_TRANSPARENT[1],
+                                CV_COLOR_TRANSPARENT[2]);
+    Mat invisible;
+    inRange(bgr, transparent, transparent, invisible);
+    Mat alpha = ~invisible;
+    cvtColor(bgr, aPerson, CV_BGR2RGBA);
+    wxInt32 toAlpha[] = {0, 3};
+    mixChannels(&alpha, 1, &aPerson, 1, toAlpha, 1);
+    return true;
+}
+
+/**
+ * Scale an image the way wxIMAGE_QUALITY_HIGH does: averaging when shrinking,
+ * bicubic when enlarging.
+ * @param source The image.
+ * @param scaled The returned image. Shares source's pixels if the size is unchanged.
+ * @param size The new size.
+ */
+void MatCompositor::scale(const Mat& source, Mat& scaled, Size size) {
+    if (source.size() == size) {
+        scaled = source;
+        return;
+    }
+    bool shrink = size.width <= source.cols && size.height <= source.rows;
+    resize(source, scaled, size, 0, 0, shrink ? INTER_AREA : INTER_CUBIC);
+}
+
+/**
+ * Blur an image, or a region of one without using the pixels around it. The
+ * Gaussian has the variance of wxImage::Blur()'s box of the same radius, so
+ * both compositors blur about as much.
+ * @param region The image or region.
+ * @param radius The blur radius.
+ */
+void MatCompositor::blur(Mat& region, wxInt32 radius) {
+    if (radius <= 0 || region.empty()) {
+        return;
+    }
+    double sigma = blurSigma(radius);
+    GaussianBlur(region, region, Size(0, 0), sigma, sigma,
+                 BORDER_REPLICATE | BORDER_ISOLATED);
+}
+
+/**
+ * The Gaussian standard deviation matching wxImage::Blur()'s box.
+ * @param radius The blur radius.
+ * @return The deviation.
+ */
+double MatCompositor::blurSigma(wxInt32 radius) {
+    return sqrt(radius * (radius + 1) / 3.0);
+}
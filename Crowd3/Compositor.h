@@ -0,0 +1,356 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef COMPOSITOR_H
+#define	COMPOSITOR_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <wx/wx.h>
+#include "const.h"
+#include "Tools.h"
+#include "SharedImage.h"
+#include "ResampleKernel.h"
+#include <vector>
+#include <map>
+
+/** The compositor painting into a wxImage with wxImage accessors. */
+const wxString COMPOSITOR_WX = _T("wx");
+
+/** The compositor painting into a Mat with OpenCV's vectorized functions. */
+const wxString COMPOSITOR_OPENCV = _T("OpenCV");
+
+/** Draft person mips are halved until they are less than twice this width. */
+const wxInt32 MIPWIDTH = 48;
+
+/** The position and size of one person image in the crowd image. */
+struct Placement {
+    /** The person image file name, relative to the Crowd3 folder. */
+    wxString file;
+
+    /** The crowd row of the person. Row 0 is the front row. */
+    wxInt32 row;
+
+    /** The crowd image column where the scaled person image starts. */
+    wxInt32 left;
+
+    /** The crowd image row where the scaled person image starts. */
+    wxInt32 top;
+
+    /** Width of the scaled person image. */
+    wxInt32 width;
+
+    /** Height of the scaled person image. */
+    wxInt32 height;
+};
+
+/**
+ * Paint the pixels of a crowd image: the background, the people and the depth
+ * blur. The CrowdMaker decides what goes where; a compositor only paints. One
+ * subclass per pixel backend. A compositor is used by one thread at a time.
+ * It may run on a worker thread, so it never logs: person images it cannot
+ * read are kept for takeReadErrors().<p>
+ * Usage:<p><code>
+ * Compositor *c = Compositor::create(COMPOSITOR_OPENCV);<p>
+ * c->setBackground(decoded, width, height, 5); or c->clear(width, height);<p>
+ * c->paintPerson(path, placement, false, false);<p>
+ * c->blurBand(top, rows, radius);<p>
+ * SharedImage crowd = c->getImage();<p>
+ * delete c;<p></code>
+ */
+class Compositor {
+public:
+    Compositor();
+    virtual ~Compositor() {}
+    
+    /** @return The compositor's name, one of the COMPOSITOR_ constants. */
+    virtual wxString name() = 0;
+    
+    /**
+     * Start a new black canvas.
+     * @param width The canvas width.
+     * @param height The canvas height.
+     */
+    virtual void clear(wxInt32 width, wxInt32 height) = 0;
+    
+    /**
+     * Start a new canvas from a background image, scaled and then blurred.
+     * @param background The decoded background, 8-bit BGR. May be released.
+     * @param width The canvas width.
+     * @param height The canvas height.
+     * @param radius The blur radius, in canvas pixels.
+     */
+    virtual void setBackground(Mat& background, wxInt32 width, wxInt32 height,
+                               wxInt32 radius) = 0;
+    
+    /** Remember the canvas as it is now, to be restored for the next draft. */
+    virtual void keepBackground() = 0;
+    
+    /** Start a new canvas from the one kept by keepBackground(). */
+    virtual void restoreBackground() = 0;
+    
+    /**
+     * Put back an area of the background kept by keepBackground().
+     * @param area The canvas area.
+     */
+    virtual void restoreBackground(const wxRect& area) = 0;
+    
+    /**
+     * Remember an area of the canvas as painted with people, before the
+     * depth blur, for reblurBand().
+     * @param area The canvas area. The whole canvas the first time.
+     */
+    virtual void keepPeople(const wxRect& area) = 0;
+    
+    /**
+     * Start a new canvas as a copy of the current one, to be revised. Images
+     * from getImage() are not changed.
+     */
+    virtual void reopen() = 0;
+    
+    /**
+     * Read a person image file, scale it to its placement and paint its
+     * visible pixels. Only pixels inside the clip() area are painted.
+     * @param path The person image file path.
+     * @param at The person's placement on the canvas. May extend past the edges.
+     * @param fromMip true to scale from a small copy of the person when it is
+     * large enough, as drafts do.
+     * @param uncovered true to paint only pixels no nearer person has painted,
+     * and mark them painted. See startCoverage().
+     * @return false if the person image could not be read.
+     */
+    virtual bool paintPerson(const wxString& path, const Placement& at,
+                             bool fromMip, bool uncovered) = 0;
+    
+    /**
+     * Read a person image file and scale it to its placement, without
+     * painting it.
+     * @param path The person image file path.
+     * @param at The person's placement on the canvas.
+     * @param fromMip true to scale from a small copy of the person when it is
+     * large enough, as drafts do.
+     * @param aPerson The returned person image, 8-bit RGBA with straight
+     * alpha. Empty if the placement has no pixels.
+     * @return false if the person image could not be read.
+     */
+    virtual bool scalePerson(const wxString& path, const Placement& at,
+                             bool fromMip, Mat& aPerson) = 0;
+    
+    /**
+     * Start a new canvas holding an image painted elsewhere.
+     * @param rgb The image, 8-bit RGB. Its pixels may be shared, so it must
+     * not be changed after getImage() hands the canvas out.
+     */
+    virtual void setCanvas(const Mat& rgb) = 0;
+    
+    /** Forget the small copies of people made for drafts. */
+    virtual void forgetPeople() = 0;
+    
+    /**
+     * Blur a horizontal band of the canvas. Pixels outside the band are not
+     * used.
+     * @param top The band's first row.
+     * @param rows The band's height.
+     * @param radius The blur radius, in canvas pixels.
+     */
+    virtual void blurBand(wxInt32 top, wxInt32 rows, wxInt32 radius) = 0;
+    
+    /**
+     * Blur a horizontal band of the people kept by keepPeople() and put an
+     * area of it on the canvas. The area's pixels come out as blurBand() would
+     * paint them.
+     * @param top The band's first row.
+     * @param rows The band's height.
+     * @param radius The blur radius, in canvas pixels.
+     * @param area The canvas area to put. Parts outside the band are ignored.
+     */
+    virtual void reblurBand(wxInt32 top, wxInt32 rows, wxInt32 radius,
+                            const wxRect& area) = 0;
+    
+    /**
+     * @return The canvas itself, not a copy. Every render starts a new canvas,
+     * so the pixels returned are not changed by later renders. The pixels
+     * are owned by a Mat, never by a wxImage, so the image may be kept and
+     * dropped on another thread than the compositor's.
+     */
+    virtual SharedImage getImage() = 0;
+    
+    /**
+     * Get a small copy of the canvas.
+     * @param width The copy's width.
+     * @param height The copy's height.
+     * @return The copy.
+     */
+    virtual wxImage getPreview(wxInt32 width, wxInt32 height) = 0;
+    
+    wxInt32 getWidth();
+    wxInt32 getHeight();
+    void startCoverage();
+    void endCoverage();
+    bool isCovered(const Placement& at);
+    void clip(const wxRect& area);
+    void unclip();
+    void takeReadErrors(std::vector<string>& errors);
+    
+    static Compositor* create(wxString name);
+    static wxArrayString available();
+
+protected:
+    /** The canvas width. Set by subclasses. */
+    wxInt32 myWidth;
+    
+    /** The canvas height. Set by subclasses. */
+    wxInt32 myHeight;
+    
+    /** One byte per canvas pixel, nonzero once a person pixel is painted
+     * there. Used when painting front-to-back. */
+    std::vector<unsigned char> myCoverage;
+    
+    /** Resamples people while painting them. */
+    ResampleKernel myKernel;
+    
+    /** The person image files that could not be read, as error messages.
+     * Kept as std::strings so that no wxString is shared between threads. */
+    std::vector<string> myReadErrors;
+    
+    wxRect paintArea();
+    void readFailed(const wxString& path);
+
+private:
+    /** Are people painted inside myClip only? true==yes. */
+    bool myClipped;
+    
+    /** The canvas area people are painted in while myClipped. */
+    wxRect myClip;
+};
+
+/** Paint into a wxImage, pixel by pixel. */
+class WxCompositor : public Compositor {
+public:
+    WxCompositor();
+    virtual wxString name();
+    virtual void clear(wxInt32 width, wxInt32 height);
+    virtual void setBackground(Mat& background, wxInt32 width, wxInt32 height,
+                               wxInt32 radius);
+    virtual void keepBackground();
+    virtual void restoreBackground();
+    virtual void restoreBackground(const wxRect& area);
+    virtual void keepPeople(const wxRect& area);
+    virtual void reopen();
+    virtual bool paintPerson(const wxString& path, const Placement& at,
+                             bool fromMip, bool uncovered);
+    virtual bool scalePerson(const wxString& path, const Placement& at,
+                             bool fromMip, Mat& aPerson);
+    virtual void setCanvas(const Mat& rgb);
+    virtual void forgetPeople();
+    virtual void blurBand(wxInt32 top, wxInt32 rows, wxInt32 radius);
+    virtual void reblurBand(wxInt32 top, wxInt32 rows, wxInt32 radius,
+                            const wxRect& area);
+    virtual SharedImage getImage();
+    virtual wxImage getPreview(wxInt32 width, wxInt32 height);
+
+private:
+    bool sourcePerson(const wxString& path, const Placement& at, bool fromMip,
+                      wxImage& aPerson);
+    bool loadPerson(const wxString& path, const Placement& at, bool fromMip,
+                    wxImage& aPerson);
+    bool readPerson(const wxString& path, wxImage& aPerson);
+    void setCrowd(const wxImage& anImage);
+    void setCrowd(const SharedImage& pixels);
+    
+    /** The canvas pixels, owned by a Mat, as handed out by getImage(). */
+    SharedImage myCanvas;
+    
+    /** The canvas, painted by wx: a view of myCanvas. Never copied, so that
+     * wx changes it in place. */
+    wxImage myCrowd;
+    
+    /** The canvas kept by keepBackground(). */
+    wxImage myBackground;
+    
+    /** The canvas kept by keepPeople(). */
+    wxImage myPeople;
+    
+    /** Small copies of person images, by path, with invisible pixels marked. */
+    std::map<wxString, wxImage> myMips;
+};
+
+/**
+ * Paint into a Mat with OpenCV's vectorized functions: resize, copyTo with a
+ * mask and GaussianBlur. People are painted by the resample kernel, as
+ * WxCompositor paints them. The canvas is stored RGB, as wxImage stores it,
+ * so wx can display and save it without a copy.
+ */
+class MatCompositor : public Compositor {
+public:
+    MatCompositor();
+    virtual wxString name();
+    virtual void clear(wxInt32 width, wxInt32 height);
+    virtual void setBackground(Mat& background, wxInt32 width, wxInt32 height,
+                               wxInt32 radius);
+    virtual void keepBackground();
+    virtual void restoreBackground();
+    virtual void restoreBackground(const wxRect& area);
+    virtual void keepPeople(const wxRect& area);
+    virtual void reopen();
+    virtual bool paintPerson(const wxString& path, const Placement& at,
+                             bool fromMip, bool uncovered);
+    virtual bool scalePerson(const wxString& path, const Placement& at,
+                             bool fromMip, Mat& aPerson);
+    virtual void setCanvas(const Mat& rgb);
+    virtual void forgetPeople();
+    virtual void blurBand(wxInt32 top, wxInt32 rows, wxInt32 radius);
+    virtual void reblurBand(wxInt32 top, wxInt32 rows, wxInt32 radius,
+                            const wxRect& area);
+    virtual SharedImage getImage();
+    virtual wxImage getPreview(wxInt32 width, wxInt32 height);
+
+private:
+    bool sourcePerson(const wxString& path, const Placement& at, bool fromMip,
+                      Mat& aPerson);
+    bool readPerson(const wxString& path, Mat& aPerson);
+    static void scale(const Mat& source, Mat& scaled, Size size);
+    static void blur(Mat& region, wxInt32 radius);
+    static double blurSigma(wxInt32 radius);
+    
+    /** The canvas, 8-bit RGB. */
+    Mat myCrowd;
+    
+    /** The canvas kept by keepBackground(). */
+    Mat myBackground;
+    
+    /** The canvas kept by keepPeople(). */
+    Mat myPeople;
+    
+    /** Small copies of person images, by path, 8-bit RGBA with invisible
+     * pixels transparent. */
+    std::map<wxString, Mat> myMips;
+};
+
+#endif	/* COMPOSITOR_H */
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "CoreTools.h"
+#include <sstream>
+#include <iostream>
+
+/**
+ * The default error handler. Write the error to standard error.
+ * @param msg The error message.
+ */
+static void printError(const string& msg) {
+    cerr << msg << endl;
+}
+
+/** The error handler. */
+static void (*errorHandler)(const string& msg) = printError;
+
+/**
+ * Convert an integer to a std string.
+ * @param anInt an integer
+ * @return the string.
+ */        
+string CoreTools::int2str(wxInt32 anInt) {
+    std::stringstream ss;
+    ss << anInt;
+    return ss.str();
+}
+
+/**
+ * Send core errors somewhere other than standard error. Set once, at start up,
+ * before any core threads run.
+ * @param handler The error handler, or NULL for the default.
+ */
+void CoreTools::setErrorHandler(void (*handler)(const string& msg)) {
+    errorHandler = handler != NULL ? handler : printError;
+}
+
+/**
+ * Report an error the caller cannot be told about.
+ * @param msg The error message.
+ */
+void CoreTools::error(const string& msg) {
+    errorHandler(msg);
+}
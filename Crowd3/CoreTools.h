@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CORETOOLS_H
+#define	CORETOOLS_H
+
+#include <wx/defs.h>
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
+using namespace cv;
+using namespace std;
+
+// Core constants:
+
+    /** A (hopefully) rare (almost black) color used to mark transparent areas 
+     * on an image. For use with OpenCV. */
+    const cv::Vec<unsigned char, 3> CV_COLOR_TRANSPARENT = cv::Vec<unsigned char, 3>(1, 1, 1);
+
+    /** The filename of the face detection cascade. */
+    const string FACECASCADENAME = "crowd3.xml"; 
+    // A copy of "/usr/share/opencv/haarcascades/haarcascade_frontalface_alt.xml";
+
+    /** The filename of the LBP face detection cascade. Not installed with
+     * Crowd3: the LBP detector is offered once a copy is in the data folder. */
+    const string FACELBPNAME = "crowd3_lbp.xml";
+    // A copy of "/usr/share/opencv/lbpcascades/lbpcascade_frontalface.xml";
+
+    /** The filename of the DNN face detection model. An SSD face model with a
+     * 300x300 input, e.g. OpenCV's res10_300x300_ssd face detector. Not
+     * installed with Crowd3: the DNN detector is offered once a copy is in
+     * the data folder. */
+    const string FACEDNNNAME = "crowd3_face.onnx";
+
+/**
+ * Helpers for the Crowd3 core: the people search engine, face detectors,
+ * image decoders and image database. The core uses plain C++ types, OpenCV,
+ * SQLite and only the non-GUI part of wxWidgets (threads), so programs without
+ * a GUI can link libcrowd3core.a. Core files include this header, never
+ * const.h or Tools.h. All functions are static. The crowd layout and the
+ * compositors are not part of the core; they still need wx.<p>
+ * Errors the core cannot hand back to its caller go to an error handler. The
+ * GUI shows them; the default handler writes them to standard error.<p>
+ * Usage:<p><code>
+ * CoreTools::setErrorHandler(showError);<p>
+ * CoreTools::error("Something failed");<p></code>
+ */
+class CoreTools {
+public:
+    static string int2str(wxInt32 anInt);
+    static void setErrorHandler(void (*handler)(const string& msg));
+    static void error(const string& msg);
+};
+
+#endif	/* CORETOOLS_H */
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "CrowdExporter.h"
+#include "Settings.h"
+
+DEFINE_EVENT_TYPE(wxEVT_CROWD_SAVED)
+
+/**
+ * Create a joinable crowd image export thread. Call Run() to start it.
+ * @param handler The receiver of the saved event.
+ * @param crowd The crowd image. Its pixels are shared, not copied.
+ * @param path The file to write. A .png extension selects PNG, .tif or .tiff
+ * TIFF, else JPEG.
+ * @param options The encoder settings.
+ */
+CrowdExporter::CrowdExporter(wxEvtHandler *handler, const SharedImage& crowd,
+        wxString path, const ExportOptions& options) : wxThread(wxTHREAD_JOINABLE) {
+    myHandler = handler;
+    myCrowd = crowd;
+    myMaker = NULL;
+    myCancelled = false;
+    myPath = Tools::wx2str(path);
+    myPng = path.Lower().EndsWith(_T(".png"));
+    myTiff = path.Lower().EndsWith(_T(".tif")) || path.Lower().EndsWith(_T(".tiff"));
+    myOptions = options;
+}
+
+/**
+ * Create a joinable export thread that has a crowd maker paint its crowd
+ * image at full resolution in bands, writing each band as it is painted. See
+ * CrowdMaker::renderToFile(). Call Run() to start it.
+ * @param handler The receiver of the saved event.
+ * @param maker The crowd maker. Not to be used by anyone else until the
+ * thread has ended.
+ * @param path The file to write. A .png extension selects PNG, .tif or .tiff
+ * TIFF, else JPEG.
+ * @param options The encoder settings.
+ */
+CrowdExporter::CrowdExporter(wxEvtHandler *handler, CrowdMaker *maker,
+        wxString path, const ExportOptions& options) : wxThread(wxTHREAD_JOINABLE) {
+    myHandler = handler;
+    myMaker = maker;
+    myCancelled = false;
+    myPath = Tools::wx2str(path);
+    myPng = path.Lower().EndsWith(_T(".png"));
+    myTiff = path.Lower().EndsWith(_T(".tif")) || path.Lower().EndsWith(_T(".tiff"));
+    myOptions = options;
+}
+
+/** @return true if the crowd maker paints the crowd image in bands, else false. */
+bool CrowdExporter::isBanded() {
+    return myMaker != NULL;
+}
+
+/** Ask a banded export to stop soon. Its unfinished file is deleted. Other
+ * exports run to the end. Call Wait() afterwards. */
+void CrowdExporter::cancel() {
+    myCancelled = true;
+}
+
+/**
+ * Progress of a banded export. Called on the export thread.
+ * @param peopleAdded The number of people painted so far.
+ * @return false once cancel() has been called.
+ */
+bool CrowdExporter::personAdded(wxInt32 peopleAdded) {
+    return ! myCancelled;
+}
+
+/** Bands are not previewed. */
+void CrowdExporter::rowAdded(Compositor& aCrowd) {}
+
+/**
+ * Get the encoder settings saved in the user preferences.
+ * @return The encoder settings.
+ */
+ExportOptions CrowdExporter::savedOptions() {
+    ExportOptions options;
+    options.jpegQuality = Settings::getJpegQuality();
+    options.jpegProgressive = Settings::getJpegProgressive();
+    options.jpegRestartInterval = Settings::getJpegRestartInterval();
+    options.pngCompression = Settings::getPngCompression();
+    return options;
+}
+
+/** Thread body: write the file and report the result. */
+wxThread::ExitCode CrowdExporter::Entry() {
+    wxCommandEvent saved(wxEVT_CROWD_SAVED);
+    bool written = false;
+    if (myMaker != NULL) {
+        try {
+            written = myMaker->renderToFile(myPath, myOptions, this);
+        }
+        catch (Exception e) {
+            written = false;
+        }
+    }
+    else {
+        written = encode();
+    }
+    saved.SetInt(written ? 1 : 0);
+    wxPostEvent(myHandler, saved);
+    return 0;
+}
+
+/**
+ * Encode the crowd image directly from its pixel buffer and write the file.
+ * The encoder wants BGR pixels, so the one conversion from the RGB buffer is
+ * the only copy made.
+ * @return true if the file was written.
+ */
+bool CrowdExporter::encode() {
+    try {
+        Mat bgr;
+        cvtColor(myCrowd.mat(), bgr, CV_RGB2BGR);
+        
+        vector<int> params;
+        if (myTiff) {
+            // The TIFF encoder takes no settings.
+        }
+        else if (myPng) {
+            params.push_back(CV_IMWRITE_PNG_COMPRESSION);
+            params.push_back(myOptions.pngCompression);
+        }
+        else {
+            params.push_back(CV_IMWRITE_JPEG_QUALITY);
+            params.push_back(myOptions.jpegQuality);
+#if CV_MAJOR_VERSION > 3 || (CV_MAJOR_VERSION == 3 && CV_MINOR_VERSION >= 2)
+            // Older OpenCV encoders have neither option.
+            params.push_back(IMWRITE_JPEG_PROGRESSIVE);
+            params.push_back(myOptions.jpegProgressive ? 1 : 0);
+            params.push_back(IMWRITE_JPEG_RST_INTERVAL);
+            params.push_back(myOptions.jpegRestartInterval);
+#endif
+        }
+        return imwrite(myPath, bgr, params);
+    }
+    catch (Exception e) {
+        return false;
+    }
+}
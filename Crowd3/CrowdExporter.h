@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CROWDEXPORTER_H
+#define	CROWDEXPORTER_H
+
+#include <wx/wx.h>
+#include <wx/thread.h>
+#include <opencv2/highgui/highgui.hpp>
+#include "Tools.h"
+#include "SharedImage.h"
+#include "CrowdMaker.h"
+
+/** Posted when a crowd image export ends. GetInt() is 1 if the file was
+ * written, 0 if not. */
+DECLARE_EVENT_TYPE(wxEVT_CROWD_SAVED, -1)
+
+/**
+ * Encode and write a crowd image on a background thread so that the user
+ * interface stays responsive. The format is chosen by the file extension:
+ * .png files are written as PNG, .tif and .tiff files as TIFF, all others as
+ * JPEG. A crowd image too large to hold in memory is instead painted by its
+ * crowd maker in bands, each written as soon as it is painted.<p>
+ * Usage:<p><code>
+ * e = new CrowdExporter(handler, crowdImage, path, options); or<p>
+ * e = new CrowdExporter(handler, crowdMaker, path, options);<p>
+ * e->Run();<p>
+ * ...handle the wxEVT_CROWD_SAVED event...<p>
+ * e->cancel(); e->Wait(); delete e;<p></code>
+ * The exporter shares the crowd image's pixels. They must not be modified
+ * until the thread has ended. A crowd maker painting in bands must not be
+ * used by anyone else until the thread has ended. Create and delete the
+ * exporter on the main thread.
+ */
+class CrowdExporter : public wxThread, public CrowdListener {
+public:
+    CrowdExporter(wxEvtHandler *handler, const SharedImage& crowd,
+            wxString path, const ExportOptions& options);
+    CrowdExporter(wxEvtHandler *handler, CrowdMaker *maker,
+            wxString path, const ExportOptions& options);
+    bool isBanded();
+    void cancel();
+    virtual bool personAdded(wxInt32 peopleAdded);
+    virtual void rowAdded(Compositor& aCrowd);
+    static ExportOptions savedOptions();
+
+protected:
+    virtual ExitCode Entry();
+
+private:
+    bool encode();
+    
+    /** The receiver of the saved event. */
+    wxEvtHandler *myHandler;
+
+    /** The crowd image. Shares its pixels with the crowd maker's image. Not
+     * ok when painting in bands. */
+    SharedImage myCrowd;
+
+    /** The crowd maker painting the crowd image in bands, or NULL. */
+    CrowdMaker *myMaker;
+
+    /** Set by cancel() to stop painting in bands. */
+    volatile bool myCancelled;
+
+    /** The file to write. Kept as a std::string so that no wxString is
+     * shared between threads. */
+    string myPath;
+
+    /** true to write a PNG file. */
+    bool myPng;
+
+    /** true to write a TIFF file. JPEG if neither. */
+    bool myTiff;
+
+    /** The encoder settings. */
+    ExportOptions myOptions;
+};
+
+#endif	/* CROWDEXPORTER_H */
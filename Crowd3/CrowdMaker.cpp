@@ -41,7 +41,10 @@ CrowdMaker::CrowdMaker() {
 }
 
 CrowdMaker::CrowdMaker(const CrowdMaker& orig) {}
-CrowdMaker::~CrowdMaker() {}
+
+CrowdMaker::~CrowdMaker() {
+    delete myCompositor;
+}
 
 /** Get all crowd settings from user preferences. */
 void CrowdMaker::loadAllSettings() {
@@ -51,11 +54,24 @@ void CrowdMaker::loadAllSettings() {
     myImageHeight = is.GetHeight();
     myPeopleCount = Settings::getPeopleCount();
     setPerspective(Settings::getPerspective());
+    myLayered = Settings::getLayeredRows();
+    myLayers.setBudget(Settings::getLayerBudget());
     
     // These are not saved as user preferences:
     myImageFiles = new wxArrayString();
     myCurrentCrowd = new wxArrayString();
-    myCrowd = new wxImage(myImageWidth, myImageHeight);
+    myCompositor = Compositor::create(Settings::getCompositor());
+    if (myCompositor == NULL) {
+        myCompositor = Compositor::create(COMPOSITOR_OPENCV);
+    }
+    myCompositor->clear(myImageWidth, myImageHeight);
+    myCulling = true;
+    myIncremental = true;
+    myRevisable = false;
+    myListener = NULL;
+    myDraft = false;
+    myCanvasScale = 1.0;
+    myLayoutStale = true;
 }
 
 /** Save all crowd settings to user preferences. */
@@ -64,7 +80,8 @@ void CrowdMaker::saveAllSettings() {
     Settings::setCrowdImageSize(wxSize(myImageWidth, myImageHeight));
     Settings::setPeopleCount(myPeopleCount);
     Settings::setPerspective(myUsingPer);
-    // These are not saved as user preferences: myImageFiles, myCurrentCrowd, myCrowd.
+    // These are not saved as user preferences: myImageFiles, myCurrentCrowd,
+    // the crowd image.
 }
 
 /**
@@ -74,6 +91,7 @@ void CrowdMaker::saveAllSettings() {
  */
 void CrowdMaker::setBackgroundPath(wxString anImagePath) {
     myBackgroundPath = anImagePath;
+    myLayoutStale = true;
 }
 
 /**
@@ -92,7 +110,8 @@ wxString CrowdMaker::getBackgroundPath() {
 void CrowdMaker::setImageSize(wxInt32 aWidth, wxInt32 aHeight) {
     myImageWidth = aWidth;
     myImageHeight = aHeight;
-    myCrowd = new wxImage(myImageWidth, myImageHeight);
+    myCompositor->clear(myImageWidth, myImageHeight);
+    myLayoutStale = true;
 }
 
 /** Get the size of the image if there is no background image. */
@@ -107,6 +126,7 @@ wxSize CrowdMaker::getImageSize() {
  */
 void CrowdMaker::setPeopleCount(wxInt32 aCount) {
     myPeopleCount = aCount;
+    myLayoutStale = true;
 }
 
 /**
@@ -129,6 +149,7 @@ void CrowdMaker::setPerspective(bool perSetting) {
     else {
         myPerFactor = 1.3; // no perspective
     }
+    myLayoutStale = true;
 }
 
 /** Get the Using Perspective flag for the image. */
@@ -136,40 +157,153 @@ bool CrowdMaker::getPerspective() {
     return myUsingPer;
 }
 
-/** Make a crowd image using a random selection of images. */
-void CrowdMaker::makeCrowdImage(wxFrame *parent) {
+/**
+ * Choose the painting order. Both orders produce the same crowd image.
+ * @param cullSetting true==paint front-to-back, skipping pixels and people
+ * hidden by nearer people; false==paint every person back-to-front.
+ */
+void CrowdMaker::setOcclusionCulling(bool cullSetting) {
+    myCulling = cullSetting;
+}
+
+/** Get the painting order flag. true==front-to-back with occlusion culling. */
+bool CrowdMaker::getOcclusionCulling() {
+    return myCulling;
+}
+
+/**
+ * Choose whether small edits are painted by revising the previous crowd image.
+ * Revising keeps two more copies of the crowd image: its background and its
+ * people before the depth blur.
+ * @param incrementalSetting true==revise after replacePeople() and
+ * swapPeople(); false==always paint the whole crowd image.
+ */
+void CrowdMaker::setIncremental(bool incrementalSetting) {
+    myIncremental = incrementalSetting;
+    myRevisable = myRevisable && myIncremental;
+}
+
+/** Get the incremental flag. true==revise the crowd image after small edits. */
+bool CrowdMaker::getIncremental() {
+    return myIncremental;
+}
+
+/**
+ * Choose whether each crowd row is painted into its own cached layer. The
+ * layers are stacked over the background, and the depth blur is applied to
+ * each layer by its depth rather than to fixed strips. The choice is saved in
+ * the user preferences.
+ * @param layeredSetting true==paint in layers; false==paint onto the canvas.
+ */
+void CrowdMaker::setLayeredRows(bool layeredSetting) {
+    myLayered = layeredSetting;
+    if ( ! myLayered) {
+        myLayers.clear();
+    }
+    Settings::setLayeredRows(myLayered);
+}
+
+/** Get the layered rows flag. true==paint each crowd row into its own layer. */
+bool CrowdMaker::getLayeredRows() {
+    return myLayered;
+}
+
+/**
+ * Choose how the crowd image pixels are painted. Every compositor paints the
+ * same crowd in the same places. The choice is saved in the user preferences.
+ * @param name One of the COMPOSITOR_ constants. Unknown names are ignored.
+ */
+void CrowdMaker::setCompositor(wxString name) {
+    Compositor *c = Compositor::create(name);
+    if (c == NULL) {
+        return;
+    }
+    myCompositor->takeReadErrors(myReadErrors);
+    delete myCompositor;
+    myCompositor = c;
+    myCompositor->clear(myImageWidth, myImageHeight);
+    myDraftBackgroundPath = _T(""); // Kept by the old compositor.
+    myRevisable = false;
+    myAtlas.clear(); // Made by the old compositor.
+    Settings::setCompositor(name);
+}
+
+/** Get the name of the compositor painting the crowd image. */
+wxString CrowdMaker::getCompositor() {
+    return myCompositor->name();
+}
+
+/**
+ * Paint drafts: the same crowd, scaled to fit a small size such as the size
+ * of the image panel. Painting at full resolution afterwards places every
+ * person exactly where the draft showed them.
+ * @param aSize The size to fit, or wxDefaultSize to paint at full resolution.
+ */
+void CrowdMaker::setDraftSize(wxSize aSize) {
+    myDraft = aSize.GetWidth() > 0 && aSize.GetHeight() > 0;
+    myDraftSize = aSize;
+}
+
+/** Is the crowd image from getCrowdImage() a draft? true==yes. */
+bool CrowdMaker::isDraft() {
+    return myCanvasScale != 1.0;
+}
+
+/**
+ * Choose a random selection of people for a new crowd image from the people
+ * selected in the image tree. Paint it with renderCrowdImage().
+ * @return false if there are no people to choose from, else true.
+ */
+bool CrowdMaker::makeCrowdImage() {
+    return makeCrowdImage(ImageTree::getSelectedPeopleFiles());
+}
+
+/**
+ * Choose a random selection of people for a new crowd image. Paint it with
+ * renderCrowdImage().
+ * @param files The people image files to choose from, in the Crowd3 folder.
+ * Kept, not copied, for replacePeople().
+ * @return false if there are no people to choose from, else true.
+ */
+bool CrowdMaker::makeCrowdImage(wxArrayString *files) {
     // Save all settings as user preferences.
     saveAllSettings();
     
-    // Get the list of requested people image files.
-    myImageFiles = ImageTree::getSelectedPeopleFiles();
+    // The list of requested people image files.
+    myImageFiles = files;
     
     // Select myPeopleCount images randomly from myImageFiles. Set myCurrentCrowd.
+    // Forget the mips of the previous crowd.
     myCurrentCrowd->Empty();
+    myCompositor->forgetPeople();
+    myAtlas.clear();
+    myFileSizes.clear();
+    myLayoutStale = true;
     wxInt32 fileCount = myImageFiles->Count();
     if (fileCount == 0) {
         Tools::log(_T("There are no image files selected or available.\n")
                    _T("Run the Find command or make a different file selection"));
-        return;
+        return false;
     }
     for (wxInt32 i = 0; i < myPeopleCount; i++) {
         wxInt32 aFileIndex = rand() % fileCount;
         myCurrentCrowd->Add(myImageFiles->Item(aFileIndex));
     }
-    
-    // Build a crowd image.
-    assembleTheImage(parent);
+    return true;
 }
 
-/** Make a new crowd image after shuffling the order of people in the current 
- * crowd image. */
-void CrowdMaker::shuffle(wxFrame *parent) {
+/**
+ * Shuffle the order of people in the current crowd image. Paint the new crowd
+ * image with renderCrowdImage().
+ * @return false if there is no crowd to shuffle, else true.
+ */
+bool CrowdMaker::shuffle() {
     // Randomize the order of the images in myCurrentCrowd by swapping random
     // elements a bunch of times.
     wxInt32 crowdCount = myCurrentCrowd->Count();
     if (crowdCount == 0) {
         // No crowd yet. Do a Make before a Shuffle.
-        return;
+        return false;
     }
     for (wxInt32 i = 0; i < crowdCount * 2; i++) {
         wxInt32 r1 = rand() % crowdCount;
@@ -178,40 +312,763 @@ void CrowdMaker::shuffle(wxFrame *parent) {
         myCurrentCrowd->Item(r1) = myCurrentCrowd->Item(r2);
         myCurrentCrowd->Item(r2) = temp;
     }
+    myLayoutStale = true;
+    return true;
+}
+
+/**
+ * Replace some people of the current crowd with people chosen at random from
+ * the selection made for makeCrowdImage(). Everyone else stays where they are.
+ * Paint the new crowd image with renderCrowdImage().
+ * @param aCount The number of people to replace.
+ * @return false if there is no crowd to change, else true.
+ */
+bool CrowdMaker::replacePeople(wxInt32 aCount) {
+    wxInt32 crowdCount = myCurrentCrowd->Count();
+    wxInt32 fileCount = myImageFiles->Count();
+    if (crowdCount == 0 || fileCount == 0) {
+        return false;
+    }
+    for (wxInt32 i = 0; i < aCount; i++) {
+        wxInt32 member = rand() % crowdCount;
+        myCurrentCrowd->Item(member) = myImageFiles->Item(rand() % fileCount);
+        personChanged(member);
+    }
+    return true;
+}
+
+/**
+ * Swap some random pairs of people in the current crowd. Everyone else stays
+ * where they are. Paint the new crowd image with renderCrowdImage().
+ * @param aCount The number of pairs to swap.
+ * @return false if there is no crowd to change, else true.
+ */
+bool CrowdMaker::swapPeople(wxInt32 aCount) {
+    wxInt32 crowdCount = myCurrentCrowd->Count();
+    if (crowdCount == 0) {
+        return false;
+    }
+    for (wxInt32 i = 0; i < aCount; i++) {
+        wxInt32 r1 = rand() % crowdCount;
+        wxInt32 r2 = rand() % crowdCount;
+        wxString temp = myCurrentCrowd->Item(r1);
+        myCurrentCrowd->Item(r1) = myCurrentCrowd->Item(r2);
+        myCurrentCrowd->Item(r2) = temp;
+        personChanged(r1);
+        personChanged(r2);
+    }
+    return true;
+}
+
+/**
+ * Place a crowd member whose person image changed where the old one stood,
+ * and mark both areas for repainting. The layout places crowd members in
+ * order, so a member's placement has the same index as the member.
+ * @param member The index of the member in myCurrentCrowd.
+ */
+void CrowdMaker::personChanged(wxInt32 member) {
+    if (myLayoutStale || member >= (wxInt32) myLayout.size()) {
+        return; // Not placed, or everyone will be placed anew.
+    }
+    Placement& old = myLayout[member];
+    Placement aPlacement;
+    if ( ! placePerson(myCurrentCrowd->Item(member), old.row, old.left, aPlacement)) {
+        myLayoutStale = true;
+        return;
+    }
+    markDirty(wxRect(old.left, old.top, old.width, old.height).Union(
+              wxRect(aPlacement.left, aPlacement.top, aPlacement.width, aPlacement.height)));
+    old = aPlacement;
+}
+
+/**
+ * Add an area to the areas to be repainted, merging it with those it
+ * overlaps.
+ * @param aRect A full resolution area.
+ */
+void CrowdMaker::markDirty(wxRect aRect) {
+    size_t i = 0;
+    while (i < myDirty.size()) {
+        if (myDirty[i].Intersects(aRect)) {
+            // The merged area may overlap areas already passed. Start over.
+            aRect = aRect.Union(myDirty[i]);
+            myDirty.erase(myDirty.begin() + i);
+            i = 0;
+        }
+        else {
+            i++;
+        }
+    }
+    myDirty.push_back(aRect);
+}
+
+/**
+ * Paint the crowd image chosen by makeCrowdImage() or shuffle(). The listener
+ * is told about progress and may cancel; a cancelled crowd image is blank.
+ * @param listener The receiver of progress reports.
+ * @return true if the crowd image is complete, else false.
+ */
+bool CrowdMaker::renderCrowdImage(CrowdListener *listener) {
+    myListener = listener;
+    bool completed = assembleTheImage();
+    myListener = NULL;
+    return completed;
+}
+
+/**
+ * Hand over the errors of the files that could not be read, the background's
+ * and the people's, and forget them. Call on the main thread while no render
+ * is running, and log them there.
+ * @return The error messages, oldest first.
+ */
+std::vector<string> CrowdMaker::takeReadErrors() {
+    myCompositor->takeReadErrors(myReadErrors);
+    std::vector<string> errors;
+    errors.swap(myReadErrors);
+    return errors;
+}
+
+/**
+ * Remember a file that could not be read, for takeReadErrors().
+ * @param path The file path.
+ */
+void CrowdMaker::readFailed(const wxString& path) {
+    myReadErrors.push_back("An error occurred while trying to read " + Tools::wx2str(path));
+}
+
+/**
+ * Paint the crowd image chosen by makeCrowdImage() or shuffle() at full
+ * resolution straight into a file, in horizontal bands of BANDROWS rows, for
+ * crowd images too large to hold in memory. Each band is painted with a margin
+ * the background and depth blurs need, from the background rows under it and
+ * the people who reach into it, then its rows are encoded and the band is
+ * dropped. Memory use grows with the crowd image's width, not its height. The
+ * bands are painted as assembleTheImage() paints a crowd without layered rows;
+ * the compositor's crowd image is left as it was.
+ * @param path The file to write. See BandWriter for the formats.
+ * @param options The encoder settings.
+ * @param listener Told about the people painted in each band, and may cancel.
+ * rowAdded() is not called.
+ * @return false if the background could not be read, the file could not be
+ * written or the listener cancelled, else true. Unfinished files are deleted.
+ */
+bool CrowdMaker::renderToFile(const string& path, const ExportOptions& options,
+                              CrowdListener *listener) {
+    BandReader background;
+    if (myBackgroundPath.length() > 0) {
+        if ( ! background.open(Tools::wx2str(myBackgroundPath), 1)) {
+            readFailed(myBackgroundPath);
+            return false;
+        }
+        if (background.getWidth() != myImageWidth ||
+                background.getHeight() != myImageHeight) {
+            myImageWidth = background.getWidth();
+            myImageHeight = background.getHeight();
+            myLayoutStale = true;
+        }
+    }
+    double canvasScale = myCanvasScale;
+    myCanvasScale = 1.0;
+    if (myLayoutStale) {
+        layoutTheCrowd();
+        myLayoutStale = false;
+    }
+    BandWriter writer;
+    if ( ! writer.open(path, myImageWidth, myImageHeight, options)) {
+        myCanvasScale = canvasScale;
+        return false;
+    }
+    
+    // Where each person's pixels go. Massive crowds are painted from sprites
+    // placed bottom centre on their placements.
+    bool massive = myPeopleCount > MASSIVECROWD;
+    std::vector<const Mat*> sprites(myLayout.size(), (const Mat*) NULL);
+    std::vector<Rect> reach(myLayout.size());
+    Compositor *aBand = Compositor::create(myCompositor->name());
+    for (size_t i = 0; i < myLayout.size(); i++) {
+        const Placement& aPlacement = myLayout[i];
+        reach[i] = Rect(aPlacement.left, aPlacement.top, aPlacement.width, aPlacement.height);
+        if (massive) {
+            wxString aFilePath = Tools::crowd3Folder() + SEPARATOR + aPlacement.file;
+            sprites[i] = myAtlas.sprite(*aBand, aFilePath, aPlacement);
+            reach[i] = sprites[i] == NULL ? Rect() :
+                    Rect(aPlacement.left + (aPlacement.width - sprites[i]->cols) / 2,
+                         aPlacement.top + aPlacement.height - sprites[i]->rows,
+                         sprites[i]->cols, sprites[i]->rows);
+        }
+    }
     
-    // Build a crowd image.
-    assembleTheImage(parent);
+    // The background blur of prepareCanvas() reaches into the margin that the
+    // depth blur of blurDepth() needs. Both are painted isolated in the band,
+    // so the margin's own pixels are spoiled, but never the band's.
+    int divs = 3; // As many strips as blurDepth() blurs.
+    wxInt32 strip = myImageHeight / divs;
+    wxInt32 margin = blurReach(5) + (myUsingPer ? blurReach(divs - 1) : 0);
+    wxInt32 painted = 0;
+    bool completed = true;
+    for (wxInt32 first = 0; first < myImageHeight && completed; first += BANDROWS) {
+        wxInt32 last = min(myImageHeight, first + BANDROWS);
+        wxInt32 top = max(0, first - margin);
+        wxInt32 bottom = min(myImageHeight, last + margin);
+        if (myBackgroundPath.length() > 0) {
+            Mat rows;
+            completed = background.read(top, bottom - top, rows);
+            if ( ! completed) {
+                break;
+            }
+            aBand->setCanvas(rows);
+            aBand->blurBand(0, bottom - top, 5);
+        }
+        else {
+            aBand->clear(myImageWidth, bottom - top);
+        }
+        
+        // The people reaching into the band, back row to front row. The band's
+        // compositor is this render's own, so sprites are painted into its
+        // canvas in place.
+        Rect band(0, top, myImageWidth, bottom - top);
+        SharedImage pixels;
+        if (massive) {
+            pixels = aBand->getImage();
+        }
+        Mat canvas = pixels.mat();
+        for (size_t i = 0; i < myLayout.size() && completed; i++) {
+            if ((reach[i] & band).area() == 0) {
+                continue;
+            }
+            if (massive) {
+                bool mirror = false;
+                wxInt32 tint[3];
+                spriteLook(i, mirror, tint);
+                SpriteAtlas::paint(canvas, Rect(0, 0, canvas.cols, canvas.rows),
+                                   *sprites[i], Point(reach[i].x, reach[i].y - top),
+                                   mirror, tint);
+            }
+            else {
+                Placement aPlacement = myLayout[i];
+                aPlacement.top -= top;
+                wxString aFilePath = Tools::crowd3Folder() + SEPARATOR + aPlacement.file;
+                aBand->paintPerson(aFilePath, aPlacement, false, false);
+            }
+            painted++;
+            completed = listener->personAdded(painted);
+        }
+        
+        // The depth blur of each strip the band reaches into.
+        for (int r = 0; r < divs - 1 && myUsingPer && completed; r++) {
+            wxInt32 from = max(top, r * strip);
+            wxInt32 to = min(bottom, (r + 1) * strip);
+            if (from < to) {
+                aBand->blurBand(from - top, to - from, divs - 1 - r);
+            }
+        }
+        if (completed) {
+            completed = writer.write(aBand->getImage().mat().rowRange(first - top,
+                                                                      last - top));
+        }
+    }
+    aBand->takeReadErrors(myReadErrors);
+    delete aBand;
+    myCanvasScale = canvasScale;
+    return completed && writer.close();
 }
 
-/** Construct the crowd image in myCrowd using all the settings. */
-void CrowdMaker::assembleTheImage(wxFrame *parent) {
+/**
+ * How far the blur of a compositor reaches. wxImage::Blur() reaches radius
+ * pixels and the Gaussian of the same variance less than three radii.
+ * @param radius The blur radius.
+ * @return The number of pixels on each side a blurred pixel may depend on.
+ */
+wxInt32 CrowdMaker::blurReach(wxInt32 radius) {
+    return radius > 0 ? 3 * radius + 1 : 0;
+}
+
+/**
+ * Construct the crowd image in myCompositor using all the settings.
+ * @return false if the background could not be read or the listener
+ * cancelled, else true.
+ */
+bool CrowdMaker::assembleTheImage() {
+    if (canRevise()) {
+        return reviseTheImage();
+    }
+    myRevisable = false;
+    myDirty.clear();
+    
     // Reinitialize the crowd image and reload the background image.
+    if ( ! prepareCanvas()) {
+        return false;
+    }
+    myListener->rowAdded(*myCompositor);
+    
+    // Decide where every person goes, then paint them. The layout is always
+    // computed at full resolution, so a draft and a full resolution image of
+    // the same crowd place every person identically.
+    if (myLayoutStale) {
+        layoutTheCrowd();
+        myLayoutStale = false;
+    }
+    if (myPeopleCount > MASSIVECROWD) {
+        if ( ! paintMassive()) {
+            // Cancelled.  Clear the image.
+            myCompositor->clear(myCompositor->getWidth(), myCompositor->getHeight());
+            return false;
+        }
+        blurDepth(NULL);
+        return true;
+    }
+    if (myLayered) {
+        if ( ! paintInLayers()) {
+            // Cancelled.  Clear the image.
+            myCompositor->clear(myCompositor->getWidth(), myCompositor->getHeight());
+            return false;
+        }
+        return true;
+    }
+    bool completed = myCulling ? paintFrontToBack() : paintBackToFront();
+    if ( ! completed) {
+        // Cancelled.  Clear the image.
+        myCompositor->clear(myCompositor->getWidth(), myCompositor->getHeight());
+        return false;
+    }
+    
+    if (myIncremental) {
+        // Keep the people before the depth blur, for revisions.
+        myCompositor->keepPeople(wxRect(0, 0, myCompositor->getWidth(),
+                                        myCompositor->getHeight()));
+        myRevisable = true;
+        myRevisableSize = myDraft ? myDraftSize : wxDefaultSize;
+    }
+    blurDepth(NULL);
+    return true;
+}
+
+/**
+ * Can the next render revise the previous crowd image? Only if people were
+ * replaced or swapped since, and nothing else changed.
+ * @return true if reviseTheImage() would paint the crowd image, else false.
+ */
+bool CrowdMaker::canRevise() {
+    wxSize aSize = myDraft ? myDraftSize : wxDefaultSize;
+    return myRevisable && ! myLayoutStale && ! myDirty.empty() &&
+            aSize == myRevisableSize;
+}
+
+/**
+ * Revise the previous crowd image after small edits. In each changed area,
+ * put back the background, repaint every person overlapping the area from
+ * back row to front row, then redo the depth blur there and as far around it
+ * as the blur reaches. The rest of the crowd image is copied as it was.
+ * @return false if the listener cancelled, else true.
+ */
+bool CrowdMaker::reviseTheImage() {
+    myCompositor->reopen();
+    std::vector<wxRect> areas;
+    for (size_t d = 0; d < myDirty.size(); d++) {
+        wxRect area = canvasArea(myDirty[d]);
+        if ( ! area.IsEmpty()) {
+            areas.push_back(area);
+        }
+    }
+    myDirty.clear();
+    
+    wxInt32 painted = 0;
+    for (size_t a = 0; a < areas.size(); a++) {
+        myCompositor->restoreBackground(areas[a]);
+        myCompositor->clip(areas[a]);
+        for (size_t i = 0; i < myLayout.size(); i++) {
+            Placement aPlacement = onCanvas(myLayout[i]);
+            if ( ! areas[a].Intersects(wxRect(aPlacement.left, aPlacement.top,
+                                              aPlacement.width, aPlacement.height))) {
+                continue;
+            }
+            paintPerson(aPlacement, false);
+            painted++;
+            if ( ! myListener->personAdded(painted)) {
+                // Cancelled.  Clear the image.
+                myCompositor->unclip();
+                myCompositor->clear(myCompositor->getWidth(), myCompositor->getHeight());
+                myRevisable = false;
+                return false;
+            }
+        }
+        myCompositor->unclip();
+        myCompositor->keepPeople(areas[a]);
+    }
+    
+    // Blur once every area's people are kept, as the blur around one area
+    // may reach into another. The blur of the pixels around an area reads the
+    // people in it, so blur as far out as the widest strip blur reaches.
+    int divs = 3; // As many strips as blurDepth() blurs.
+    wxInt32 reach = blurReach(floor((divs - 1) * myCanvasScale + 0.5));
+    wxRect canvas(0, 0, myCompositor->getWidth(), myCompositor->getHeight());
+    for (size_t a = 0; a < areas.size(); a++) {
+        wxRect blurred = areas[a];
+        blurred.Inflate(reach);
+        blurred = blurred.Intersect(canvas);
+        blurDepth(&blurred);
+    }
+    myListener->rowAdded(*myCompositor);
+    return true;
+}
+
+/**
+ * If a perspective image blur the crowd gradually from front rows to back.
+ * @param area The canvas area to blur again from the people kept by the
+ * compositor, or NULL to blur the whole canvas.
+ */
+void CrowdMaker::blurDepth(const wxRect *area) {
+    if ( ! myUsingPer) {
+        return;
+    }
+    int divs = 3; // Divide crowd image into this number of horizontal strips.
+    int rows = myCompositor->getHeight()/divs; // rows in each strip.
+    for (int r = 0; r < divs-1; r++) {
+        // Blur strips of the image increasing blur from front to back.
+        // Don't blur bottom strip.
+        wxInt32 radius = floor((divs-1-r) * myCanvasScale + 0.5);
+        if (area == NULL) {
+            myCompositor->blurBand(r*rows, rows, radius);
+        }
+        else {
+            myCompositor->reblurBand(r*rows, rows, radius, *area);
+        }
+    }
+}
+
+/**
+ * Paint each crowd row into its own layer and stack the layers over the
+ * background, back row first. A row's layer is kept in myLayers and reused
+ * while the row's people and their placements on the canvas are unchanged,
+ * so a new background, a new blur or a change to one row repaints only that
+ * much.
+ * @return false if the user cancelled, else true.
+ */
+bool CrowdMaker::paintInLayers() {
+    // The canvas holds the background. Stack onto a copy, as the compositor
+    // may share the background it keeps for drafts.
+    Mat canvas = myCompositor->getImage().mat().clone();
+    Rect canvasRect(0, 0, canvas.cols, canvas.rows);
+    wxInt32 rowCount = myRowScale.GetCount();
+    wxInt32 painted = 0;
+    size_t first = 0;
+    while (first < myLayout.size()) {
+        // The row's people, and everything that decides their pixels.
+        wxInt32 row = myLayout[first].row;
+        wxString key = myCompositor->name() +
+                wxString::Format(_T(" %dx%d"), canvas.cols, canvas.rows);
+        Rect area;
+        size_t end = first;
+        while (end < myLayout.size() && myLayout[end].row == row) {
+            Placement aPlacement = onCanvas(myLayout[end]);
+            key = key + wxString::Format(_T("|%d,%d,%d,%d "), aPlacement.left,
+                    aPlacement.top, aPlacement.width, aPlacement.height) + aPlacement.file;
+            Rect placed(aPlacement.left, aPlacement.top, aPlacement.width, aPlacement.height);
+            area = end == first ? placed : (area | placed);
+            end++;
+        }
+        
+        RowLayer *aLayer = myLayers.find(row, key);
+        if (aLayer == NULL) {
+            RowLayer fresh;
+            LayerCache::startLayer(fresh, key, area & canvasRect);
+            for (size_t i = first; i < end; i++) {
+                Placement aPlacement = onCanvas(myLayout[i]);
+                wxString aFilePath = Tools::crowd3Folder() + SEPARATOR + aPlacement.file;
+                Mat aPerson;
+                if (myCompositor->scalePerson(aFilePath, aPlacement, myCanvasScale < 1.0, aPerson)
+                        && ! aPerson.empty()) {
+                    LayerCache::paint(fresh, aPerson, Point(aPlacement.left, aPlacement.top));
+                }
+                painted++;
+                if ( ! myListener->personAdded(painted)) {
+                    return false;
+                }
+            }
+            aLayer = myLayers.store(row, fresh);
+        }
+        else {
+            painted += end - first;
+            if ( ! myListener->personAdded(painted)) {
+                return false;
+            }
+        }
+        myLayers.stack(canvas, *aLayer, rowBlur(row, rowCount));
+        
+        // Show each finished row.
+        myCompositor->setCanvas(canvas);
+        myListener->rowAdded(*myCompositor);
+        first = end;
+    }
+    myCompositor->setCanvas(canvas);
+    return true;
+}
+
+/**
+ * Paint a massive crowd from sprites. Every placement of a person at about
+ * the same size shares one pre-shrunk sprite from myAtlas, varied by mirroring
+ * and a slight tint chosen from the placement's index, so a draft and a full
+ * resolution image vary every person alike. The placements are binned by
+ * canvas tile and painted tile by tile, back to front within each tile, so
+ * each tile of the canvas stays in cache while its people are painted.
+ * Sprites are placed bottom centre on their placements.
+ * @return false if the user cancelled, else true.
+ */
+bool CrowdMaker::paintMassive() {
+    Mat canvas = myCompositor->getImage().mat().clone();
+    wxInt32 tilesAcross = (canvas.cols + SPRITETILE - 1) / SPRITETILE;
+    wxInt32 tilesDown = (canvas.rows + SPRITETILE - 1) / SPRITETILE;
+    
+    // Find every person's sprite and spot, and bin the spots by tile.
+    std::vector<const Mat*> sprites(myLayout.size(), (const Mat*) NULL);
+    std::vector<Point> spots(myLayout.size());
+    std::vector<std::vector<wxInt32> > bins(tilesAcross * tilesDown);
+    Rect canvasRect(0, 0, canvas.cols, canvas.rows);
+    for (size_t i = 0; i < myLayout.size(); i++) {
+        Placement aPlacement = onCanvas(myLayout[i]);
+        wxString aFilePath = Tools::crowd3Folder() + SEPARATOR + aPlacement.file;
+        sprites[i] = myAtlas.sprite(*myCompositor, aFilePath, aPlacement);
+        if ( ! myListener->personAdded(i + 1)) {
+            return false;
+        }
+        if (sprites[i] == NULL) {
+            continue;
+        }
+        const Mat& aSprite = *sprites[i];
+        spots[i] = Point(aPlacement.left + (aPlacement.width - aSprite.cols) / 2,
+                         aPlacement.top + aPlacement.height - aSprite.rows);
+        Rect onCanvas = Rect(spots[i].x, spots[i].y, aSprite.cols, aSprite.rows) &
+                        canvasRect;
+        if (onCanvas.area() == 0) {
+            continue;
+        }
+        for (wxInt32 ty = onCanvas.y / SPRITETILE;
+                ty <= (onCanvas.y + onCanvas.height - 1) / SPRITETILE; ty++) {
+            for (wxInt32 tx = onCanvas.x / SPRITETILE;
+                    tx <= (onCanvas.x + onCanvas.width - 1) / SPRITETILE; tx++) {
+                bins[ty * tilesAcross + tx].push_back(i);
+            }
+        }
+    }
+    
+    // Paint tile by tile. Show each finished band of tiles.
+    for (wxInt32 ty = 0; ty < tilesDown; ty++) {
+        for (wxInt32 tx = 0; tx < tilesAcross; tx++) {
+            Rect tile = Rect(tx * SPRITETILE, ty * SPRITETILE, SPRITETILE, SPRITETILE) &
+                        canvasRect;
+            const std::vector<wxInt32>& bin = bins[ty * tilesAcross + tx];
+            for (size_t b = 0; b < bin.size(); b++) {
+                wxInt32 i = bin[b];
+                bool mirror = false;
+                wxInt32 tint[3];
+                spriteLook(i, mirror, tint);
+                SpriteAtlas::paint(canvas, tile, *sprites[i], spots[i], mirror, tint);
+            }
+        }
+        myCompositor->setCanvas(canvas);
+        myListener->rowAdded(*myCompositor);
+        if ( ! myListener->personAdded(myLayout.size())) {
+            return false;
+        }
+    }
+    myCompositor->setCanvas(canvas);
+    return true;
+}
+
+/**
+ * Vary the look of a massive crowd's sprite by its placement: mirror it or
+ * not, and tint it slightly. The variation comes from a multiplicative hash of
+ * the placement's index, so every render of the crowd varies it alike.
+ * @param member The placement's index in myLayout.
+ * @param mirror The returned choice: true to paint the sprite mirrored.
+ * @param tint The returned red, green and blue factors in 256ths.
+ */
+void CrowdMaker::spriteLook(wxInt32 member, bool& mirror, wxInt32 tint[3]) {
+    unsigned long h = ((unsigned long) (member + 1) * 2654435761UL) & 0xffffffffUL;
+    mirror = (h >> 16) & 1;
+    wxInt32 brightness = 230 + (h >> 17) % 53; // 0.9 to 1.1
+    tint[0] = brightness + (wxInt32) ((h >> 24) % 9) - 4;
+    tint[1] = brightness;
+    tint[2] = brightness + (wxInt32) ((h >> 28) % 9) - 4;
+}
+
+/**
+ * The depth blur radius of a crowd row painted in layers: none for the front
+ * row, growing with depth to the radius of the strip blur's back strip.
+ * @param row The crowd row. Row 0 is the front row.
+ * @param rowCount The number of crowd rows.
+ * @return The radius, in canvas pixels.
+ */
+wxInt32 CrowdMaker::rowBlur(wxInt32 row, wxInt32 rowCount) {
+    if ( ! myUsingPer || rowCount < 2) {
+        return 0;
+    }
+    int divs = 3; // As many strips as blurDepth() blurs.
+    double depth = row / (double) (rowCount - 1);
+    return floor((divs - 1) * depth * myCanvasScale + 0.5);
+}
+
+/**
+ * Scale a full resolution area to the crowd image being painted, rounding
+ * outwards so that it holds every pixel of the people placed in it.
+ * @param aRect A full resolution area.
+ * @return The canvas area, within the canvas.
+ */
+wxRect CrowdMaker::canvasArea(const wxRect& aRect) {
+    wxInt32 left = floor(aRect.x * myCanvasScale);
+    wxInt32 top = floor(aRect.y * myCanvasScale);
+    wxInt32 right = ceil((aRect.x + aRect.width) * myCanvasScale) + 1;
+    wxInt32 bottom = ceil((aRect.y + aRect.height) * myCanvasScale) + 1;
+    wxRect canvas(0, 0, myCompositor->getWidth(), myCompositor->getHeight());
+    return canvas.Intersect(wxRect(left, top, right - left, bottom - top));
+}
+
+/**
+ * Set up the canvas with the (blurred) background or a blank image, at full
+ * resolution or at the draft size. Set myImageWidth, myImageHeight (always
+ * the full resolution size) and myCanvasScale.
+ * @return false if the background could not be read, else true.
+ */
+bool CrowdMaker::prepareCanvas() {
     if (myBackgroundPath.length() > 0) {
-        if ( ! myCrowd->LoadFile(myBackgroundPath, wxBITMAP_TYPE_JPEG)) {
-            Tools::log(_T("An error occurred while trying to read ") + myBackgroundPath);
-            return;
+        if (myDraft && myBackgroundPath.IsSameAs(myDraftBackgroundPath) &&
+                myDraftSize == myDraftBackgroundSize) {
+            // Reuse the draft background of the previous draft.
+            myImageWidth = myDraftBackgroundFullSize.GetWidth();
+            myImageHeight = myDraftBackgroundFullSize.GetHeight();
+            myCanvasScale = canvasScale();
+            myCompositor->restoreBackground();
+            return true;
+        }
+        
+        // Any known format, recognised from the file contents.
+        string backgroundPath = Tools::wx2str(myBackgroundPath);
+        const ImageDecoder *decoder = ImageDecoder::find(backgroundPath);
+        Mat decoded;
+        wxInt32 fullWidth = 0;
+        wxInt32 fullHeight = 0;
+        if (myDraft && decoder != NULL) {
+            decoder->readSize(backgroundPath, fullWidth, fullHeight);
+        }
+        if (fullWidth > 0 && fullHeight > 0) {
+            // Drafts of large JPEG backgrounds shrink them while decoding, by
+            // as much as the draft still has every pixel it needs.
+            myImageWidth = fullWidth;
+            myImageHeight = fullHeight;
+            double scale = canvasScale();
+            wxInt32 shrink = 1;
+            while (shrink < 8 && 2 * shrink * scale <= 1.0) {
+                shrink *= 2;
+            }
+            BandReader reader;
+            Mat rgb;
+            if (shrink > 1 && reader.open(backgroundPath, shrink) &&
+                    reader.read(0, reader.getHeight(), rgb)) {
+                if (reader.getShrink() == 1) {
+                    // Decoded whole, as some formats are.
+                    fullWidth = rgb.cols;
+                    fullHeight = rgb.rows;
+                }
+                cvtColor(rgb, decoded, CV_RGB2BGR);
+            }
         }
+        if (decoded.empty() && decoder != NULL) {
+            decoded = decoder->decode(backgroundPath, CV_LOAD_IMAGE_COLOR);
+            fullWidth = decoded.cols;
+            fullHeight = decoded.rows;
+        }
+        if (decoded.empty()) {
+            readFailed(myBackgroundPath);
+            return false;
+        }
+        myImageWidth = fullWidth;
+        myImageHeight = fullHeight;
+        myCanvasScale = canvasScale();
         
-        // Slightly blur the background image to suggest depth.
-        *myCrowd = myCrowd->Blur(5);
+        if (myDraft) {
+            // Shrink first, then blur with a proportionally smaller radius.
+            wxInt32 radius = max(1.0, floor(5 * myCanvasScale + 0.5));
+            myCompositor->setBackground(decoded, canvasLength(myImageWidth),
+                                        canvasLength(myImageHeight), radius);
+            myCompositor->keepBackground();
+            myDraftBackgroundPath = myBackgroundPath;
+            myDraftBackgroundSize = myDraftSize;
+            myDraftBackgroundFullSize = wxSize(myImageWidth, myImageHeight);
+        }
+        else {
+            // Slightly blur the background image to suggest depth.
+            myCompositor->setBackground(decoded, myImageWidth, myImageHeight, 5);
+            if (myIncremental) {
+                // Kept for revisions, in place of any draft background.
+                myCompositor->keepBackground();
+                myDraftBackgroundPath = _T("");
+            }
+        }
+    }
+    else {
+        myCanvasScale = canvasScale();
+        myCompositor->clear(canvasLength(myImageWidth), canvasLength(myImageHeight));
+        if (myIncremental) {
+            myCompositor->keepBackground();
+            myDraftBackgroundPath = _T("");
+        }
+    }
+    return true;
+}
 
-        myImageWidth = myCrowd->GetWidth();
-        myImageHeight = myCrowd->GetHeight();
+/**
+ * The scale from full resolution to the crowd image being painted.
+ * @return 1.0 at full resolution, the fit into the draft size for drafts.
+ */
+double CrowdMaker::canvasScale() {
+    if ( ! myDraft) {
+        return 1.0;
     }
-    else {    
-        myCrowd = new wxImage(myImageWidth, myImageHeight);
+    double scale = min(myDraftSize.GetWidth() / (double) myImageWidth,
+                       myDraftSize.GetHeight() / (double) myImageHeight);
+    return min(scale, 1.0);
+}
+
+/**
+ * Scale a full resolution length to the crowd image being painted.
+ * @param aLength A full resolution width or height.
+ * @return The scaled length, at least 1.
+ */
+wxInt32 CrowdMaker::canvasLength(wxInt32 aLength) {
+    return max(1, (wxInt32) floor(aLength * myCanvasScale + 0.5));
+}
+
+/**
+ * Scale a full resolution placement to the crowd image being painted.
+ * @param aPlacement A placement from myLayout.
+ * @return The placement in crowd image coordinates.
+ */
+Placement CrowdMaker::onCanvas(const Placement& aPlacement) {
+    if (myCanvasScale == 1.0) {
+        return aPlacement;
     }
+    Placement scaled = aPlacement;
+    scaled.left = floor(aPlacement.left * myCanvasScale + 0.5);
+    scaled.top = floor(aPlacement.top * myCanvasScale + 0.5);
+    scaled.width = canvasLength(aPlacement.width);
+    scaled.height = canvasLength(aPlacement.height);
+    return scaled;
+}
+
+/**
+ * Compute the position and size of every person in myCurrentCrowd and store
+ * them in myLayout in back-to-front painting order. Only the person image file
+ * headers are read; the images themselves are not decoded.
+ */
+void CrowdMaker::layoutTheCrowd() {
+    myLayout.clear();
     
-    // Show a progress dialog displaying count of images added to the crowd.
-    myProgress = new wxProgressDialog(
-            _T("Creating a crowd image"),
-            _T("Starting..."),
-            myPeopleCount,
-            parent,
-            wxPD_APP_MODAL | wxPD_SMOOTH | wxPD_CAN_ABORT | 
-            wxPD_AUTO_HIDE | wxPD_ELAPSED_TIME);
-    myProgress->SetSize(myProgress->GetSize().GetWidth() * 2,
-                        myProgress->GetSize().GetHeight());
+    // Massive crowds shrink gently from row to row, or not at all without
+    // perspective, so that their many rows stay visible.
+    double perFactor = myPerFactor;
+    if (myPeopleCount > MASSIVECROWD) {
+        perFactor = myUsingPer ? MASSIVEPERFACTOR : 1.0;
+    }
     
     // Estimate rows and columns of people proportional to size of the image.
     // To estimate, assume a rectangular grid of people:
@@ -237,8 +1094,7 @@ void CrowdMaker::assembleTheImage(wxFrame *parent) {
     // the perspective factor.
     ArrayOfInts rowPopulation;
     rowPopulation.Empty();
-    ArrayOfDoubles rowScale;
-    rowScale.Empty();
+    myRowScale.Empty();
     
     // Based on the number of people in row 0, determine how to scale the people
     // images so that they will fit. (Scale to shrink, never to enlarge.)
@@ -250,7 +1106,7 @@ void CrowdMaker::assembleTheImage(wxFrame *parent) {
     wxInt32 peopleRemaining = myPeopleCount;
     wxInt32 row = 0;
     while (peopleRemaining > 0) {
-        double rowScaleFactor = row0ScaleFactor * pow(myPerFactor, row);
+        double rowScaleFactor = row0ScaleFactor * pow(perFactor, row);
         wxInt32 rowPeople = myImageWidth / (PERSONWIDTH * rowScaleFactor);
         if (row % 2) { // odd numbered rows.
             // One fewer person in odd rows because they are indented.
@@ -264,7 +1120,7 @@ void CrowdMaker::assembleTheImage(wxFrame *parent) {
         rowPeople = rowPeople + 2 + row/8;
         
         // Collect row data.
-        rowScale.Add(rowScaleFactor);
+        myRowScale.Add(rowScaleFactor);
         rowPopulation.Add(min(peopleRemaining, rowPeople));
         peopleRemaining = peopleRemaining - rowPopulation.Item(row);
         row++;
@@ -278,7 +1134,7 @@ void CrowdMaker::assembleTheImage(wxFrame *parent) {
     // Is there enough vertical space for all rows using the ideal value?
     wxInt32 headSpaceRequired = 0;
     for (int r=0; r<rowPopulation.GetCount(); r++) {
-        headSpaceRequired = headSpaceRequired + idealHeadRoom * pow(myPerFactor, r);
+        headSpaceRequired = headSpaceRequired + idealHeadRoom * pow(perFactor, r);
     }
     wxInt32 actualHeadRoom = 0;
     // Is the image large enough for this head space plus row0 bodies?
@@ -295,28 +1151,24 @@ void CrowdMaker::assembleTheImage(wxFrame *parent) {
 
     // Determine the vertical position of the top of each row. Start with the 
     // vertical position of row 0.
-    ArrayOfInts rowPosition;
+    myRowPosition.Empty();
     wxInt32 row0Position = (double) myImageHeight - row0ScaleFactor * PERSONHEIGHT;
-    rowPosition.Add(row0Position);
+    myRowPosition.Add(row0Position);
     for (wxInt32 r = 1; r < rowPopulation.GetCount(); r++) {
         // Set headroom for each row. Alternatives:
           // Decrease headroom by perspective factor.
-          rowPosition.Add(rowPosition.Item(r - 1) - actualHeadRoom * pow(myPerFactor, r));
+          myRowPosition.Add(myRowPosition.Item(r - 1) - actualHeadRoom * pow(perFactor, r));
             // Decrease headroom faster than perspective factor.
-            //rowPosition.Add(rowPosition.Item(r - 1) - actualHeadRoom * pow(myPerFactor, r) * myPerFactor);
+            //myRowPosition.Add(myRowPosition.Item(r - 1) - actualHeadRoom * pow(perFactor, r) * perFactor);
     }
     
-    // Add people images to the crowd image from back row to front row so that
-    // front people will partially obscure back people.
+    // Place people images from back row to front row so that front people
+    // will partially obscure back people.
     wxInt32 crowdMember = 0;
     wxInt32 mCol = 0;
-    wxInt32 mRow = 0;
     for (wxInt32 r = rowPopulation.GetCount() - 1; r >= 0; r--) { // for each row...
-        // Get scale for the row.
-        double rScale = rowScale.Item(r);
-        
         // Get target width for the row.
-        wxInt32 rowTargetWidth = targetWidth * pow(myPerFactor, max(0,r-1));
+        wxInt32 rowTargetWidth = targetWidth * pow(perFactor, max(0,r-1));
         
         // Compute the horizontal position of the first person image in the row.
         if (r % 2) { // odd numbered rows.
@@ -329,114 +1181,152 @@ void CrowdMaker::assembleTheImage(wxFrame *parent) {
         }
         
         for (wxInt32 p = 0; p < rowPopulation.Item(r); p++) {// for each person in row...
-            // Read a person image file. 
-            wxString aFilePath = Tools::crowd3Folder() + 
-                    SEPARATOR + myCurrentCrowd->Item(crowdMember);
-            wxImage *aPerson = new wxImage();
-            if ( ! aPerson->LoadFile(aFilePath, wxBITMAP_TYPE_PNG)) {
-                Tools::log(_T("An error occurred while trying to read ") + aFilePath);
+            Placement aPlacement;
+            if ( ! placePerson(myCurrentCrowd->Item(crowdMember), r, mCol, aPlacement)) {
                 continue;
             }
-          
-            // Mark the invisible pixels using the color mask and the alpha channel.
-            aPerson->SetMaskColour(
-                WX_COLOR_TRANSPARENT[0], 
-                WX_COLOR_TRANSPARENT[1], 
-                WX_COLOR_TRANSPARENT[2]);
-            aPerson->InitAlpha();
-            
-            // Scale the person image to desired width. Apply perspective.
-            aPerson->Rescale(aPerson->GetWidth() * rScale, 
-                             aPerson->GetHeight() * rScale, wxIMAGE_QUALITY_HIGH);
-          
-            // Vertical position (adjust for short images)
-            mRow = rowPosition.Item(r);
-            if (aPerson->GetHeight() < FULLPERSONHEIGHT * rScale) {
-                mRow = mRow + FULLPERSONHEIGHT * rScale - aPerson->GetHeight();
-            }
-            
-            // Merge the person image into the crowd image.
-            crowdMerge(aPerson, mRow, mCol);
+            myLayout.push_back(aPlacement);
 
             // Next person image.
             crowdMember++;
             
             // Column position of next person image. Alternatives:
             //mCol = mCol + aPerson.cols; // exact width of person
-            //mCol = mCol + targetWidth * pow(myPerFactor, 0); // target width in row_0
-            //mCol = mCol + targetWidth * pow(myPerFactor, r); // target width in row_r
-            //mCol = mCol + targetWidth * pow(myPerFactor, max(0, r-1)); // target width in row_r-1
+            //mCol = mCol + targetWidth * pow(perFactor, 0); // target width in row_0
+            //mCol = mCol + targetWidth * pow(perFactor, r); // target width in row_r
+            //mCol = mCol + targetWidth * pow(perFactor, max(0, r-1)); // target width in row_r-1
             // When image width in a row starts to shrink and reveal background...
-            if (pow(myPerFactor, r) < 0.75 * pow(myPerFactor, 0)) {
+            if (pow(perFactor, r) < 0.75 * pow(perFactor, 0)) {
                 // Pack back row people closely together.
-                mCol = mCol + aPerson->GetWidth(); // exact width of person
+                mCol = mCol + aPlacement.width; // exact width of person
             }
             else {
                 // Line up front row people.
-                mCol = mCol + targetWidth * pow(myPerFactor, 0); // target width in row_0
-            }
-            
-            // Update progress.
-            if ( ! myProgress->Update(crowdMember, 
-                    _T("Images added: ") + Tools::int2wx(crowdMember))) {
-                // Cancelled.  Clear the image.
-                myCrowd = new wxImage(myImageWidth, myImageHeight);
-                myProgress->Destroy();
-                return;
+                mCol = mCol + targetWidth * pow(perFactor, 0); // target width in row_0
             }
         }
     }
-    
-    // If a perspective image blur the crowd gradually from front rows to back.
-    if (myUsingPer) {
-        int divs = 3; // Divide crowd image into this number of horizontal strips.
-        int rows = myCrowd->GetHeight()/divs; // rows in each strip.
-        for (int r = 0; r < divs-1; r++) {
-            // Blur strips of the image increasing blur from front to back.
-            // Don't blur bottom strip.
-            wxImage aStrip = myCrowd->GetSubImage(wxRect(
-                    0, r*rows, myCrowd->GetWidth(), rows));
-            aStrip = aStrip.Blur(divs-1-r);
-            myCrowd->Paste(aStrip, 0, r*rows);
+}
+
+/**
+ * Place a person image in a crowd row: scale it for the row and stand it on
+ * the row's floor. Only the person image file header is read.
+ * @param aFile The person image file name, relative to the Crowd3 folder.
+ * @param row The crowd row. Row 0 is the front row.
+ * @param left The crowd image column where the person image starts.
+ * @param aPlacement The returned placement.
+ * @return false if the person image file could not be read, else true.
+ */
+bool CrowdMaker::placePerson(const wxString& aFile, wxInt32 row, wxInt32 left,
+                             Placement& aPlacement) {
+    // Read the size of a person image file, once per file: people repeat
+    // often in large crowds.
+    std::map<wxString, wxSize>::iterator known = myFileSizes.find(aFile);
+    if (known == myFileSizes.end()) {
+        wxString aFilePath = Tools::crowd3Folder() + SEPARATOR + aFile;
+        wxInt32 w = 0;
+        wxInt32 h = 0;
+        if ( ! Tools::pngSize(aFilePath, w, h)) {
+            readFailed(aFilePath);
+            return false;
         }
+        known = myFileSizes.insert(std::make_pair(aFile, wxSize(w, h))).first;
     }
+    wxInt32 fileWidth = known->second.GetWidth();
+    wxInt32 fileHeight = known->second.GetHeight();
+    
+    // Scale the person image to desired width. Apply perspective.
+    double rScale = myRowScale.Item(row);
+    aPlacement.file = aFile;
+    aPlacement.row = row;
+    aPlacement.width = fileWidth * rScale;
+    aPlacement.height = fileHeight * rScale;
     
-    myProgress->Destroy();
+    // Vertical position (adjust for short images)
+    wxInt32 mRow = myRowPosition.Item(row);
+    if (aPlacement.height < FULLPERSONHEIGHT * rScale) {
+        mRow = mRow + FULLPERSONHEIGHT * rScale - aPlacement.height;
+    }
+    aPlacement.top = mRow;
+    aPlacement.left = left;
+    return true;
 }
 
 /**
- * Add an image to the crowd image at the given row and column. Recognize the
- * transparent parts of the new image.
- * @param aPerson The new person image to be added to the crowd image.
- * @param mRow The row in the crowd image where aPerson starts.
- * @param mCol The column in the crowd image where aPerson starts.
+ * Paint the people of myLayout into the crowd image from back row to front
+ * row. Front people overwrite the back people they obscure.
+ * @return false if the user cancelled, else true.
  */
-void CrowdMaker::crowdMerge(wxImage *aPerson, wxInt32 mRow, wxInt32 mCol) {
-    // cy, cx == myCrowd row, column. py, px == aPerson row, column.
-    // Negative mRow and mCol are tolerated.
-    for (wxInt32 cx = mCol, px = 0;
-                cx < min(myCrowd->GetWidth(), mCol + aPerson->GetWidth());
-                cx++, px++) {
-        for (wxInt32 cy = mRow, py = 0;
-                    cy < min(myCrowd->GetHeight(), mRow + aPerson->GetHeight());
-                    cy++, py++) {
-            
-            // Move visible pixels from aPerson to myCrowd.
-            if ( ( ! aPerson->IsTransparent(px, py)) && cx >= 0 && cy >=0) {
-                // Copy aPerson pixel at px,py to myCrowd at cx,cy.
-                myCrowd->SetRGB(cx, cy, 
-                        aPerson->GetRed(px, py),
-                        aPerson->GetGreen(px, py),
-                        aPerson->GetBlue(px, py));
-            }
+bool CrowdMaker::paintBackToFront() {
+    for (wxInt32 i = 0; i < myLayout.size(); i++) {
+        // Merge the person image into the crowd image.
+        paintPerson(onCanvas(myLayout[i]), false);
+        
+        // Show each finished row.
+        if (i + 1 == myLayout.size() || myLayout[i + 1].row != myLayout[i].row) {
+            myListener->rowAdded(*myCompositor);
+        }
+        
+        // Update progress.
+        if ( ! myListener->personAdded(i + 1)) {
+            return false;
         }
     }
+    return true;
+}
+
+/**
+ * Paint the people of myLayout into the crowd image from front row to back
+ * row. A coverage buffer records which crowd pixels already hold a nearer
+ * person, so each crowd pixel is written at most once and people hidden
+ * entirely behind nearer people are never read from disk. The result is
+ * identical to paintBackToFront().
+ * @return false if the user cancelled, else true.
+ */
+bool CrowdMaker::paintFrontToBack() {
+    myCompositor->startCoverage();
+    
+    wxInt32 painted = 0;
+    for (wxInt32 i = myLayout.size() - 1; i >= 0; i--) {
+        // Skip people whose entire rectangle is already painted over.
+        Placement aPlacement = onCanvas(myLayout[i]);
+        if ( ! myCompositor->isCovered(aPlacement)) {
+            paintPerson(aPlacement, true);
+        }
+        
+        // Show each finished row.
+        if (i == 0 || myLayout[i - 1].row != myLayout[i].row) {
+            myListener->rowAdded(*myCompositor);
+        }
+        
+        // Update progress.
+        painted++;
+        if ( ! myListener->personAdded(painted)) {
+            myCompositor->endCoverage();
+            return false;
+        }
+    }
+    myCompositor->endCoverage();
+    return true;
+}
+
+/**
+ * Paint one person of the crowd. Drafts are painted from small copies of the
+ * person images.
+ * @param aPlacement The person's placement in the crowd image being painted.
+ * @param uncovered true to paint only pixels no nearer person has painted.
+ * @return true if the person image was read, else false.
+ */
+bool CrowdMaker::paintPerson(const Placement& aPlacement, bool uncovered) {
+    wxString aFilePath = Tools::crowd3Folder() + SEPARATOR + aPlacement.file;
+    return myCompositor->paintPerson(aFilePath, aPlacement, myCanvasScale < 1.0, uncovered);
 }
 
 /**
- * Return the assembled crowd image.
+ * Return the assembled crowd image. Its pixels are shared with the
+ * compositor, not copied; the next render paints a new image.
  * @return The crowd image.
  */
-wxImage CrowdMaker::getCrowdImage() {
-    return *myCrowd;
+SharedImage CrowdMaker::getCrowdImage() {
+    return myCompositor->getImage();
 }
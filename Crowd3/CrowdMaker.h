@@ -32,11 +32,55 @@
 
 #include <wx/wx.h>
 #include <wx/dir.h>
-#include <wx/progdlg.h>
 #include "const.h"
-#include "PeopleFinder.h"
+#include "ScanEngine.h"
 #include "Tools.h"
 #include "Settings.h"
+#include "Compositor.h"
+#include "LayerCache.h"
+#include "SpriteAtlas.h"
+#include "ImageBands.h"
+#include <vector>
+#include <map>
+
+/** The most people a crowd may have. */
+const wxInt32 MAXPEOPLE = 100000;
+
+/** Crowds of more people are massive: painted from shared sprites. */
+const wxInt32 MASSIVECROWD = 2000;
+
+/** The row to row perspective factor of massive crowds. */
+const double MASSIVEPERFACTOR = 0.99;
+
+/** Massive crowds are painted in square canvas tiles of this size. */
+const wxInt32 SPRITETILE = 128;
+
+/** Crowd images rendered to a file are painted in bands of this many rows. */
+const wxInt32 BANDROWS = 256;
+
+/** Crowd images of more pixels are rendered to a file in bands when saved. */
+const double BANDEDPIXELS = 64e6;
+
+/** Receives progress reports while a CrowdMaker paints a crowd image. The
+ * reports come from the thread that called renderCrowdImage(). */
+class CrowdListener {
+public:
+    virtual ~CrowdListener() {}
+
+    /**
+     * Called after each person is added to the crowd image.
+     * @param peopleAdded The number of people added so far.
+     * @return false to stop painting, else true.
+     */
+    virtual bool personAdded(wxInt32 peopleAdded) = 0;
+
+    /**
+     * Called once the background is ready and again after each crowd row
+     * is painted.
+     * @param aCrowd The compositor holding the partly painted crowd image.
+     */
+    virtual void rowAdded(Compositor& aCrowd) = 0;
+};
 
 /** Create a crowd image using people images extracted by the PeopleFinder.<p>
  * The CrowdMaker recognizes a set of user options.<p>
@@ -47,7 +91,22 @@
  * c.setPeopleCount();<p>
  * c.setPerspective();<p>
  * c.makeCrowdImage(); or c.shuffle();<p>
- * c.getCrowdImage());<p></code>
+ * c.renderCrowdImage(listener);<p>
+ * c.getCrowdImage());<p>
+ * c.replacePeople(1); or c.swapPeople(1);<p>
+ * c.renderCrowdImage(listener);<p></code>
+ * After small edits such as replacePeople() and swapPeople(), the next render
+ * revises the previous crowd image: only the areas around the changed people
+ * are repainted. With setLayeredRows(), each crowd row is painted into its
+ * own cached layer instead, and unchanged rows are reused by later renders.
+ * Crowds of more than MASSIVECROWD people are painted from sprites.
+ * renderToFile() paints the crowd image at full resolution straight into a
+ * file, band by band, for crowd images too large to hold in memory.
+ * The pixels are painted by a Compositor, chosen with setCompositor().
+ * makeCrowdImage() and shuffle() use the user interface and must be called
+ * on the main thread. renderCrowdImage() and renderToFile() may run on any one
+ * thread, so files that cannot be read are not logged but kept for
+ * takeReadErrors(), to be logged on the main thread once the render is over.
  */
 class CrowdMaker {
 public:
@@ -62,14 +121,52 @@ public:
     wxInt32 getPeopleCount();
     void setPerspective(bool perSetting);
     bool getPerspective();
-    void makeCrowdImage(wxFrame *p);
-    void shuffle(wxFrame *p);
-    wxImage getCrowdImage();
+    void setOcclusionCulling(bool cullSetting);
+    bool getOcclusionCulling();
+    void setIncremental(bool incrementalSetting);
+    bool getIncremental();
+    void setLayeredRows(bool layeredSetting);
+    bool getLayeredRows();
+    void setCompositor(wxString name);
+    wxString getCompositor();
+    void setDraftSize(wxSize aSize);
+    bool isDraft();
+    bool makeCrowdImage();
+    bool makeCrowdImage(wxArrayString *files);
+    bool shuffle();
+    bool replacePeople(wxInt32 aCount);
+    bool swapPeople(wxInt32 aCount);
+    bool renderCrowdImage(CrowdListener *listener);
+    bool renderToFile(const string& path, const ExportOptions& options,
+                      CrowdListener *listener);
+    SharedImage getCrowdImage();
+    std::vector<string> takeReadErrors();
 private:
     void loadAllSettings();
     void saveAllSettings();
-    void assembleTheImage(wxFrame *p);
-    void crowdMerge(wxImage *aPerson, wxInt32 mRow, wxInt32 mCol);
+    bool assembleTheImage();
+    bool canRevise();
+    bool reviseTheImage();
+    void blurDepth(const wxRect *area);
+    bool paintInLayers();
+    bool paintMassive();
+    wxInt32 rowBlur(wxInt32 row, wxInt32 rowCount);
+    static void spriteLook(wxInt32 member, bool& mirror, wxInt32 tint[3]);
+    static wxInt32 blurReach(wxInt32 radius);
+    wxRect canvasArea(const wxRect& aRect);
+    void readFailed(const wxString& path);
+    void personChanged(wxInt32 member);
+    void markDirty(wxRect aRect);
+    bool prepareCanvas();
+    double canvasScale();
+    wxInt32 canvasLength(wxInt32 aLength);
+    Placement onCanvas(const Placement& aPlacement);
+    void layoutTheCrowd();
+    bool placePerson(const wxString& aFile, wxInt32 row, wxInt32 left,
+                     Placement& aPlacement);
+    bool paintBackToFront();
+    bool paintFrontToBack();
+    bool paintPerson(const Placement& aPlacement, bool uncovered);
     
     WX_DEFINE_ARRAY_INT(wxInt32, ArrayOfInts);
     WX_DEFINE_ARRAY_DOUBLE(double, ArrayOfDoubles);
@@ -98,11 +195,77 @@ private:
     /** The list of images used in the current crowd scene. */
     wxArrayString *myCurrentCrowd;
     
-    /** The Crowd scene object. */
-    wxImage *myCrowd;
+    /** Where each person of myCurrentCrowd appears in the crowd image, in
+     * back-to-front painting order. */
+    std::vector<Placement> myLayout;
+    
+    /** Must myLayout be recomputed before the next paint? true==yes. */
+    bool myLayoutStale;
+    
+    /** The scale of the people in each crowd row, front row first. Set with
+     * myLayout. */
+    ArrayOfDoubles myRowScale;
+    
+    /** The top of each crowd row, front row first. Set with myLayout. */
+    ArrayOfInts myRowPosition;
+    
+    /** Keep what is needed to revise the crowd image after small edits?
+     * true==yes. */
+    bool myIncremental;
+    
+    /** Can the crowd image be revised rather than painted anew? true==yes. */
+    bool myRevisable;
+    
+    /** The draft size of the revisable crowd image, or wxDefaultSize if it is
+     * full resolution. */
+    wxSize myRevisableSize;
+    
+    /** Full resolution areas changed since the last render, none overlapping. */
+    std::vector<wxRect> myDirty;
+    
+    /** Paint each crowd row into its own cached layer? true==yes. */
+    bool myLayered;
+    
+    /** The row layers kept from earlier renders. */
+    LayerCache myLayers;
+    
+    /** The sprites of massive crowds. */
+    SpriteAtlas myAtlas;
+    
+    /** The size of each person image file in the layout, by file name. */
+    std::map<wxString, wxSize> myFileSizes;
+    
+    /** Paint a draft instead of the full resolution image? true==yes. */
+    bool myDraft;
+    
+    /** Drafts are scaled to fit this size. */
+    wxSize myDraftSize;
+    
+    /** Scale from full resolution to myCrowd. 1.0 unless painting a draft. */
+    double myCanvasScale;
+    
+    /** The background path of the draft background kept by myCompositor,
+     * or empty if none is kept. */
+    wxString myDraftBackgroundPath;
+    
+    /** The draft size the kept draft background was made for. */
+    wxSize myDraftBackgroundSize;
+    
+    /** The full resolution size of the kept draft background's image. */
+    wxSize myDraftBackgroundFullSize;
+
+    /** Paint front-to-back and skip hidden pixels and people? true==yes. */
+    bool myCulling;
+
+    /** Paints the crowd image and holds it. */
+    Compositor *myCompositor;
+    
+    /** The files that could not be read since takeReadErrors() was last
+     * called, as error messages. Compositors keep their own until asked. */
+    std::vector<string> myReadErrors;
     
-    /** A progress indicator while building a crowd image. */
-    wxProgressDialog *myProgress;
+    /** Receives progress reports while building a crowd image. */
+    CrowdListener *myListener;
 };
 
 #endif	/* CROWDMAKER_H */
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "CrowdRenderer.h"
+
+DEFINE_EVENT_TYPE(wxEVT_CROWD_PREVIEW)
+DEFINE_EVENT_TYPE(wxEVT_CROWD_DONE)
+
+/**
+ * Create a joinable crowd render thread. Call Run() to start it.
+ * @param handler The receiver of preview and done events.
+ * @param maker The crowd maker, with its crowd already chosen.
+ * @param previewSize Previews are scaled to fit this size.
+ * @param generation Copied into every event posted by this render.
+ */
+CrowdRenderer::CrowdRenderer(wxEvtHandler *handler, CrowdMaker *maker,
+        wxSize previewSize, long generation) : wxThread(wxTHREAD_JOINABLE) {
+    myHandler = handler;
+    myMaker = maker;
+    myPreviewSize = previewSize;
+    myGeneration = generation;
+    myPeopleAdded = 0;
+    myCancelled = false;
+}
+
+/** Ask the render to stop as soon as possible. Safe to call from any thread. */
+void CrowdRenderer::cancel() {
+    myCancelled = true;
+}
+
+/** Thread body: paint the crowd image and report the result. */
+wxThread::ExitCode CrowdRenderer::Entry() {
+    bool completed = myMaker->renderCrowdImage(this);
+    
+    wxCommandEvent done(wxEVT_CROWD_DONE);
+    done.SetInt(completed && ! myCancelled ? 1 : 0);
+    done.SetExtraLong(myGeneration);
+    wxPostEvent(myHandler, done);
+    return 0;
+}
+
+/**
+ * Called by the crowd maker after each person is added.
+ * @param peopleAdded The number of people added so far.
+ * @return false to stop painting.
+ */
+bool CrowdRenderer::personAdded(wxInt32 peopleAdded) {
+    myPeopleAdded = peopleAdded;
+    return ! myCancelled;
+}
+
+/**
+ * Called by the crowd maker after each crowd row is painted. Post a preview
+ * scaled to fit the preview size.
+ * @param aCrowd The compositor holding the partly painted crowd image.
+ */
+void CrowdRenderer::rowAdded(Compositor& aCrowd) {
+    if (myCancelled || aCrowd.getWidth() == 0 || aCrowd.getHeight() == 0) {
+        return;
+    }
+    
+    // Fit the preview inside myPreviewSize, preserving aspect ratio. Never enlarge.
+    double scale = min(myPreviewSize.GetWidth() / (double) aCrowd.getWidth(),
+                       myPreviewSize.GetHeight() / (double) aCrowd.getHeight());
+    scale = min(scale, 1.0);
+    wxInt32 w = max(1, (wxInt32) (aCrowd.getWidth() * scale));
+    wxInt32 h = max(1, (wxInt32) (aCrowd.getHeight() * scale));
+    
+    // The preview is a new image owned by the receiver of the event. Only the
+    // preview's pixels are copied out of the compositor.
+    wxCommandEvent preview(wxEVT_CROWD_PREVIEW);
+    preview.SetClientData(new wxImage(aCrowd.getPreview(w, h)));
+    preview.SetInt(myPeopleAdded);
+    preview.SetExtraLong(myGeneration);
+    wxPostEvent(myHandler, preview);
+}
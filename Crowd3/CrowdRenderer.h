@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CROWDRENDERER_H
+#define	CROWDRENDERER_H
+
+#include <wx/wx.h>
+#include <wx/thread.h>
+#include "CrowdMaker.h"
+
+/** Posted while a crowd image is being painted. GetClientData() is a new
+ * wxImage* preview that the receiver must delete, GetInt() is the number of
+ * people added so far, GetExtraLong() is the render's generation. */
+DECLARE_EVENT_TYPE(wxEVT_CROWD_PREVIEW, -1)
+
+/** Posted when a crowd image render ends. GetInt() is 1 if the crowd image
+ * is complete, 0 if the render was cancelled or failed. GetExtraLong() is the
+ * render's generation. */
+DECLARE_EVENT_TYPE(wxEVT_CROWD_DONE, -1)
+
+/**
+ * Paint a crowd image on a background thread so that the user interface stays
+ * responsive. Previews of the partly painted crowd are posted to an event
+ * handler after every crowd row.<p>
+ * Usage:<p><code>
+ * r = new CrowdRenderer(handler, crowdMaker, previewSize, generation);<p>
+ * r->Run();<p>
+ * ...handle wxEVT_CROWD_PREVIEW and wxEVT_CROWD_DONE events...<p>
+ * r->cancel(); r->Wait(); delete r;<p></code>
+ * The CrowdMaker must not be used by anyone else until the thread has ended.
+ */
+class CrowdRenderer : public wxThread, public CrowdListener {
+public:
+    CrowdRenderer(wxEvtHandler *handler, CrowdMaker *maker,
+            wxSize previewSize, long generation);
+    void cancel();
+    virtual bool personAdded(wxInt32 peopleAdded);
+    virtual void rowAdded(Compositor& aCrowd);
+
+protected:
+    virtual ExitCode Entry();
+
+private:
+    /** The receiver of preview and done events. */
+    wxEvtHandler *myHandler;
+
+    /** The crowd maker doing the painting. */
+    CrowdMaker *myMaker;
+
+    /** Previews are scaled to fit this size. */
+    wxSize myPreviewSize;
+
+    /** Identifies this render's events among those of earlier renders. */
+    long myGeneration;
+
+    /** The number of people added so far. */
+    wxInt32 myPeopleAdded;
+
+    /** Set by cancel() to stop painting. */
+    volatile bool myCancelled;
+};
+
+#endif	/* CROWDRENDERER_H */
+
@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "FaceDetector.h"
+#include <fstream>
+#include <iterator>
+#include <cstdio>
+
+/** The DNN model's input is scaled to this size. */
+const wxInt32 DNNINPUTSIZE = 300;
+
+/** DNN detections below this confidence are ignored. */
+const double DNNCONFIDENCE = 0.6;
+
+/**
+ * Create a face detector and load its data file. Safe on any thread.
+ * @param name One of the DETECTOR_ constants.
+ * @param dataFolder The folder holding the detector data files, with a
+ * trailing separator.
+ * @param cacheFolder The folder for converted cascades, with a trailing separator.
+ * @param error The returned reason if the detector could not be created.
+ * @return The detector, or NULL if it is unknown or could not be loaded.
+ */
+FaceDetector* FaceDetector::create(const string& name, const string& dataFolder,
+                                   const string& cacheFolder, string& error) {
+    if (name == DETECTOR_HAAR || name == DETECTOR_LBP) {
+        bool haar = (name == DETECTOR_HAAR);
+        CascadeDetector *d = new CascadeDetector(name,
+                dataFolder + (haar ? FACECASCADENAME : FACELBPNAME),
+                cacheFolder, haar ? 10 : 4);
+        if (d->isLoaded()) {
+            return d;
+        }
+        delete d;
+        error = dataFolder + (haar ? FACECASCADENAME : FACELBPNAME) +
+                "\nThe cascade file could not be loaded";
+        return NULL;
+    }
+#ifdef HAVE_OPENCV_DNN
+    if (name == DETECTOR_DNN) {
+        DnnDetector *d = new DnnDetector(dataFolder + FACEDNNNAME);
+        if (d->isLoaded()) {
+            return d;
+        }
+        delete d;
+        error = dataFolder + FACEDNNNAME + "\nThe face model could not be loaded";
+        return NULL;
+    }
+#endif
+    error = name + "\nUnknown face detector";
+    return NULL;
+}
+
+/**
+ * Get the face detectors that can be created. The Haar cascade is installed
+ * with Crowd3, so the Haar detector is always listed; the others only if
+ * their data file has been put in the data folder.
+ * @param dataFolder The folder holding the detector data files, with a
+ * trailing separator.
+ * @return The names of the face detectors in this build with data files.
+ */
+vector<string> FaceDetector::available(const string& dataFolder) {
+    vector<string> names;
+    names.push_back(DETECTOR_HAAR);
+    if (ifstream((dataFolder + FACELBPNAME).c_str()).good()) {
+        names.push_back(DETECTOR_LBP);
+    }
+#ifdef HAVE_OPENCV_DNN
+    if (ifstream((dataFolder + FACEDNNNAME).c_str()).good()) {
+        names.push_back(DETECTOR_DNN);
+    }
+#endif
+    return names;
+}
+
+/**
+ * Create a cascade face detector. A cascade in the old Haar format is loaded
+ * from its converted copy in the cache folder, made on first use.
+ * @param name The detector's name.
+ * @param cascadeFile The cascade file path.
+ * @param cacheFolder The folder for converted cascades, with a trailing separator.
+ * @param minNeighbors The number of overlapping detections needed to accept a face.
+ */
+CascadeDetector::CascadeDetector(const string& name, const string& cascadeFile,
+                                 const string& cacheFolder, wxInt32 minNeighbors) {
+    myName = name;
+    myMinNeighbors = minNeighbors;
+    string cached = cachedCascade(cascadeFile, cacheFolder);
+    myLoaded = ( ! cached.empty() && myCascade.load(cached)) || myCascade.load(cascadeFile);
+}
+
+/**
+ * Find or make the converted copy of an old format Haar cascade. The old
+ * format is parsed node by node and converted on every load; the current
+ * format is a fraction of the size and loads directly. The copy is named
+ * after a hash of the cascade file, so a changed cascade gets a new copy.
+ * @param cascadeFile The cascade file path.
+ * @param cacheFolder The folder for converted cascades, with a trailing separator.
+ * @return The converted copy's path, or empty if the cascade is already in
+ * the current format or could not be converted.
+ */
+string CascadeDetector::cachedCascade(const string& cascadeFile, const string& cacheFolder) {
+#if CV_MAJOR_VERSION >= 3
+    ifstream in(cascadeFile.c_str(), ios::in | ios::binary);
+    string xml((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    if (xml.empty() || xml.find("opencv-haar-classifier") == string::npos) {
+        return "";
+    }
+    
+    // 64 bit FNV-1a hash of the cascade file.
+    unsigned long long hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < xml.size(); i++) {
+        hash = (hash ^ (unsigned char) xml[i]) * 1099511628211ULL;
+    }
+    char hex[17];
+    sprintf(hex, "%016llx", hash);
+    string cached = cacheFolder + "cascade_" + hex + ".xml";
+    if (ifstream(cached.c_str()).good()) {
+        return cached;
+    }
+    
+    // Convert to a temporary name first, so that a half written copy is
+    // never loaded.
+    string temporary = cached + ".tmp";
+    if (CascadeClassifier::convert(cascadeFile, temporary) &&
+            rename(temporary.c_str(), cached.c_str()) == 0) {
+        return cached;
+    }
+    remove(temporary.c_str());
+#endif
+    return "";
+}
+
+/** @return true if the cascade file was loaded. */
+bool CascadeDetector::isLoaded() {
+    return myLoaded;
+}
+
+/** Search for faces with the cascade. See FaceDetector::detect(). */
+vector<Rect> CascadeDetector::detect(const Mat& gray, const Mat& color, wxInt32 minSize) {
+    vector<Rect> faces;
+    myCascade.detectMultiScale(gray, faces, 1.1, myMinNeighbors,
+            0 |CV_HAAR_SCALE_IMAGE, Size(minSize, minSize));
+    return faces;
+}
+
+/** @return The detector's name. */
+string CascadeDetector::name() {
+    return myName;
+}
+
+#ifdef HAVE_OPENCV_DNN
+/**
+ * Create a DNN face detector. The model runs on the CPU.
+ * @param modelFile The model file path.
+ */
+DnnDetector::DnnDetector(const string& modelFile) {
+    try {
+        myNet = dnn::readNet(modelFile);
+        myNet.setPreferableBackend(dnn::DNN_BACKEND_OPENCV);
+        myNet.setPreferableTarget(dnn::DNN_TARGET_CPU);
+    }
+    catch (Exception e) {
+        myNet = dnn::Net();
+    }
+}
+
+/** @return true if the model was loaded. */
+bool DnnDetector::isLoaded() {
+    return ! myNet.empty();
+}
+
+/** Search for faces with the model. See FaceDetector::detect(). */
+vector<Rect> DnnDetector::detect(const Mat& gray, const Mat& color, wxInt32 minSize) {
+    // The model wants 3-channel BGR.
+    Mat bgr = color;
+    if (color.channels() == 1) {
+        cvtColor(color, bgr, CV_GRAY2BGR);
+    }
+    else if (color.channels() == 4) {
+        cvtColor(color, bgr, CV_BGRA2BGR);
+    }
+    
+    Mat blob = dnn::blobFromImage(bgr, 1.0, Size(DNNINPUTSIZE, DNNINPUTSIZE),
+            Scalar(104.0, 177.0, 123.0), false, false);
+    myNet.setInput(blob);
+    Mat out = myNet.forward();
+    
+    // Each detection row: image id, class, confidence, then the corners as
+    // fractions of the image size. The colour image may be a smaller copy,
+    // so the corners are placed in the grayscale image.
+    Mat detections(out.size[2], out.size[3], CV_32F, out.ptr<float>());
+    vector<Rect> faces;
+    Rect bounds(0, 0, gray.cols, gray.rows);
+    for (wxInt32 i = 0; i < detections.rows; i++) {
+        if (detections.at<float>(i, 2) < DNNCONFIDENCE) {
+            continue;
+        }
+        wxInt32 x1 = detections.at<float>(i, 3) * gray.cols;
+        wxInt32 y1 = detections.at<float>(i, 4) * gray.rows;
+        wxInt32 x2 = detections.at<float>(i, 5) * gray.cols;
+        wxInt32 y2 = detections.at<float>(i, 6) * gray.rows;
+        Rect aFace = Rect(x1, y1, x2 - x1, y2 - y1) & bounds;
+        if (aFace.width >= minSize && aFace.height >= minSize) {
+            faces.push_back(aFace);
+        }
+    }
+    return faces;
+}
+
+/** @return The detector's name. */
+string DnnDetector::name() {
+    return DETECTOR_DNN;
+}
+#endif
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef FACEDETECTOR_H
+#define	FACEDETECTOR_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/objdetect/objdetect.hpp>
+#include <opencv2/opencv_modules.hpp>
+#ifdef HAVE_OPENCV_DNN
+#include <opencv2/dnn.hpp>
+#endif
+#include "CoreTools.h"
+#include <string>
+#include <vector>
+
+/** The Haar cascade face detector. Accurate, slow. */
+const string DETECTOR_HAAR = "Haar";
+
+/** The LBP cascade face detector. Several times faster than Haar on a CPU,
+ * with more missed faces. */
+const string DETECTOR_LBP = "LBP";
+
+/** The DNN face detector. Most accurate, needs OpenCV built with the dnn module. */
+const string DETECTOR_DNN = "DNN";
+
+/**
+ * Find faces in a grayscale image. One subclass per detection method.
+ * Detectors may be created on any thread, since loading their data files is
+ * slow, but each is then used by one thread at a time.<p>
+ * Usage:<p><code>
+ * FaceDetector *d = FaceDetector::create(DETECTOR_LBP, dataFolder, cacheFolder, error);<p>
+ * if (d != NULL) faces = d->detect(gray, color, minSize);<p>
+ * delete d;<p></code>
+ */
+class FaceDetector {
+public:
+    virtual ~FaceDetector() {}
+    
+    /**
+     * Search for faces.
+     * @param gray The image, 8-bit grayscale, histogram equalized.
+     * @param color The image, 8-bit BGR, or the gray image if it has no color.
+     * May be smaller than gray. Faces are always found in gray's coordinates.
+     * @param minSize Faces smaller than this many pixels wide are ignored.
+     * @return The face rectangles.
+     */
+    virtual vector<Rect> detect(const Mat& gray, const Mat& color, wxInt32 minSize) = 0;
+    
+    /** @return The detector's name, one of the DETECTOR_ constants. */
+    virtual string name() = 0;
+    
+    static FaceDetector* create(const string& name, const string& dataFolder,
+                                const string& cacheFolder, string& error);
+    static vector<string> available(const string& dataFolder);
+};
+
+/** Face detection with a Haar or LBP cascade file. */
+class CascadeDetector : public FaceDetector {
+public:
+    CascadeDetector(const string& name, const string& cascadeFile,
+                    const string& cacheFolder, wxInt32 minNeighbors);
+    bool isLoaded();
+    virtual vector<Rect> detect(const Mat& gray, const Mat& color, wxInt32 minSize);
+    virtual string name();
+
+private:
+    string cachedCascade(const string& cascadeFile, const string& cacheFolder);
+
+    /** The detector's name. */
+    string myName;
+    
+    /** The face detection cascade object. */
+    CascadeClassifier myCascade;
+    
+    /** The number of overlapping detections needed to accept a face. */
+    wxInt32 myMinNeighbors;
+    
+    /** true if the cascade file was loaded. */
+    bool myLoaded;
+};
+
+#ifdef HAVE_OPENCV_DNN
+/** Face detection with an SSD face model run by the OpenCV dnn module on the CPU. */
+class DnnDetector : public FaceDetector {
+public:
+    DnnDetector(const string& modelFile);
+    bool isLoaded();
+    virtual vector<Rect> detect(const Mat& gray, const Mat& color, wxInt32 minSize);
+    virtual string name();
+
+private:
+    /** The face model. */
+    dnn::Net myNet;
+};
+#endif
+
+#endif	/* FACEDETECTOR_H */
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "IDAllocator.h"
+
+/** Create an allocator with no IDs reserved yet. */
+IDAllocator::IDAllocator() {
+    myNext = 0;
+    myEnd = 0;
+}
+
+/**
+ * Reserve consecutive person image IDs. A new block is reserved from the image
+ * database when the current one cannot hold them all; the rest of the old
+ * block is abandoned.
+ * @param count The number of IDs.
+ * @param error Receives the error message on failure.
+ * @return The first ID, or -1 on failure.
+ */
+wxInt32 IDAllocator::reserve(wxInt32 count, string& error) {
+    if (myNext + count > myEnd) {
+        wxInt32 size = max(count, IDBLOCKSIZE);
+        wxInt32 first = ImageDB::reserveIDs(size, error);
+        if (first < 0) {
+            return -1;
+        }
+        myNext = first;
+        myEnd = first + size;
+    }
+    wxInt32 first = myNext;
+    myNext = myNext + count;
+    return first;
+}
+
+/** Give the unused IDs of the current block back to the image database. */
+void IDAllocator::release() {
+    if (myNext < myEnd) {
+        ImageDB::returnIDs(myNext, myEnd);
+    }
+    myNext = 0;
+    myEnd = 0;
+}
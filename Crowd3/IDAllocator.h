@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef IDALLOCATOR_H
+#define	IDALLOCATOR_H
+
+#include "ImageDB.h"
+
+/** Person image IDs are reserved from the image database this many at a time. */
+const wxInt32 IDBLOCKSIZE = 256;
+
+/**
+ * Hand out person image IDs from blocks reserved in the image database. Each
+ * scanning thread owns its own allocator, so reserve() takes no lock and only
+ * touches the database when its block runs out.<p>
+ * Usage:<p><code>
+ * IDAllocator ids;<p>
+ * first = ids.reserve(count, error);<p>
+ * ...<p>
+ * ids.release(); // Give back the unused IDs when scanning is done.<p></code>
+ */
+class IDAllocator {
+public:
+    IDAllocator();
+    wxInt32 reserve(wxInt32 count, string& error);
+    void release();
+
+private:
+    /** The next ID to hand out. */
+    wxInt32 myNext;
+
+    /** One past the last ID of the current block. */
+    wxInt32 myEnd;
+};
+
+#endif	/* IDALLOCATOR_H */
@@ -0,0 +1,494 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "ImageBands.h"
+#include "ImageDecoder.h"
+#include "JpegHeader.h"
+#include <opencv2/imgproc/imgproc.hpp>
+#include <cctype>
+#include <cstring>
+
+/**
+ * libjpeg error exit: jump back to the call that set the recovery point.
+ * @param info The failing encoder or decoder.
+ */
+static void jumpOnError(j_common_ptr info) {
+    JpegErrors *errors = (JpegErrors*) info->err;
+    longjmp(errors->recovery, 1);
+}
+
+/**
+ * Does a file path end with an extension, in any case?
+ * @param path The file path.
+ * @param extension The lower case extension, with its dot.
+ * @return true if it does.
+ */
+static bool hasExtension(const string& path, const char *extension) {
+    size_t length = strlen(extension);
+    if (path.size() < length) {
+        return false;
+    }
+    for (size_t i = 0; i < length; i++) {
+        if (tolower((unsigned char) path[path.size() - length + i]) != extension[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Create a reader with no file open. */
+BandReader::BandReader() {
+    myFile = NULL;
+    memset(&myJpeg, 0, sizeof(myJpeg));
+    myKeptTop = 0;
+    myWidth = 0;
+    myHeight = 0;
+    myShrink = 1;
+}
+
+/** Close the file, if any. */
+BandReader::~BandReader() {
+    close();
+}
+
+/**
+ * Open an image file for reading in bands.
+ * @param path The file path.
+ * @param shrink 1 to read the image at full size, or 2, 4 or 8 to read upright
+ * JPEG files that many times smaller, rounded up. Other files are read at full
+ * size; see getWidth() and getHeight().
+ * @return false if the file could not be read, else true.
+ */
+bool BandReader::open(const string& path, wxInt32 shrink) {
+    close();
+    const ImageDecoder *decoder = ImageDecoder::find(path);
+    if (decoder == NULL) {
+        return false;
+    }
+    if (decoder->name() == "JPEG") {
+        JpegHeader header;
+        if (header.read(path) && header.getOrientation() == 1 &&
+                startJpeg(path, shrink)) {
+            return true;
+        }
+    }
+    
+    // Decoded whole, as the decoder would for a crowd image background.
+    Mat decoded = decoder->decode(path, CV_LOAD_IMAGE_COLOR);
+    if (decoded.empty()) {
+        return false;
+    }
+    cvtColor(decoded, myWhole, CV_BGR2RGB);
+    myWidth = myWhole.cols;
+    myHeight = myWhole.rows;
+    return true;
+}
+
+/**
+ * Start decoding a JPEG file scanline by scanline.
+ * @param path The file path.
+ * @param shrink 1, 2, 4 or 8.
+ * @return false if the file could not be read, else true.
+ */
+bool BandReader::startJpeg(const string& path, wxInt32 shrink) {
+    myFile = fopen(path.c_str(), "rb");
+    if (myFile == NULL) {
+        return false;
+    }
+    memset(&myJpeg, 0, sizeof(myJpeg));
+    myJpeg.err = jpeg_std_error(&myErrors.manager);
+    myErrors.manager.error_exit = jumpOnError;
+    if (setjmp(myErrors.recovery)) {
+        close();
+        return false;
+    }
+    jpeg_create_decompress(&myJpeg);
+    jpeg_stdio_src(&myJpeg, myFile);
+    jpeg_read_header(&myJpeg, TRUE);
+    myJpeg.out_color_space = JCS_RGB;
+    myJpeg.scale_num = 1;
+    myJpeg.scale_denom = shrink;
+    jpeg_start_decompress(&myJpeg);
+    myWidth = myJpeg.output_width;
+    myHeight = myJpeg.output_height;
+    myShrink = shrink;
+    myKeptTop = 0;
+    return true;
+}
+
+/** @return The width of the rows read. */
+wxInt32 BandReader::getWidth() {
+    return myWidth;
+}
+
+/** @return The number of rows that can be read. */
+wxInt32 BandReader::getHeight() {
+    return myHeight;
+}
+
+/** @return How many times smaller the rows are than the image: 1 unless a
+ * JPEG file is shrunk while it is decoded. */
+wxInt32 BandReader::getShrink() {
+    return myShrink;
+}
+
+/**
+ * Read a band of rows. Bands must be read top to bottom. A band may start
+ * above the end of the previous band, but not above its start, as only the
+ * previous band's rows are kept.
+ * @param top The band's first row.
+ * @param rows The band's height.
+ * @param rgb The returned band, 8-bit RGB. Not shared with the reader.
+ * @return false if the rows could not be read, else true.
+ */
+bool BandReader::read(wxInt32 top, wxInt32 rows, Mat& rgb) {
+    if (top < 0 || rows <= 0 || top + rows > myHeight) {
+        return false;
+    }
+    if ( ! myWhole.empty()) {
+        rgb = myWhole.rowRange(top, top + rows).clone();
+        return true;
+    }
+    if (myFile == NULL || top < myKeptTop) {
+        return false;
+    }
+    
+    // Reuse the kept rows, skip any rows between them and the band, then
+    // decode the rest of the band.
+    Mat band(rows, myWidth, CV_8UC3);
+    wxInt32 next = top;
+    wxInt32 keptEnd = myKeptTop + myKept.rows;
+    if (next < keptEnd) {
+        wxInt32 count = min(keptEnd, top + rows) - next;
+        Mat target = band.rowRange(0, count);
+        myKept.rowRange(next - myKeptTop, next - myKeptTop + count).copyTo(target);
+        next += count;
+    }
+    while ((wxInt32) myJpeg.output_scanline < next) {
+        if ( ! readScanline(band.ptr(0))) {
+            return false;
+        }
+    }
+    for (; next < top + rows; next++) {
+        if ( ! readScanline(band.ptr(next - top))) {
+            return false;
+        }
+    }
+    myKept = band.clone();
+    myKeptTop = top;
+    rgb = band;
+    return true;
+}
+
+/**
+ * Decode the next JPEG scanline.
+ * @param row Where to put it.
+ * @return false if the file is damaged, else true.
+ */
+bool BandReader::readScanline(unsigned char *row) {
+    if (setjmp(myErrors.recovery)) {
+        return false;
+    }
+    JSAMPROW rows[] = {row};
+    return jpeg_read_scanlines(&myJpeg, rows, 1) == 1;
+}
+
+/** Close the file and forget its rows. */
+void BandReader::close() {
+    if (myFile != NULL) {
+        jpeg_destroy_decompress(&myJpeg);
+        fclose(myFile);
+        myFile = NULL;
+    }
+    myWhole.release();
+    myKept.release();
+    myKeptTop = 0;
+    myWidth = 0;
+    myHeight = 0;
+    myShrink = 1;
+}
+
+/** Create a writer with no file open. */
+BandWriter::BandWriter() {
+    myFormat = JPEG;
+    myWidth = 0;
+    myHeight = 0;
+    myRow = 0;
+    myFile = NULL;
+    memset(&myJpeg, 0, sizeof(myJpeg));
+    myPng = NULL;
+    myPngInfo = NULL;
+    myTiff = NULL;
+}
+
+/** Delete the file if it was never closed. */
+BandWriter::~BandWriter() {
+    abort();
+}
+
+/**
+ * Create an image file to be written in bands.
+ * @param path The file path. The extension selects the format.
+ * @param width The image width.
+ * @param height The image height.
+ * @param options The encoder settings.
+ * @return false if the file could not be created, or the format cannot hold
+ * an image of this size, else true.
+ */
+bool BandWriter::open(const string& path, wxInt32 width, wxInt32 height,
+                      const ExportOptions& options) {
+    abort();
+    myPath = path;
+    myWidth = width;
+    myHeight = height;
+    myRow = 0;
+    if (hasExtension(path, ".png")) {
+        myFormat = PNG;
+    }
+    else if (hasExtension(path, ".tif") || hasExtension(path, ".tiff")) {
+        myFormat = TIFF;
+    }
+    else {
+        myFormat = JPEG;
+    }
+    
+    if (myFormat == TIFF) {
+        // Horizontally predicted LZW strips of about 8 KB.
+        myTiff = TIFFOpen(path.c_str(), "w");
+        if (myTiff == NULL) {
+            return false;
+        }
+        TIFFSetField(myTiff, TIFFTAG_IMAGEWIDTH, (uint32) width);
+        TIFFSetField(myTiff, TIFFTAG_IMAGELENGTH, (uint32) height);
+        TIFFSetField(myTiff, TIFFTAG_BITSPERSAMPLE, 8);
+        TIFFSetField(myTiff, TIFFTAG_SAMPLESPERPIXEL, 3);
+        TIFFSetField(myTiff, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
+        TIFFSetField(myTiff, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+        TIFFSetField(myTiff, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT);
+        TIFFSetField(myTiff, TIFFTAG_COMPRESSION, COMPRESSION_LZW);
+        TIFFSetField(myTiff, TIFFTAG_PREDICTOR, 2);
+        TIFFSetField(myTiff, TIFFTAG_ROWSPERSTRIP, TIFFDefaultStripSize(myTiff, 0));
+        return true;
+    }
+    myFile = fopen(path.c_str(), "wb");
+    if (myFile == NULL) {
+        return false;
+    }
+    bool started = myFormat == PNG ? startPng(options) : startJpeg(options);
+    if ( ! started) {
+        abort();
+    }
+    return started;
+}
+
+/**
+ * Start a baseline JPEG encoder.
+ * @param options The encoder settings.
+ * @return false if the image is too large for JPEG or encoding failed.
+ */
+bool BandWriter::startJpeg(const ExportOptions& options) {
+    if (myWidth > JPEG_MAX_DIMENSION || myHeight > JPEG_MAX_DIMENSION) {
+        return false;
+    }
+    memset(&myJpeg, 0, sizeof(myJpeg));
+    myJpeg.err = jpeg_std_error(&myErrors.manager);
+    myErrors.manager.error_exit = jumpOnError;
+    if (setjmp(myErrors.recovery)) {
+        return false;
+    }
+    jpeg_create_compress(&myJpeg);
+    jpeg_stdio_dest(&myJpeg, myFile);
+    myJpeg.image_width = myWidth;
+    myJpeg.image_height = myHeight;
+    myJpeg.input_components = 3;
+    myJpeg.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&myJpeg);
+    jpeg_set_quality(&myJpeg, options.jpegQuality, TRUE);
+    myJpeg.restart_in_rows = options.jpegRestartInterval;
+    jpeg_start_compress(&myJpeg, TRUE);
+    return true;
+}
+
+/**
+ * Start a non-interlaced PNG encoder.
+ * @param options The encoder settings.
+ * @return false if encoding failed.
+ */
+bool BandWriter::startPng(const ExportOptions& options) {
+    myPng = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    if (myPng == NULL) {
+        return false;
+    }
+    myPngInfo = png_create_info_struct(myPng);
+    if (myPngInfo == NULL) {
+        return false;
+    }
+    if (setjmp(png_jmpbuf(myPng))) {
+        return false;
+    }
+    png_init_io(myPng, myFile);
+    png_set_compression_level(myPng, options.pngCompression);
+    png_set_IHDR(myPng, myPngInfo, myWidth, myHeight, 8, PNG_COLOR_TYPE_RGB,
+                 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT,
+                 PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(myPng, myPngInfo);
+    return true;
+}
+
+/**
+ * Write the next band of rows.
+ * @param rgb The band, 8-bit RGB, as wide as the image.
+ * @return false if the band does not fit the image or could not be written.
+ */
+bool BandWriter::write(const Mat& rgb) {
+    if (myFile == NULL && myTiff == NULL) {
+        return false;
+    }
+    if (rgb.type() != CV_8UC3 || rgb.cols != myWidth || myRow + rgb.rows > myHeight) {
+        return false;
+    }
+    bool written = true;
+    if (myFormat == TIFF) {
+        for (wxInt32 y = 0; y < rgb.rows && written; y++) {
+            written = TIFFWriteScanline(myTiff, (void*) rgb.ptr(y), myRow + y, 0) >= 0;
+        }
+    }
+    else {
+        written = myFormat == PNG ? writePng(rgb) : writeJpeg(rgb);
+    }
+    myRow += rgb.rows;
+    return written;
+}
+
+/**
+ * Encode rows as JPEG.
+ * @param rgb The rows.
+ * @return false if encoding failed.
+ */
+bool BandWriter::writeJpeg(const Mat& rgb) {
+    if (setjmp(myErrors.recovery)) {
+        return false;
+    }
+    for (wxInt32 y = 0; y < rgb.rows; y++) {
+        JSAMPROW rows[] = {(JSAMPROW) rgb.ptr(y)};
+        jpeg_write_scanlines(&myJpeg, rows, 1);
+    }
+    return true;
+}
+
+/**
+ * Encode rows as PNG.
+ * @param rgb The rows.
+ * @return false if encoding failed.
+ */
+bool BandWriter::writePng(const Mat& rgb) {
+    if (setjmp(png_jmpbuf(myPng))) {
+        return false;
+    }
+    for (wxInt32 y = 0; y < rgb.rows; y++) {
+        png_write_row(myPng, (png_bytep) rgb.ptr(y));
+    }
+    return true;
+}
+
+/**
+ * Finish and close the file. A file missing rows is deleted.
+ * @return true if every row was written and the file is complete.
+ */
+bool BandWriter::close() {
+    if (myFile == NULL && myTiff == NULL) {
+        return false;
+    }
+    bool written = myRow == myHeight;
+    if (written && myFormat == JPEG) {
+        written = finishJpeg();
+    }
+    else if (written && myFormat == PNG) {
+        written = finishPng();
+    }
+    if (written && myFile != NULL) {
+        written = fflush(myFile) == 0 && ! ferror(myFile);
+    }
+    release();
+    if ( ! written) {
+        remove(myPath.c_str());
+    }
+    return written;
+}
+
+/**
+ * Finish the JPEG encoder's output.
+ * @return false if encoding failed.
+ */
+bool BandWriter::finishJpeg() {
+    if (setjmp(myErrors.recovery)) {
+        return false;
+    }
+    jpeg_finish_compress(&myJpeg);
+    return true;
+}
+
+/**
+ * Finish the PNG encoder's output.
+ * @return false if encoding failed.
+ */
+bool BandWriter::finishPng() {
+    if (setjmp(png_jmpbuf(myPng))) {
+        return false;
+    }
+    png_write_end(myPng, NULL);
+    return true;
+}
+
+/** Close and delete the file, if one is open. */
+void BandWriter::abort() {
+    if (myFile == NULL && myTiff == NULL) {
+        return;
+    }
+    release();
+    remove(myPath.c_str());
+}
+
+/** Free the encoder and close the file, without finishing it. */
+void BandWriter::release() {
+    if (myFormat == JPEG && myFile != NULL) {
+        jpeg_destroy_compress(&myJpeg);
+    }
+    if (myPng != NULL) {
+        png_destroy_write_struct(&myPng, &myPngInfo);
+    }
+    if (myFile != NULL) {
+        fclose(myFile);
+        myFile = NULL;
+    }
+    if (myTiff != NULL) {
+        TIFFClose(myTiff);
+        myTiff = NULL;
+    }
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef IMAGEBANDS_H
+#define	IMAGEBANDS_H
+
+#include "CoreTools.h"
+#include <cstdio>
+#include <csetjmp>
+#include <jpeglib.h>
+#include <png.h>
+#include <tiffio.h>
+
+/** Encoder settings for a crowd image export. */
+struct ExportOptions {
+    /** JPEG quality, 0 to 100. */
+    wxInt32 jpegQuality;
+    
+    /** Write a progressive JPEG. */
+    bool jpegProgressive;
+    
+    /** JPEG restart interval in MCU rows, or 0 for none. */
+    wxInt32 jpegRestartInterval;
+    
+    /** PNG zlib compression level, 0 to 9. */
+    wxInt32 pngCompression;
+};
+
+/** A libjpeg error manager that jumps back to the failing call's caller
+ * instead of ending the program. */
+struct JpegErrors {
+    /** The libjpeg error manager. Must be first. */
+    jpeg_error_mgr manager;
+    
+    /** Where to jump to on an error. */
+    jmp_buf recovery;
+};
+
+/**
+ * Read an image file in horizontal bands of rows, top to bottom, so that an
+ * image far larger than memory can be used band by band. Upright JPEG files
+ * are decoded scanline by scanline and only the rows still wanted are kept;
+ * JPEG files can also be shrunk by 2, 4 or 8 while they are decoded. Files of
+ * other formats, and JPEG files with an EXIF orientation, are decoded whole by
+ * their ImageDecoder. Uses no wxWidgets objects, so it may be used on any
+ * thread.<p>
+ * Usage:<p><code>
+ * BandReader r;<p>
+ * if (r.open(path, 1)) r.read(top, rows, band); ...<p></code>
+ */
+class BandReader {
+public:
+    BandReader();
+    virtual ~BandReader();
+    bool open(const string& path, wxInt32 shrink);
+    wxInt32 getWidth();
+    wxInt32 getHeight();
+    wxInt32 getShrink();
+    bool read(wxInt32 top, wxInt32 rows, Mat& rgb);
+    void close();
+
+private:
+    bool startJpeg(const string& path, wxInt32 shrink);
+    bool readScanline(unsigned char *row);
+    
+    /** The JPEG file being decoded, or NULL. */
+    FILE *myFile;
+    
+    /** The JPEG decoder. Valid while myFile is open. */
+    jpeg_decompress_struct myJpeg;
+    
+    /** The JPEG decoder's error manager. */
+    JpegErrors myErrors;
+    
+    /** A file decoded whole, 8-bit RGB, or empty if streamed. */
+    Mat myWhole;
+    
+    /** Rows decoded but possibly wanted again, 8-bit RGB. */
+    Mat myKept;
+    
+    /** The image row of myKept's first row. */
+    wxInt32 myKeptTop;
+    
+    /** The width of the rows read. */
+    wxInt32 myWidth;
+    
+    /** The number of rows read. */
+    wxInt32 myHeight;
+    
+    /** How many times smaller the rows are than the image. */
+    wxInt32 myShrink;
+};
+
+/**
+ * Write an image file from horizontal bands of rows, top to bottom, so that
+ * an image far larger than memory can be written band by band. The format is
+ * chosen by the file extension: .png files are written as PNG, .tif and .tiff
+ * files as TIFF, all others as JPEG. JPEG files are always baseline, as a
+ * progressive encoder keeps every coefficient of the image in memory. Uses no
+ * wxWidgets objects, so it may be used on any thread.<p>
+ * Usage:<p><code>
+ * BandWriter w;<p>
+ * w.open(path, width, height, options);<p>
+ * w.write(band); ...<p>
+ * w.close(); or w.abort();<p></code>
+ */
+class BandWriter {
+public:
+    BandWriter();
+    virtual ~BandWriter();
+    bool open(const string& path, wxInt32 width, wxInt32 height,
+              const ExportOptions& options);
+    bool write(const Mat& rgb);
+    bool close();
+    void abort();
+
+private:
+    /** The file formats written. */
+    enum Format {JPEG, PNG, TIFF};
+    
+    bool startJpeg(const ExportOptions& options);
+    bool startPng(const ExportOptions& options);
+    bool writeJpeg(const Mat& rgb);
+    bool writePng(const Mat& rgb);
+    bool finishJpeg();
+    bool finishPng();
+    void release();
+    
+    /** The file path. */
+    string myPath;
+    
+    /** The file format. */
+    Format myFormat;
+    
+    /** The image width. */
+    wxInt32 myWidth;
+    
+    /** The image height. */
+    wxInt32 myHeight;
+    
+    /** The number of rows written so far. */
+    wxInt32 myRow;
+    
+    /** The JPEG or PNG file, or NULL. */
+    FILE *myFile;
+    
+    /** The JPEG encoder. Valid while a JPEG myFile is open. */
+    jpeg_compress_struct myJpeg;
+    
+    /** The JPEG encoder's error manager. */
+    JpegErrors myErrors;
+    
+    /** The PNG encoder, or NULL. */
+    png_structp myPng;
+    
+    /** The PNG encoder's image information, or NULL. */
+    png_infop myPngInfo;
+    
+    /** The TIFF file, or NULL. */
+    TIFF *myTiff;
+};
+
+#endif	/* IMAGEBANDS_H */
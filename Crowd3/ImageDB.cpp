@@ -28,40 +28,61 @@
  */
 
 #include "ImageDB.h"
+#include <wx/thread.h>
 
 /** The (sqlite) image database. */
 sqlite3 *myImageDB;
 
+/**
+ * Serializes use of the database connection by different threads, so no
+ * statement lands inside another thread's ID reservation transaction.
+ */
+wxMutex dbLock;
+
+/**
+ * Milliseconds to wait for another Crowd3 process to release the database
+ * before a statement fails as busy.
+ */
+const int DBBUSYTIMEOUT = 10000;
+
 ImageDB::ImageDB() {}
 ImageDB::ImageDB(const ImageDB& orig) {}
 ImageDB::~ImageDB() {}
 
 /**
  * Open the image database, create it if it does not exist.  Prepare tables.
+ * @param dbPath The database file path.
+ * @param firstImageID The first person image ID to hand out if the database
+ * does not yet keep IDs: the ID saved by older versions in the program settings.
  * @return true if database is open and ready, false if error.
  */
-bool ImageDB::open() {
-    string dbName = Tools::wx2str(Tools::crowd3Folder() + SEPARATOR + DATABASE);
-    if (sqlite3_open(dbName.c_str(), &myImageDB) == SQLITE_OK) {
+bool ImageDB::open(const string& dbPath, wxInt32 firstImageID) {
+    wxMutexLocker lock(dbLock);
+    if (sqlite3_open(dbPath.c_str(), &myImageDB) == SQLITE_OK) {
+        sqlite3_busy_timeout(myImageDB, DBBUSYTIMEOUT);
+        
         // Database opened. Create imageDB table.
         string aSQL = "create table if not exists imageDB "
                 "(Path   TEXT PRIMARY KEY, "
                 "Date    TEXT, "
                 "FirstID INTEGER, "
-                "LastID  INTEGER);";
+                "LastID  INTEGER, "
+                "Detector TEXT);";
         wxInt32 result = sqlite3_exec(myImageDB, aSQL.c_str(), NULL, NULL, NULL);
         if(result != SQLITE_OK) {
             string errMsg = sqlite3_errmsg(myImageDB);
-            Tools::log(Tools::str2wx(errMsg) + 
-                _T("\nThe Crowd3 database table could not be created."));
+            CoreTools::error(errMsg + 
+                "\nThe Crowd3 database table could not be created.");
+            return false;
+        }
+        if ( ! addDetectorColumn() || ! createIDTable(firstImageID)) {
             return false;
         }
-        fix1(); // Apply bug fix to database.
     }
     else {
         string errMsg = sqlite3_errmsg(myImageDB);
-        Tools::log(Tools::str2wx(errMsg) + 
-                _T("\nThe Crowd3 database could not be opened."));
+        CoreTools::error(errMsg + 
+                "\nThe Crowd3 database could not be opened.");
         return false;
     }
     return true;
@@ -69,6 +90,7 @@ bool ImageDB::open() {
 
 /** Close the image database. */
 void ImageDB::close() {
+    wxMutexLocker lock(dbLock);
     sqlite3_close(myImageDB);  
 }
 
@@ -78,18 +100,22 @@ void ImageDB::close() {
  * @param date A timestamp, written as "04-Mar-2012 09:24:15 AM"
  * @param firstImage The first image ID.
  * @param lastImage The last image ID.
+ * @param detector The name of the face detector that searched path.
  */
-void ImageDB::write(wxString path, wxString date, wxInt32 firstImage, wxInt32 lastImage) {
-    string aSQL = "insert into imageDB (Path, Date, FirstID, LastID) values ("
-            "'" + Tools::wx2str(filter(path)) + "', "
-            "'" + Tools::wx2str(date) + "', " +
-            Tools::int2str(firstImage) + ", " +
-            Tools::int2str(lastImage) + ");";
+void ImageDB::write(const string& path, const string& date, wxInt32 firstImage,
+        wxInt32 lastImage, const string& detector) {
+    wxMutexLocker lock(dbLock);
+    string aSQL = "insert into imageDB (Path, Date, FirstID, LastID, Detector) values ("
+            "'" + filter(path) + "', "
+            "'" + date + "', " +
+            CoreTools::int2str(firstImage) + ", " +
+            CoreTools::int2str(lastImage) + ", "
+            "'" + filter(detector) + "');";
     wxInt32 result = sqlite3_exec(myImageDB, aSQL.c_str(), NULL, NULL, NULL);
     if (result != SQLITE_OK) {
         string errMsg = sqlite3_errmsg(myImageDB);
-        Tools::log(Tools::str2wx(errMsg) + _T("\n") +
-                Tools::str2wx(aSQL) + _T("\nError writing to database"));
+        CoreTools::error(errMsg + "\n" +
+                aSQL + "\nError writing to database");
     }
 }
 
@@ -100,17 +126,19 @@ void ImageDB::write(wxString path, wxString date, wxInt32 firstImage, wxInt32 la
  * @param firstImage The first image ID.
  * @param lastImage The last image ID.
  */
-void ImageDB::update(wxString path, wxString date, wxInt32 firstImage, wxInt32 lastImage) {
+void ImageDB::update(const string& path, const string& date, wxInt32 firstImage,
+        wxInt32 lastImage) {
+    wxMutexLocker lock(dbLock);
     string aSQL = "UPDATE imageDB SET "
-            "Date = '" + Tools::wx2str(date) + "', " +
-            "FirstID = " + Tools::int2str(firstImage) + ", " +
-            "LastID = " + Tools::int2str(lastImage) + 
-            " WHERE Path= '" + Tools::wx2str(filter(path)) + "'";
+            "Date = '" + date + "', " +
+            "FirstID = " + CoreTools::int2str(firstImage) + ", " +
+            "LastID = " + CoreTools::int2str(lastImage) + 
+            " WHERE Path= '" + filter(path) + "'";
     wxInt32 result = sqlite3_exec(myImageDB, aSQL.c_str(), NULL, NULL, NULL);
     if (result != SQLITE_OK) {
         string errMsg = sqlite3_errmsg(myImageDB);
-        Tools::log(Tools::str2wx(errMsg) + _T("\n") +
-                Tools::str2wx(aSQL) + _T("\nError writing to database"));
+        CoreTools::error(errMsg + "\n" +
+                aSQL + "\nError writing to database");
     }
 }
 
@@ -118,14 +146,15 @@ void ImageDB::update(wxString path, wxString date, wxInt32 firstImage, wxInt32 l
  * Delete a record from the image database.
  * @param path A pathname - the record key.
  */
-void ImageDB::remove(wxString path) {
+void ImageDB::remove(const string& path) {
+    wxMutexLocker lock(dbLock);
     string aSQL = "DELETE from imageDB where Path = '" + 
-            Tools::wx2str(filter(path)) + "';";
+            filter(path) + "';";
     wxInt32 result = sqlite3_exec(myImageDB, aSQL.c_str(), NULL, NULL, NULL);
     if(result != SQLITE_OK) {
         string errMsg = sqlite3_errmsg(myImageDB);
-        Tools::log(Tools::str2wx(errMsg) + _T("\n") +
-                Tools::str2wx(aSQL) + _T("\nError deleting from database"));
+        CoreTools::error(errMsg + "\n" +
+                aSQL + "\nError deleting from database");
     }
 }
 
@@ -137,16 +166,17 @@ void ImageDB::remove(wxString path) {
  * @param lastImage The last image ID.
  * @return true if a record was found else return false.
  */
-bool ImageDB::read(wxString path, wxString &date, wxInt32 &firstImage, wxInt32 &lastImage) {
+bool ImageDB::read(const string& path, string& date, wxInt32& firstImage, wxInt32& lastImage) {
+    wxMutexLocker lock(dbLock);
     // Attempt a read from the database with key=path.
     sqlite3_stmt *statement;
     string aSQL = "SELECT Date, FirstID, LastID from imageDB where Path = '" +
-            Tools::wx2str(filter(path)) + "';";
+            filter(path) + "';";
     if(sqlite3_prepare_v2(myImageDB, aSQL.c_str(), -1, &statement, 0) != SQLITE_OK) {
         // Error on prepare.
         string errMsg = sqlite3_errmsg(myImageDB);
-        Tools::log(Tools::str2wx(errMsg) + _T("\n") +
-                Tools::str2wx(aSQL) + _T("\nError preparing database query"));
+        CoreTools::error(errMsg + "\n" +
+                aSQL + "\nError preparing database query");
         sqlite3_finalize(statement);
         return false;
     }
@@ -163,15 +193,15 @@ bool ImageDB::read(wxString path, wxString &date, wxInt32 &firstImage, wxInt32 &
         // Check for error.
         if (sqlResult == SQLITE_ERROR) {
             string errMsg = sqlite3_errmsg(myImageDB);
-            Tools::log(Tools::str2wx(errMsg) + _T("\n") +
-                    Tools::str2wx(aSQL) + _T("\nError reading from database"));
+            CoreTools::error(errMsg + "\n" +
+                    aSQL + "\nError reading from database");
             sqlite3_finalize(statement);
             return false;
         }
         
         // Check for column error.
         if (3 != sqlite3_column_count(statement)) {
-            Tools::log(Tools::str2wx(aSQL) + _T("\nColumn error reading from database"));
+            CoreTools::error(aSQL + "\nColumn error reading from database");
             sqlite3_finalize(statement);
             return false;
         }
@@ -180,7 +210,7 @@ bool ImageDB::read(wxString path, wxString &date, wxInt32 &firstImage, wxInt32 &
         if(sqlResult == SQLITE_ROW) {
             // Date.
             char* dateChars = (char*)sqlite3_column_text(statement, 0);
-            date = Tools::cstar2wx(dateChars);
+            date = dateChars != NULL ? dateChars : "";
             
             // Image IDs.
             firstImage = sqlite3_column_int(statement, 1);
@@ -192,8 +222,8 @@ bool ImageDB::read(wxString path, wxString &date, wxInt32 &firstImage, wxInt32 &
 
         // Unexpected return code.
         string errMsg = sqlite3_errmsg(myImageDB);
-        Tools::log(Tools::str2wx(errMsg) + _T("\n") + Tools::int2wx(sqlResult) + 
-                _T("\n") + Tools::str2wx(aSQL) + _T("\nUnexpected code from database"));
+        CoreTools::error(errMsg + "\n" + CoreTools::int2str(sqlResult) + 
+                "\n" + aSQL + "\nUnexpected code from database");
         sqlite3_finalize(statement);
         return false;
     }
@@ -201,16 +231,17 @@ bool ImageDB::read(wxString path, wxString &date, wxInt32 &firstImage, wxInt32 &
 
 /**
  * Read all records from the image database. Send them one at a time to the 
- * callback function.
+ * callback function. The callback must not call ImageDB.
  * @param callback The callback function.
  */
 void ImageDB::readAllRecords(int callback (void*, int, char**, char**) ) {
+    wxMutexLocker lock(dbLock);
     string aSQL = "SELECT * from imageDB;";
     wxInt32 result = sqlite3_exec(myImageDB, aSQL.c_str(), callback, NULL, NULL);
     if(result != SQLITE_OK) {
         string errMsg = sqlite3_errmsg(myImageDB);
-        Tools::log(Tools::str2wx(errMsg) + _T("\n") +
-                Tools::str2wx(aSQL) + _T("\nError reading all records from database"));
+        CoreTools::error(errMsg + "\n" +
+                aSQL + "\nError reading all records from database");
     }
 }
 
@@ -219,90 +250,144 @@ void ImageDB::readAllRecords(int callback (void*, int, char**, char**) ) {
  * @param in The original string.
  * @return The safe string.
  */
-wxString ImageDB::filter(wxString in) {
-    in.Replace(_T("'"), _T("''"), true); // Escape ' by ''.
+string ImageDB::filter(string in) {
+    // Escape ' by ''.
+    for (size_t i = in.find('\''); i != string::npos; i = in.find('\'', i + 2)) {
+        in.insert(i, 1, '\'');
+    }
     return in;
 }
 
-/** A progress bar for fix functions. */
-wxProgressDialog *fixProgress;
-
-/** Fix1: Rewrite all database records using GMT instead of local time. */
-void ImageDB::fix1() {
-    // Apply this fix if fix1.txt exists.
-    wxString fix1Name = Tools::crowd3Folder() + SEPARATOR + _T("fix1.txt");
-    wxFileName fileNameObject(fix1Name);
-    if ( ! fileNameObject.FileExists()) {
-        return;
+/**
+ * Add the Detector column to image databases created before it existed.
+ * @return true if the column exists, false if error.
+ */
+bool ImageDB::addDetectorColumn() {
+    // The column exists if it can be selected.
+    sqlite3_stmt *statement;
+    string aSQL = "SELECT Detector from imageDB LIMIT 1;";
+    bool exists = sqlite3_prepare_v2(myImageDB, aSQL.c_str(), -1, &statement, 0) == SQLITE_OK;
+    sqlite3_finalize(statement);
+    if (exists) {
+        return true;
     }
     
-    // Show a progress bar.
-    fixProgress = new wxProgressDialog(
-            _T("Applying Fix1, please be patient."),
-            _T("Applying Fix1, please be patient."),
-            100,
-            NULL,
-            wxPD_APP_MODAL);
-    fixProgress->SetSize(fixProgress->GetSize().GetWidth() * 2,
-                         fixProgress->GetSize().GetHeight());
-    
-    // Read all the records from the image database and send them one at a time
-    // to the receiveRecord function.
-    ImageDB::readAllRecords(fix1ReceiveRecord);
-    
-    // Delete fix1.txt.
-    if ( ! wxRemoveFile(fix1Name)) {
-        Tools::log(_T("\nError deleting fix1.txt.  Please delete it."));
+    aSQL = "ALTER TABLE imageDB ADD COLUMN Detector TEXT;";
+    wxInt32 result = sqlite3_exec(myImageDB, aSQL.c_str(), NULL, NULL, NULL);
+    if (result != SQLITE_OK) {
+        string errMsg = sqlite3_errmsg(myImageDB);
+        CoreTools::error(errMsg + 
+            "\nThe Crowd3 database table could not be upgraded.");
+        return false;
     }
-    
-    // Inform user.
-    fixProgress->Destroy();
-    wxString doneMsg = _T("Done! If no error messages appeared then Fix1 was successful.\n");
-    wxMessageDialog* done = new wxMessageDialog(NULL, doneMsg, _T("Fix1 applied"), 
-            wxOK | wxSTAY_ON_TOP, wxDefaultPosition);
-    done->ShowModal();
+    return true;
 }
 
-/** Fix1: Receive records from the image database, convert times to GMT and rewrite. */
-wxInt32 ImageDB::fix1ReceiveRecord(void *a_param, int argc, char **argv, char **column) {
-    // The path is the first column in the record.
-    char* pathChars = argv[0];
-    wxString aPath = Tools::cstar2wx(pathChars);
-    
-    // The date is the 2nd column.
-    char* dateChars = argv[1];
-    wxString aDate = Tools::cstar2wx(dateChars);
+/**
+ * Create the imageIDs table if it does not exist. Start it after the last ID
+ * handed out before IDs were kept in the database: the larger of the ID in the
+ * program settings and the last ID recorded in imageDB.
+ * @param firstImageID The ID in the program settings.
+ * @return true if the table is ready, false if error.
+ */
+bool ImageDB::createIDTable(wxInt32 firstImageID) {
+    string aSQL = "create table if not exists imageIDs "
+            "(Name   TEXT PRIMARY KEY, "
+            "NextID  INTEGER);";
+    wxInt32 result = sqlite3_exec(myImageDB, aSQL.c_str(), NULL, NULL, NULL);
+    if (result != SQLITE_OK) {
+        string errMsg = sqlite3_errmsg(myImageDB);
+        CoreTools::error(errMsg + 
+            "\nThe Crowd3 database ID table could not be created.");
+        return false;
+    }
     
-    // The first and last image IDs are 3rd and 4th columns.
-    wxInt32 firstID = Tools::cstar2int(argv[2]);
-    wxInt32 lastID  = Tools::cstar2int(argv[3]);
+    wxInt32 nextID;
+    if (readInt("SELECT NextID from imageIDs where Name = 'person';", nextID)) {
+        return true; // Already started.
+    }
+    wxInt32 lastID = -1;
+    readInt("SELECT MAX(LastID) from imageDB;", lastID);
+    nextID = max(firstImageID, lastID + 1);
+    aSQL = "insert into imageIDs (Name, NextID) values ('person', " +
+            CoreTools::int2str(nextID) + ");";
+    result = sqlite3_exec(myImageDB, aSQL.c_str(), NULL, NULL, NULL);
+    if (result != SQLITE_OK) {
+        string errMsg = sqlite3_errmsg(myImageDB);
+        CoreTools::error(errMsg + "\n" +
+                aSQL + "\nError writing to database");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Run a query that returns a single integer.
+ * @param aSQL The query.
+ * @param value Receives the integer.
+ * @return false if there is no row or the value is NULL.
+ */
+bool ImageDB::readInt(string aSQL, wxInt32& value) {
+    sqlite3_stmt *statement;
+    bool found = false;
+    if (sqlite3_prepare_v2(myImageDB, aSQL.c_str(), -1, &statement, 0) == SQLITE_OK
+            && sqlite3_step(statement) == SQLITE_ROW
+            && sqlite3_column_type(statement, 0) != SQLITE_NULL) {
+        value = sqlite3_column_int(statement, 0);
+        found = true;
+    }
+    sqlite3_finalize(statement);
+    return found;
+}
+
+/**
+ * Reserve a block of consecutive person image IDs. The reservation is
+ * committed to the database before the IDs are used, so they are never handed
+ * out twice, even after a crash. May be called from any thread. Errors are
+ * returned rather than logged.
+ * @param count The number of IDs.
+ * @param error Receives the error message on failure.
+ * @return The first ID of the block, or -1 on failure.
+ */
+wxInt32 ImageDB::reserveIDs(wxInt32 count, string& error) {
+    wxMutexLocker lock(dbLock);
     
-    // Continue only if the file exists.
-    const wxString dbDateFormat = _T("%d-%b-%Y %H:%M:%S");
-    wxFileName fileNameObject(aPath);
-    if (fileNameObject.FileExists()) {
-        // Get the file's modification date from the OS.
-        wxDateTime osModDate = fileNameObject.GetModificationTime();
-        wxString osModDateGMT = osModDate.Format(dbDateFormat, wxDateTime::UTC);
-        wxString osMinSec = osModDateGMT.Right(5);
+    // An immediate transaction also keeps other Crowd3 processes out.
+    if (sqlite3_exec(myImageDB, "BEGIN IMMEDIATE;", NULL, NULL, NULL) != SQLITE_OK) {
+        error = sqlite3_errmsg(myImageDB);
+        return -1;
+    }
+    wxInt32 first;
+    if ( ! readInt("SELECT NextID from imageIDs where Name = 'person';", first)) {
+        error = "The image ID table is empty";
+        sqlite3_exec(myImageDB, "ROLLBACK;", NULL, NULL, NULL);
+        return -1;
+    }
+    string aSQL = "UPDATE imageIDs SET NextID = " + CoreTools::int2str(first + count) +
+            " WHERE Name = 'person';";
+    if (sqlite3_exec(myImageDB, aSQL.c_str(), NULL, NULL, NULL) != SQLITE_OK ||
+            sqlite3_exec(myImageDB, "COMMIT;", NULL, NULL, NULL) != SQLITE_OK) {
+        error = sqlite3_errmsg(myImageDB);
+        sqlite3_exec(myImageDB, "ROLLBACK;", NULL, NULL, NULL);
+        return -1;
+    }
+    return first;
+}
 
-        // Get database (assumed local) modification time.
-        wxDateTime dbDate;
-        dbDate.ParseDateTime(aDate);
-        wxString dbMinSec = aDate.Right(5);
-        
-        // Compare OS modification time to the database record time.
-        // Skip records where the file seems to have changed since the DB record
-        // was written (os mod date very different from db mod date).
-        wxDateTime loTime = osModDate;
-        loTime.Subtract(wxTimeSpan::Days(1));
-        wxDateTime hiTime = osModDate;
-        hiTime.Add(wxTimeSpan::Days(1));
-        if (dbDate > loTime && dbDate < hiTime && dbMinSec.IsSameAs(osMinSec)) {
-            // Match. Rewrite the record with GMT time.
-            update(aPath, osModDateGMT, firstID, lastID);
-        }
+/**
+ * Give back the unused tail of a block of person image IDs. The IDs are only
+ * taken back if no block was reserved after this one.
+ * @param first The first unused ID.
+ * @param end One past the last ID of the block.
+ */
+void ImageDB::returnIDs(wxInt32 first, wxInt32 end) {
+    wxMutexLocker lock(dbLock);
+    string aSQL = "UPDATE imageIDs SET NextID = " + CoreTools::int2str(first) +
+            " WHERE Name = 'person' AND NextID = " + CoreTools::int2str(end) + ";";
+    wxInt32 result = sqlite3_exec(myImageDB, aSQL.c_str(), NULL, NULL, NULL);
+    if (result != SQLITE_OK) {
+        string errMsg = sqlite3_errmsg(myImageDB);
+        CoreTools::error(errMsg + "\n" +
+                aSQL + "\nError writing to database");
     }
-    fixProgress->Pulse(aPath);
-    return 0; // OK
 }
@@ -30,25 +30,28 @@
 #ifndef IMAGEDB_H
 #define	IMAGEDB_H
 
-#include <wx/wx.h>
 #include <sqlite3.h>
-#include "const.h"
-#include "Tools.h"
-#include <wx/progdlg.h>
-using namespace std;
+#include "CoreTools.h"
 
 /**
  * Provide access to a SQL database for managing image files and the person
- * images found within them.<p>
+ * images found within them. Part of the core; database errors go to the core
+ * error handler.<p>
  * The database contains records with these fields:<p>
  * - Path:    TEXT (PRIMARY KEY) - The full path to an image file.<p>
  * - Date:    TEXT - The modification date/time of Path in text format.<p>
  * - FirstID: INTEGER - The first unique id associated with Path or -1.<p>
  * - LastID:  INTEGER - the last unique id associated with Path.<p>
+ * - Detector: TEXT - The face detector that searched Path, or NULL if the
+ *   record predates detector choice (the Haar detector was used).<p>
+ * A second table, imageIDs, holds the next person image ID that has not been
+ * reserved. IDs are reserved in blocks by IDAllocator objects.<p>
+ * All calls may be made from any thread; they take turns on one connection.
+ * Another Crowd3 process holding the database is waited for, up to a limit.<p>
  * The database file is stored in the Crowd3 folder.<p>
  * Usage: (all calls are static)<p><code>
- * bool s = open();<p>
- * write(path, moddate, first, last);<p>
+ * bool s = open(dbPath, firstImageID);<p>
+ * write(path, moddate, first, last, detector);<p>
  * bool s = read(path, moddate, first, last);<p>
  * remove(path);<p>
  * readAllRecords(callback);<p>
@@ -60,17 +63,21 @@ public:
     ImageDB();
     ImageDB(const ImageDB& orig);
     virtual ~ImageDB();
-    static bool open();
+    static bool open(const string& dbPath, wxInt32 firstImageID);
     static void close();
-    static bool read(wxString path, wxString& date, wxInt32& firstD, wxInt32& lastID);
-    static void write(wxString path, wxString date, wxInt32 firstID, wxInt32 lastID);
-    static void remove(wxString path);
+    static bool read(const string& path, string& date, wxInt32& firstD, wxInt32& lastID);
+    static void write(const string& path, const string& date, wxInt32 firstID, wxInt32 lastID,
+            const string& detector);
+    static void update(const string& path, const string& date, wxInt32 firstID, wxInt32 lastID);
+    static void remove(const string& path);
     static void readAllRecords(int callback(void*, int, char**, char**));
+    static wxInt32 reserveIDs(wxInt32 count, string& error);
+    static void returnIDs(wxInt32 first, wxInt32 end);
 private:
-    static wxString filter(wxString in);
-    static void fix1();
-    static wxInt32 fix1ReceiveRecord(void *a_param, int argc, char **argv, char **column);
-    static void update(wxString path, wxString date, wxInt32 firstID, wxInt32 lastID);
+    static bool createIDTable(wxInt32 firstImageID);
+    static bool readInt(string aSQL, wxInt32& value);
+    static string filter(string in);
+    static bool addDetectorColumn();
 };
 
 #endif	/* IMAGEDB_H */
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "ImageDecoder.h"
+#include "JpegHeader.h"
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+/** Files are recognised from at most this many leading bytes. */
+const size_t SIGNATURELENGTH = 16;
+
+/** JPEG files. Sizes come from the frame header. */
+class JpegDecoder : public ImageDecoder {
+public:
+    JpegDecoder() : ImageDecoder("JPEG", "jpg jpeg jpe", "\xFF\xD8\xFF", 3) {}
+
+    virtual bool readSize(const string& path, wxInt32& width, wxInt32& height) const {
+        JpegHeader header;
+        if ( ! header.read(path)) {
+            return false;
+        }
+        width = header.getWidth();
+        height = header.getHeight();
+        return true;
+    }
+};
+
+/** PNG files. Sizes come from the IHDR chunk. */
+class PngDecoder : public ImageDecoder {
+public:
+    PngDecoder() : ImageDecoder("PNG", "png", "\x89PNG\r\n\x1A\n", 8) {}
+
+    virtual bool readSize(const string& path, wxInt32& width, wxInt32& height) const {
+        // The signature, then the IHDR chunk: 4 byte length, 4 byte type,
+        // 4 byte big-endian width, 4 byte big-endian height.
+        unsigned char header[24];
+        ifstream in(path.c_str(), ios::in | ios::binary);
+        in.read((char*) header, sizeof(header));
+        if ( ! in || memcmp(header + 12, "IHDR", 4) != 0) {
+            return false;
+        }
+        width  = (header[16] << 24) | (header[17] << 16) | (header[18] << 8) | header[19];
+        height = (header[20] << 24) | (header[21] << 16) | (header[22] << 8) | header[23];
+        return true;
+    }
+};
+
+/**
+ * Create a decoder for files that start with a signature. The file is decoded
+ * by OpenCV, so the format is only readable if OpenCV was built with its codec.
+ * @param name The format name.
+ * @param extensions The lower case file extensions usually used, space separated.
+ * @param signature The bytes the file starts with. '?' matches any byte.
+ * @param length The signature length.
+ */
+ImageDecoder::ImageDecoder(const char *name, const char *extensions,
+                           const char *signature, size_t length) {
+    myName = name;
+    myExtensions = extensions;
+    mySignature = string(signature, length);
+}
+
+/** @return The format name. */
+string ImageDecoder::name() const {
+    return myName;
+}
+
+/**
+ * Check the leading bytes of a file against this format's signature.
+ * @param head The leading bytes. May be fewer than SIGNATURELENGTH.
+ * @return true if the file has this format.
+ */
+bool ImageDecoder::matches(const vector<unsigned char>& head) const {
+    if (head.size() < mySignature.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < mySignature.size(); i++) {
+        if (mySignature[i] != '?' && (unsigned char) mySignature[i] != head[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Read the image size without decoding the image, where the format allows.
+ * @param path The file path.
+ * @param width The returned image width, 0 if it is not known.
+ * @param height The returned image height, 0 if it is not known.
+ * @return false if the file header is unreadable, else true.
+ */
+bool ImageDecoder::readSize(const string& path, wxInt32& width, wxInt32& height) const {
+    width = 0;
+    height = 0;
+    return true;
+}
+
+/**
+ * Decode an image file.
+ * @param path The file path.
+ * @param flags The OpenCV imread flags, e.g. CV_LOAD_IMAGE_COLOR.
+ * @return The image, or an empty Mat if it could not be decoded.
+ */
+Mat ImageDecoder::decode(const string& path, wxInt32 flags) const {
+    return imread(path, flags);
+}
+
+/**
+ * Find the decoder for a file from its leading bytes.
+ * @param path The file path.
+ * @return The decoder, or NULL if the file is unreadable or of no known format.
+ */
+const ImageDecoder* ImageDecoder::find(const string& path) {
+    vector<unsigned char> head(SIGNATURELENGTH);
+    ifstream in(path.c_str(), ios::in | ios::binary);
+    in.read((char*) &head[0], head.size());
+    head.resize(in.gcount());
+    
+    vector<ImageDecoder*>& decoders = registry();
+    for (size_t i = 0; i < decoders.size(); i++) {
+        if (decoders[i]->matches(head)) {
+            return decoders[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Get the file extensions of all known formats. Used to pick likely image
+ * files out of a folder without opening every file.
+ * @return The lower case extensions without dots.
+ */
+vector<string> ImageDecoder::extensions() {
+    vector<string> all;
+    vector<ImageDecoder*>& decoders = registry();
+    for (size_t i = 0; i < decoders.size(); i++) {
+        istringstream words(decoders[i]->myExtensions);
+        string extension;
+        while (words >> extension) {
+            if (std::find(all.begin(), all.end(), extension) == all.end()) {
+                all.push_back(extension);
+            }
+        }
+    }
+    return all;
+}
+
+/**
+ * Get the known formats, building the list on first use.
+ * @return The decoders, most common format first.
+ */
+vector<ImageDecoder*>& ImageDecoder::registry() {
+    static vector<ImageDecoder*> decoders;
+    if (decoders.empty()) {
+        decoders.push_back(new JpegDecoder());
+        decoders.push_back(new PngDecoder());
+        decoders.push_back(new ImageDecoder("WebP", "webp", "RIFF????WEBP", 12));
+        decoders.push_back(new ImageDecoder("TIFF", "tif tiff", "II*\0", 4));
+        decoders.push_back(new ImageDecoder("TIFF", "tif tiff", "MM\0*", 4));
+        decoders.push_back(new ImageDecoder("JPEG 2000", "jp2",
+                "\0\0\0\x0CjP  \r\n\x87\n", 12));
+        decoders.push_back(new ImageDecoder("BMP", "bmp", "BM", 2));
+    }
+    return decoders;
+}
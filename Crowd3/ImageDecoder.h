@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef IMAGEDECODER_H
+#define	IMAGEDECODER_H
+
+#include <opencv2/highgui/highgui.hpp>
+#include "CoreTools.h"
+#include <string>
+#include <vector>
+
+/**
+ * A source or background image file format. The format of a file is found
+ * from its first bytes, never from its name, so misnamed files are read
+ * correctly. Decoders use no wxWidgets objects and may be used on any thread,
+ * but the first call to a static function must be made on the main thread,
+ * which builds the registry.<p>
+ * Usage:<p><code>
+ * const ImageDecoder *d = ImageDecoder::find(path);<p>
+ * if (d != NULL) m = d->decode(path, CV_LOAD_IMAGE_COLOR);<p></code>
+ */
+class ImageDecoder {
+public:
+    ImageDecoder(const char *name, const char *extensions,
+                 const char *signature, size_t length);
+    virtual ~ImageDecoder() {}
+    string name() const;
+    bool matches(const vector<unsigned char>& head) const;
+    virtual bool readSize(const string& path, wxInt32& width, wxInt32& height) const;
+    virtual Mat decode(const string& path, wxInt32 flags) const;
+
+    static const ImageDecoder* find(const string& path);
+    static vector<string> extensions();
+
+private:
+    static vector<ImageDecoder*>& registry();
+
+    /** The format name. */
+    string myName;
+
+    /** The lower case file extensions usually used, space separated. */
+    string myExtensions;
+
+    /** The bytes a file of this format starts with. '?' matches any byte. */
+    string mySignature;
+};
+
+#endif	/* IMAGEDECODER_H */
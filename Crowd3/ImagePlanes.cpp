@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "ImagePlanes.h"
+
+/** Create an empty working set. */
+ImagePlanes::ImagePlanes() {
+    myOrientation = 1;
+}
+
+/**
+ * Start a new working set. Planes of the previous image are dropped.
+ * @param decoded The decoded source image, as stored. Shared, not copied.
+ * @param orientation The EXIF orientation of the stored image, 1 to 8.
+ */
+void ImagePlanes::setSource(const Mat& decoded, wxInt32 orientation) {
+    release();
+    mySource = decoded;
+    myOrientation = (orientation >= 1 && orientation <= 8) ? orientation : 1;
+}
+
+/** @return The image as decoded. Empty if it could not be read. */
+const Mat& ImagePlanes::source() {
+    return mySource;
+}
+
+/** @return The upright image size. */
+Size ImagePlanes::size() {
+    if (myOrientation >= 5) {
+        return Size(mySource.rows, mySource.cols);
+    }
+    return Size(mySource.cols, mySource.rows);
+}
+
+/** @return The EXIF orientation of the source image, 1 (upright) to 8. */
+wxInt32 ImagePlanes::orientation() {
+    return myOrientation;
+}
+
+/**
+ * @return The upright 8-bit grayscale plane. Shares the source if it already
+ * is one and is stored upright.
+ */
+const Mat& ImagePlanes::gray() {
+    if (myGray.empty() && ! mySource.empty()) {
+        Mat gray;
+        if (mySource.channels() == 3) {
+            cvtColor(mySource, gray, CV_BGR2GRAY);
+        }
+        else if (mySource.channels() == 4) {
+            cvtColor(mySource, gray, CV_BGRA2GRAY);
+        }
+        else {
+            gray = mySource;
+        }
+        // Convert non unsigned 8-bit images to 8-bit images. Not sure if this can occur.
+        if (gray.depth() != CV_8U) {
+            gray.convertTo(gray, CV_8U);
+        }
+        orient(gray, myGray, myOrientation);
+    }
+    return myGray;
+}
+
+/** @return The histogram equalized grayscale plane used for face detection. */
+const Mat& ImagePlanes::equalized() {
+    if (myEqualized.empty() && ! gray().empty()) {
+        equalizeHist(myGray, myEqualized);
+    }
+    return myEqualized;
+}
+
+/**
+ * Get a region of the image as upright 8-bit BGR. Only the region is converted
+ * and turned upright. If the source already is upright 8-bit BGR the region
+ * shares its pixels.
+ * @param region The region, inside the upright image.
+ * @return The region's pixels.
+ */
+Mat ImagePlanes::bgr(Rect region) {
+    Mat part(mySource, toStored(region));
+    Mat result;
+    if (part.channels() == 1) {
+        cvtColor(part, result, CV_GRAY2BGR);
+    }
+    else if (part.channels() == 4) {
+        cvtColor(part, result, CV_BGRA2BGR);
+    }
+    else {
+        result = part;
+    }
+    // Convert non unsigned 8-bit images to 8-bit images. Not sure if this can occur.
+    if (result.depth() != CV_8U) {
+        result.convertTo(result, CV_8UC3);
+    }
+    Mat upright;
+    orient(result, upright, myOrientation);
+    return upright;
+}
+
+/**
+ * Get a small upright 8-bit BGR copy of the whole image. Only the small copy
+ * is turned upright.
+ * @param longSide The length of the copy's longer side in pixels.
+ * @return The copy, the same shape as the upright image.
+ */
+Mat ImagePlanes::preview(wxInt32 longSide) {
+    double scale = (double) longSide / max(mySource.cols, mySource.rows);
+    Mat small;
+    resize(mySource, small, Size(), scale, scale, INTER_AREA);
+    ImagePlanes smallPlanes;
+    smallPlanes.setSource(small, myOrientation);
+    return smallPlanes.bgr(Rect(Point(0, 0), smallPlanes.size()));
+}
+
+/**
+ * Turn an image stored with an EXIF orientation upright.
+ * @param stored The image as stored.
+ * @param upright The upright image. Shares stored if orientation is 1.
+ * @param orientation The EXIF orientation, 1 to 8.
+ */
+void ImagePlanes::orient(const Mat& stored, Mat& upright, wxInt32 orientation) {
+    // 5 to 8 are transposed; then 2, 3, 6 and 7 are mirrored left to right
+    // and 3, 4, 7 and 8 top to bottom.
+    bool flipX = orientation == 2 || orientation == 3 || orientation == 6 || orientation == 7;
+    bool flipY = orientation == 3 || orientation == 4 || orientation == 7 || orientation == 8;
+    Mat turned = stored;
+    if (orientation >= 5) {
+        transpose(stored, turned);
+    }
+    if (flipX || flipY) {
+        Mat flipped;
+        flip(turned, flipped, flipX && flipY ? -1 : (flipX ? 1 : 0));
+        turned = flipped;
+    }
+    upright = turned;
+}
+
+/**
+ * Find where a region of the upright image is stored.
+ * @param region The region in the upright image.
+ * @return The region in mySource.
+ */
+Rect ImagePlanes::toStored(Rect region) {
+    Size upright = size();
+    Rect r = region;
+    if (myOrientation == 2 || myOrientation == 3 || myOrientation == 6 || myOrientation == 7) {
+        r.x = upright.width - region.x - region.width;
+    }
+    if (myOrientation == 3 || myOrientation == 4 || myOrientation == 7 || myOrientation == 8) {
+        r.y = upright.height - region.y - region.height;
+    }
+    if (myOrientation >= 5) {
+        r = Rect(r.y, r.x, r.height, r.width);
+    }
+    return r;
+}
+
+/** Drop the cached whole-image planes. Keep the source image. */
+void ImagePlanes::releaseDerived() {
+    myGray.release();
+    myEqualized.release();
+}
+
+/** Drop the source image and all derived planes. */
+void ImagePlanes::release() {
+    mySource.release();
+    myOrientation = 1;
+    releaseDerived();
+}
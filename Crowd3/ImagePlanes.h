@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef IMAGEPLANES_H
+#define	IMAGEPLANES_H
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/imgproc/imgproc_c.h>
+#include "CoreTools.h"
+
+/**
+ * The working set of one decoded source image: the image as decoded and the
+ * planes derived from it. Each whole-image plane is computed at most once, on
+ * first use. Regions of the 8-bit BGR plane are converted on their own, so a
+ * face crop never pays for converting the whole photo.<p>
+ * Photos stored sideways or mirrored (EXIF orientation 2 to 8) are presented
+ * upright: sizes, the grayscale planes and regions are all in the upright
+ * frame. Only the 8-bit grayscale plane and the regions asked for are turned
+ * upright; the decoded colour image is never rotated.<p>
+ * The whole-image planes are cached, so gray() and equalized() must be called
+ * from one thread at a time. source() and bgr(region) only read and may be
+ * called from many threads at once.<p>
+ * Usage:<p><code>
+ * ImagePlanes planes;<p>
+ * planes.setSource(imread(path, CV_LOAD_IMAGE_UNCHANGED), orientation);<p>
+ * faces = detect(planes.equalized());<p>
+ * crop = planes.bgr(aRegion);<p>
+ * planes.release();<p></code>
+ */
+class ImagePlanes {
+public:
+    ImagePlanes();
+    void setSource(const Mat& decoded, wxInt32 orientation = 1);
+    const Mat& source();
+    Size size();
+    wxInt32 orientation();
+    const Mat& gray();
+    const Mat& equalized();
+    Mat bgr(Rect region);
+    Mat preview(wxInt32 longSide);
+    void releaseDerived();
+    void release();
+    static void orient(const Mat& stored, Mat& upright, wxInt32 orientation);
+
+private:
+    Rect toStored(Rect region);
+
+    /** The image as decoded: 1, 3 or 4 channels, any depth. */
+    Mat mySource;
+
+    /** The EXIF orientation of mySource, 1 (upright) to 8. */
+    wxInt32 myOrientation;
+
+    /** The upright 8-bit grayscale plane, or empty until needed. May share mySource. */
+    Mat myGray;
+
+    /** The histogram equalized grayscale plane, or empty until needed. */
+    Mat myEqualized;
+};
+
+#endif	/* IMAGEPLANES_H */
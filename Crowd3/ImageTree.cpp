@@ -29,6 +29,7 @@
 #include "ImageTree.h"
 #include "Tools.h"
 #include "ImageDB.h"
+#include <wx/progdlg.h>
 
 /** The on-screen folder tree of source image files. */
 static ImageTree* myTree = NULL;
@@ -98,7 +99,10 @@ wxInt32 ImageTree::receiveRecord(void *a_param, int argc, char **argv, char **co
  * @return true if a record was found else return false.
  */
 bool ImageTree::read(wxString path, wxString& date, wxInt32& firstID, wxInt32& lastID) {
-    return ImageDB::read(path, date, firstID, lastID);
+    string dbDate;
+    bool found = ImageDB::read(Tools::wx2str(path), dbDate, firstID, lastID);
+    date = Tools::str2wx(dbDate);
+    return found;
 }
 
 /**
@@ -107,9 +111,12 @@ bool ImageTree::read(wxString path, wxString& date, wxInt32& firstID, wxInt32& l
  * @param date A timestamp.
  * @param firstID The first image ID.
  * @param lastID The last image ID.
+ * @param detector The name of the face detector that searched path.
  */
-void ImageTree::write(wxString path, wxString date, wxInt32 firstID, wxInt32 lastID) {
-    ImageDB::write(path, date, firstID, lastID);
+void ImageTree::write(wxString path, wxString date, wxInt32 firstID, wxInt32 lastID,
+        wxString detector) {
+    ImageDB::write(Tools::wx2str(path), Tools::wx2str(date), firstID, lastID,
+            Tools::wx2str(detector));
     write(path, firstID, lastID);
 }
 
@@ -146,7 +153,7 @@ void ImageTree::write(wxString aPath, wxInt32 firstID, wxInt32 lastID) {
  */
 void ImageTree::remove(wxString aPath) {
     // Remove database record.
-    ImageDB::remove(aPath);
+    ImageDB::remove(Tools::wx2str(aPath));
 
     // Find the tree node id of the each folder in the path. Start with root
     // and descend the tree.
@@ -311,4 +318,112 @@ void ImageTree::selectionMonitor(wxCommandEvent &event) {
 ImageData::ImageData(wxInt32 firstID, wxInt32 lastID) {
     first = firstID;
     last = lastID;
+}
+
+/** A progress bar for fix functions. */
+static wxProgressDialog *fixProgress;
+
+/** A database record to be rewritten by Fix1. */
+struct Fix1Update {
+    string path;
+    string date;
+    wxInt32 firstID;
+    wxInt32 lastID;
+};
+
+/** The records Fix1 rewrites, collected while the database is being read. */
+static vector<Fix1Update> fix1Updates;
+
+/** Fix1: Rewrite all database records using GMT instead of local time. */
+void ImageTree::fix1() {
+    // Apply this fix if fix1.txt exists.
+    wxString fix1Name = Tools::crowd3Folder() + SEPARATOR + _T("fix1.txt");
+    wxFileName fileNameObject(fix1Name);
+    if ( ! fileNameObject.FileExists()) {
+        return;
+    }
+    
+    // Show a progress bar.
+    fixProgress = new wxProgressDialog(
+            _T("Applying Fix1, please be patient."),
+            _T("Applying Fix1, please be patient."),
+            100,
+            NULL,
+            wxPD_APP_MODAL);
+    fixProgress->SetSize(fixProgress->GetSize().GetWidth() * 2,
+                         fixProgress->GetSize().GetHeight());
+    
+    // Read all the records from the image database and send them one at a time
+    // to the receiveRecord function. The database cannot be written while it
+    // is being read, so the records are rewritten afterwards.
+    fix1Updates.clear();
+    ImageDB::readAllRecords(fix1ReceiveRecord);
+    for (size_t i = 0; i < fix1Updates.size(); i++) {
+        ImageDB::update(fix1Updates[i].path, fix1Updates[i].date,
+                        fix1Updates[i].firstID, fix1Updates[i].lastID);
+        fixProgress->Pulse();
+    }
+    fix1Updates.clear();
+    
+    // Delete fix1.txt.
+    if ( ! wxRemoveFile(fix1Name)) {
+        Tools::log(_T("\nError deleting fix1.txt.  Please delete it."));
+    }
+    
+    // Inform user.
+    fixProgress->Destroy();
+    wxString doneMsg = _T("Done! If no error messages appeared then Fix1 was successful.\n");
+    wxMessageDialog* done = new wxMessageDialog(NULL, doneMsg, _T("Fix1 applied"), 
+            wxOK | wxSTAY_ON_TOP, wxDefaultPosition);
+    done->ShowModal();
+}
+
+/** Fix1: Receive records from the image database, convert times to GMT and
+ * collect the records to rewrite. */
+wxInt32 ImageTree::fix1ReceiveRecord(void *a_param, int argc, char **argv, char **column) {
+    // The path is the first column in the record.
+    char* pathChars = argv[0];
+    wxString aPath = Tools::cstar2wx(pathChars);
+    
+    // The date is the 2nd column.
+    char* dateChars = argv[1];
+    wxString aDate = Tools::cstar2wx(dateChars);
+    
+    // The first and last image IDs are 3rd and 4th columns.
+    wxInt32 firstID = Tools::cstar2int(argv[2]);
+    wxInt32 lastID  = Tools::cstar2int(argv[3]);
+    
+    // Continue only if the file exists.
+    const wxString dbDateFormat = _T("%d-%b-%Y %H:%M:%S");
+    wxFileName fileNameObject(aPath);
+    if (fileNameObject.FileExists()) {
+        // Get the file's modification date from the OS.
+        wxDateTime osModDate = fileNameObject.GetModificationTime();
+        wxString osModDateGMT = osModDate.Format(dbDateFormat, wxDateTime::UTC);
+        wxString osMinSec = osModDateGMT.Right(5);
+
+        // Get database (assumed local) modification time.
+        wxDateTime dbDate;
+        dbDate.ParseDateTime(aDate);
+        wxString dbMinSec = aDate.Right(5);
+        
+        // Compare OS modification time to the database record time.
+        // Skip records where the file seems to have changed since the DB record
+        // was written (os mod date very different from db mod date).
+        wxDateTime loTime = osModDate;
+        loTime.Subtract(wxTimeSpan::Days(1));
+        wxDateTime hiTime = osModDate;
+        hiTime.Add(wxTimeSpan::Days(1));
+        if (dbDate > loTime && dbDate < hiTime && dbMinSec.IsSameAs(osMinSec)) {
+            // Match. Rewrite the record with GMT time.
+            Fix1Update anUpdate;
+            anUpdate.path = Tools::wx2str(aPath);
+            anUpdate.date = Tools::wx2str(osModDateGMT);
+            anUpdate.firstID = firstID;
+            anUpdate.lastID = lastID;
+            fix1Updates.push_back(anUpdate);
+        }
+    }
+    fixProgress->Pulse(aPath);
+    return 0; // OK
 }
\ No newline at end of file
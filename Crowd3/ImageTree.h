@@ -55,16 +55,19 @@ public:
     static ImageTree* t();
     static void buildImageTree();
     static bool read(wxString path, wxString& date, wxInt32& firstID, wxInt32& lastID);
-    static void write(wxString path, wxString date, wxInt32 firstID, wxInt32 lastID);
+    static void write(wxString path, wxString date, wxInt32 firstID, wxInt32 lastID,
+            wxString detector);
     static void remove(wxString aPath);
     static void sortImageTree();
     static wxArrayString* getSelectedPeopleFiles();
+    static void fix1();
     void selectionMonitor(wxCommandEvent &event);
 
 private:    
     static wxTreeItemId getTreeID(wxTreeItemId aNode, wxString aString);
     static void write(wxString aPath, wxInt32 first, wxInt32 last);
     static wxInt32 receiveRecord(void *a_param, int argc, char **argv, char **column);
+    static wxInt32 fix1ReceiveRecord(void *a_param, int argc, char **argv, char **column);
     static void sortImageNode(wxTreeItemId aNode);
     static void addPeopleFiles(wxTreeItemId aSelection, wxArrayString* aList);
 };
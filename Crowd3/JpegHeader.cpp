@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "JpegHeader.h"
+#include <fstream>
+
+// EXIF tags.
+const wxInt32 TAG_ORIENTATION = 0x0112;
+const wxInt32 TAG_THUMBNAILOFFSET = 0x0201;
+const wxInt32 TAG_THUMBNAILLENGTH = 0x0202;
+
+/**
+ * Read a 16 or 32 bit unsigned integer from an EXIF block.
+ * @param b The block.
+ * @param pos The integer's position. Must be in the block.
+ * @param bytes 2 or 4.
+ * @param motorola true for big-endian byte order.
+ * @return The integer.
+ */
+static unsigned long exifInt(const vector<unsigned char>& b, size_t pos,
+                             wxInt32 bytes, bool motorola) {
+    unsigned long value = 0;
+    for (wxInt32 i = 0; i < bytes; i++) {
+        unsigned long byte = b[pos + (motorola ? i : bytes - 1 - i)];
+        value = (value << 8) | byte;
+    }
+    return value;
+}
+
+/** Create an empty header. Call read(). */
+JpegHeader::JpegHeader() {
+    myWidth = 0;
+    myHeight = 0;
+    myOrientation = 1;
+    myThumbnailOffset = -1;
+    myThumbnailLength = 0;
+}
+
+/**
+ * Read the header of a JPEG file.
+ * @param path The file path.
+ * @return false if the file cannot be read or is not a JPEG with a frame header.
+ */
+bool JpegHeader::read(const string& path) {
+    ifstream in(path.c_str(), ios::in | ios::binary);
+    if ( ! in) {
+        return false;
+    }
+    
+    // Start of image.
+    if (in.get() != 0xFF || in.get() != 0xD8) {
+        return false;
+    }
+    
+    while (in) {
+        // Find the next marker, skipping fill bytes.
+        if (in.get() != 0xFF) {
+            return false;
+        }
+        int marker = in.get();
+        while (marker == 0xFF) {
+            marker = in.get();
+        }
+        if (marker == EOF || marker == 0xD9 || marker == 0xDA) {
+            return false; // End of image or start of scan before a frame header.
+        }
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+            continue; // Markers without a segment.
+        }
+        
+        int hi = in.get();
+        int lo = in.get();
+        if (lo == EOF) {
+            return false;
+        }
+        long length = ((hi << 8) | lo) - 2;
+        if (length < 0) {
+            return false;
+        }
+        long dataOffset = (long) in.tellg();
+        
+        bool frame = marker >= 0xC0 && marker <= 0xCF &&
+                marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+        if (frame) {
+            // Start of frame: precision, height, width.
+            if (length < 5) {
+                return false;
+            }
+            in.get();
+            myHeight = (in.get() << 8);
+            myHeight = myHeight | in.get();
+            myWidth = (in.get() << 8);
+            myWidth = myWidth | in.get();
+            return in && myWidth > 0 && myHeight > 0;
+        }
+        
+        if (marker == 0xE1 && length > 6) {
+            // Possibly EXIF.
+            vector<unsigned char> exif(length);
+            in.read((char*) &exif[0], length);
+            if ( ! in) {
+                return false;
+            }
+            if (exif[0] == 'E' && exif[1] == 'x' && exif[2] == 'i' && exif[3] == 'f'
+                    && exif[4] == 0 && exif[5] == 0) {
+                exif.erase(exif.begin(), exif.begin() + 6);
+                readExif(exif, dataOffset + 6);
+            }
+        }
+        else {
+            in.seekg(dataOffset + length);
+        }
+    }
+    return false;
+}
+
+/**
+ * Find the orientation and thumbnail in an EXIF (TIFF) block. Malformed
+ * blocks are ignored.
+ * @param exif The block, starting at the TIFF header.
+ * @param fileOffset The file offset of the TIFF header.
+ */
+void JpegHeader::readExif(const vector<unsigned char>& exif, long fileOffset) {
+    if (exif.size() < 8) {
+        return;
+    }
+    bool motorola = exif[0] == 'M';
+    if ( ! motorola && exif[0] != 'I') {
+        return;
+    }
+    
+    // IFD0 holds the orientation. IFD1 describes the thumbnail.
+    unsigned long ifd = exifInt(exif, 4, 4, motorola);
+    for (wxInt32 n = 0; n < 2 && ifd != 0 && ifd + 2 <= exif.size(); n++) {
+        unsigned long entries = exifInt(exif, ifd, 2, motorola);
+        if (ifd + 2 + entries * 12 + 4 > exif.size()) {
+            return;
+        }
+        long thumbOffset = -1;
+        long thumbLength = 0;
+        for (unsigned long e = 0; e < entries; e++) {
+            size_t entry = ifd + 2 + e * 12;
+            unsigned long tag = exifInt(exif, entry, 2, motorola);
+            unsigned long type = exifInt(exif, entry + 2, 2, motorola);
+            // SHORT values sit in the first 2 bytes of the value field, LONG in 4.
+            unsigned long value = type == 3 ? exifInt(exif, entry + 8, 2, motorola)
+                                            : exifInt(exif, entry + 8, 4, motorola);
+            if (n == 0 && tag == TAG_ORIENTATION && value >= 1 && value <= 8) {
+                myOrientation = value;
+            }
+            if (n == 1 && tag == TAG_THUMBNAILOFFSET) {
+                thumbOffset = value;
+            }
+            if (n == 1 && tag == TAG_THUMBNAILLENGTH) {
+                thumbLength = value;
+            }
+        }
+        if (thumbOffset > 0 && thumbLength > 0 &&
+                (unsigned long) (thumbOffset + thumbLength) <= exif.size()) {
+            myThumbnailOffset = fileOffset + thumbOffset;
+            myThumbnailLength = thumbLength;
+        }
+        ifd = exifInt(exif, ifd + 2 + entries * 12, 4, motorola);
+    }
+}
+
+/** @return The image width in pixels. */
+wxInt32 JpegHeader::getWidth() {
+    return myWidth;
+}
+
+/** @return The image height in pixels. */
+wxInt32 JpegHeader::getHeight() {
+    return myHeight;
+}
+
+/** @return The EXIF orientation, 1 (upright) to 8. */
+wxInt32 JpegHeader::getOrientation() {
+    return myOrientation;
+}
+
+/** @return The file offset of the EXIF thumbnail JPEG, or -1 if there is none. */
+long JpegHeader::getThumbnailOffset() {
+    return myThumbnailOffset;
+}
+
+/** @return The length of the EXIF thumbnail JPEG in bytes, or 0. */
+long JpegHeader::getThumbnailLength() {
+    return myThumbnailLength;
+}
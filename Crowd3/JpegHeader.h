@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef JPEGHEADER_H
+#define	JPEGHEADER_H
+
+#include <wx/defs.h>
+#include <string>
+#include <vector>
+using namespace std;
+
+/**
+ * Read the facts Crowd3 needs about a JPEG file from its header, without
+ * decoding the image: the image size, the EXIF orientation and where the EXIF
+ * thumbnail is. Reading stops at the first frame header, so only the first
+ * few kilobytes of the file are read. Uses no wxWidgets objects, so it may be
+ * used on any thread.<p>
+ * Usage:<p><code>
+ * JpegHeader h;<p>
+ * if (h.read(path)) w = h.getWidth(); ...<p></code>
+ */
+class JpegHeader {
+public:
+    JpegHeader();
+    bool read(const string& path);
+    wxInt32 getWidth();
+    wxInt32 getHeight();
+    wxInt32 getOrientation();
+    long getThumbnailOffset();
+    long getThumbnailLength();
+
+private:
+    void readExif(const vector<unsigned char>& exif, long fileOffset);
+
+    /** The image width in pixels, or 0 if unknown. */
+    wxInt32 myWidth;
+
+    /** The image height in pixels, or 0 if unknown. */
+    wxInt32 myHeight;
+
+    /** The EXIF orientation, 1 to 8. 1 (upright) if there is none. */
+    wxInt32 myOrientation;
+
+    /** The file offset of the EXIF thumbnail JPEG, or -1 if there is none. */
+    long myThumbnailOffset;
+
+    /** The length of the EXIF thumbnail JPEG in bytes, or 0. */
+    long myThumbnailLength;
+};
+
+#endif	/* JPEGHEADER_H */
@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "LayerCache.h"
+
+/** Create an empty cache with the default budget. */
+LayerCache::LayerCache() {
+    myBudget = 256.0 * 1024 * 1024;
+    myBytes = 0;
+    myClock = 0;
+}
+
+/**
+ * Set the memory budget. Layers are dropped at once if over it.
+ * @param megabytes The budget in megabytes.
+ */
+void LayerCache::setBudget(wxInt32 megabytes) {
+    myBudget = max(0, megabytes) * 1024.0 * 1024.0;
+    trim(NULL);
+}
+
+/**
+ * Find the layer of a crowd row.
+ * @param row The crowd row.
+ * @param key What the row's layer must show.
+ * @return The layer, or NULL if the row's layer is missing or shows
+ * something else.
+ */
+RowLayer* LayerCache::find(wxInt32 row, const wxString& key) {
+    std::map<wxInt32, RowLayer>::iterator it = myLayers.find(row);
+    if (it == myLayers.end() || ! it->second.key.IsSameAs(key)) {
+        return NULL;
+    }
+    it->second.lastUse = ++myClock;
+    return &it->second;
+}
+
+/**
+ * Keep a newly painted layer of a crowd row in place of its old layer.
+ * Less recently used layers are dropped to make room. A layer larger than the
+ * whole budget is not cached, but stays usable until the next store().
+ * @param row The crowd row.
+ * @param aLayer The layer.
+ * @return The kept layer. Valid until the next store() or clear().
+ */
+RowLayer* LayerCache::store(wxInt32 row, const RowLayer& aLayer) {
+    std::map<wxInt32, RowLayer>::iterator old = myLayers.find(row);
+    if (old != myLayers.end()) {
+        myBytes -= bytes(old->second);
+        myLayers.erase(old);
+    }
+    if (bytes(aLayer) > myBudget) {
+        myUncached = aLayer;
+        return &myUncached;
+    }
+    RowLayer& kept = myLayers[row];
+    kept = aLayer;
+    kept.lastUse = ++myClock;
+    myBytes += bytes(kept);
+    trim(&kept);
+    return &kept;
+}
+
+/** Drop every layer. */
+void LayerCache::clear() {
+    myLayers.clear();
+    myUncached = RowLayer();
+    myBytes = 0;
+}
+
+/**
+ * Start an empty, transparent layer.
+ * @param aLayer The layer.
+ * @param key What the layer will show.
+ * @param area The canvas area the layer covers.
+ */
+void LayerCache::startLayer(RowLayer& aLayer, const wxString& key, Rect area) {
+    aLayer.key = key;
+    aLayer.area = area;
+    aLayer.pixels = Mat::zeros(area.height, area.width, CV_8UC4);
+    aLayer.radius = -1;
+    aLayer.blurred.release();
+    aLayer.lastUse = 0;
+}
+
+/**
+ * Paint a person over a layer. The person's pixels are visible where their
+ * alpha reaches wxImage's transparency threshold, as the compositors decide,
+ * and are painted opaque.
+ * @param aLayer The layer.
+ * @param aPerson The scaled person image, 8-bit RGBA with straight alpha.
+ * @param at The canvas position of the person's top left pixel.
+ */
+void LayerCache::paint(RowLayer& aLayer, const Mat& aPerson, Point at) {
+    Rect onLayer = Rect(at.x, at.y, aPerson.cols, aPerson.rows) & aLayer.area;
+    if (onLayer.area() == 0) {
+        return;
+    }
+    Mat region = aPerson(Rect(onLayer.x - at.x, onLayer.y - at.y,
+                              onLayer.width, onLayer.height));
+    Mat alpha(region.size(), CV_8UC1);
+    wxInt32 alphaOnly[] = {3, 0};
+    mixChannels(&region, 1, &alpha, 1, alphaOnly, 1);
+    Mat visible = alpha >= wxIMAGE_ALPHA_THRESHOLD;
+    
+    // Opaque pixels are their own premultiplied values.
+    Mat rgb;
+    cvtColor(region, rgb, CV_RGBA2RGB);
+    Mat opaque;
+    cvtColor(rgb, opaque, CV_RGB2RGBA);
+    Mat target = aLayer.pixels(Rect(onLayer.x - aLayer.area.x, onLayer.y - aLayer.area.y,
+                                    onLayer.width, onLayer.height));
+    opaque.copyTo(target, visible);
+}
+
+/**
+ * Blend a layer, blurred, over a canvas: canvas = layer + canvas * (1 - alpha).
+ * The blurred copy is kept with the layer, so stacking a cached layer again
+ * with the same radius does not blur it again. The layer must come from
+ * find() or store(). The Gaussian has the variance
+ * of wxImage::Blur()'s box, as the compositors' blurs do.
+ * @param canvas The canvas, 8-bit RGB.
+ * @param aLayer The layer.
+ * @param radius The blur radius, in canvas pixels.
+ */
+void LayerCache::stack(Mat& canvas, RowLayer& aLayer, wxInt32 radius) {
+    if (aLayer.pixels.empty()) {
+        return;
+    }
+    if (radius > 0 && radius != aLayer.radius) {
+        // Blur premultiplied pixels, so colours do not bleed from the
+        // transparent black around the people. Spread into a margin.
+        double before = bytes(aLayer);
+        double sigma = sqrt(radius * (radius + 1) / 3.0);
+        wxInt32 reach = (wxInt32) ceil(3 * sigma) + 1;
+        copyMakeBorder(aLayer.pixels, aLayer.blurred, reach, reach, reach, reach,
+                       BORDER_CONSTANT, Scalar::all(0));
+        GaussianBlur(aLayer.blurred, aLayer.blurred, Size(0, 0), sigma, sigma,
+                     BORDER_CONSTANT);
+        aLayer.blurredArea = Rect(aLayer.area.x - reach, aLayer.area.y - reach,
+                                  aLayer.area.width + 2 * reach,
+                                  aLayer.area.height + 2 * reach);
+        aLayer.radius = radius;
+        if (&aLayer != &myUncached) {
+            // The blurred copy counts against the budget too.
+            myBytes += bytes(aLayer) - before;
+            trim(&aLayer);
+        }
+    }
+    const Mat& source = radius > 0 ? aLayer.blurred : aLayer.pixels;
+    Rect sourceArea = radius > 0 ? aLayer.blurredArea : aLayer.area;
+    Rect onCanvas = sourceArea & Rect(0, 0, canvas.cols, canvas.rows);
+    if (onCanvas.area() == 0) {
+        return;
+    }
+    Mat layer = source(Rect(onCanvas.x - sourceArea.x, onCanvas.y - sourceArea.y,
+                            onCanvas.width, onCanvas.height));
+    
+    // Split into premultiplied colour and 1 - alpha for each colour channel.
+    Mat premultiplied;
+    cvtColor(layer, premultiplied, CV_RGBA2RGB);
+    Mat alpha(layer.size(), CV_8UC1);
+    wxInt32 alphaOnly[] = {3, 0};
+    mixChannels(&layer, 1, &alpha, 1, alphaOnly, 1);
+    Mat transparency = Scalar::all(255) - alpha;
+    Mat planes[] = {transparency, transparency, transparency};
+    Mat transparency3;
+    merge(planes, 3, transparency3);
+    
+    Mat target = canvas(onCanvas);
+    multiply(target, transparency3, target, 1.0 / 255);
+    add(target, premultiplied, target);
+}
+
+/**
+ * @param aLayer A layer.
+ * @return The bytes of pixels it holds.
+ */
+double LayerCache::bytes(const RowLayer& aLayer) {
+    return (double) aLayer.pixels.total() * aLayer.pixels.elemSize() +
+           (double) aLayer.blurred.total() * aLayer.blurred.elemSize();
+}
+
+/**
+ * Drop the least recently used layers until the cache is within its budget.
+ * @param keep A layer never to drop, or NULL.
+ */
+void LayerCache::trim(const RowLayer *keep) {
+    while (myBytes > myBudget) {
+        std::map<wxInt32, RowLayer>::iterator oldest = myLayers.end();
+        for (std::map<wxInt32, RowLayer>::iterator it = myLayers.begin();
+                it != myLayers.end(); it++) {
+            if (&it->second != keep &&
+                    (oldest == myLayers.end() || it->second.lastUse < oldest->second.lastUse)) {
+                oldest = it;
+            }
+        }
+        if (oldest == myLayers.end()) {
+            return; // Only the kept layer is left.
+        }
+        myBytes -= bytes(oldest->second);
+        myLayers.erase(oldest);
+    }
+}
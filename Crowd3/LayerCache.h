@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef LAYERCACHE_H
+#define	LAYERCACHE_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <wx/wx.h>
+#include "const.h"
+#include <map>
+using namespace cv;
+
+/** One crowd row painted on its own: its people over transparency. */
+struct RowLayer {
+    /** Identifies what was painted: the row's people and their placements. */
+    wxString key;
+    
+    /** The canvas area of pixels. */
+    Rect area;
+    
+    /** The row's people, 8-bit RGBA with premultiplied alpha. */
+    Mat pixels;
+    
+    /** The blur radius of blurred, or -1 if there is no blurred copy. */
+    wxInt32 radius;
+    
+    /** The canvas area of blurred. Larger than area, as the blur spreads. */
+    Rect blurredArea;
+    
+    /** pixels blurred with radius, or empty if radius is 0. */
+    Mat blurred;
+    
+    /** When the layer was last used. Larger is more recent. */
+    long lastUse;
+};
+
+/**
+ * Row layers kept between renders, one per crowd row, so that a crowd image
+ * can be stacked again without repainting the rows that did not change. The
+ * layers' pixels stay within a memory budget; the least recently used layers
+ * are dropped first.<p>
+ * Usage:<p><code>
+ * LayerCache layers;<p>
+ * layers.setBudget(megabytes);<p>
+ * RowLayer *aLayer = layers.find(row, key);<p>
+ * if (aLayer == NULL) { paint a RowLayer fresh; aLayer = layers.store(row, fresh); }<p>
+ * layers.stack(canvas, *aLayer, radius);<p></code>
+ */
+class LayerCache {
+public:
+    LayerCache();
+    void setBudget(wxInt32 megabytes);
+    RowLayer* find(wxInt32 row, const wxString& key);
+    RowLayer* store(wxInt32 row, const RowLayer& aLayer);
+    void clear();
+    static void startLayer(RowLayer& aLayer, const wxString& key, Rect area);
+    static void paint(RowLayer& aLayer, const Mat& aPerson, Point at);
+    void stack(Mat& canvas, RowLayer& aLayer, wxInt32 radius);
+
+private:
+    static double bytes(const RowLayer& aLayer);
+    void trim(const RowLayer *keep);
+    
+    /** The cached layers, by crowd row. */
+    std::map<wxInt32, RowLayer> myLayers;
+    
+    /** A layer too large for the budget, kept for the render using it. */
+    RowLayer myUncached;
+    
+    /** The budget in bytes. */
+    double myBudget;
+    
+    /** The bytes of pixels held by myLayers. */
+    double myBytes;
+    
+    /** Counts uses, to order the layers by their last use. */
+    long myClock;
+};
+
+#endif	/* LAYERCACHE_H */
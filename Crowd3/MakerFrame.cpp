@@ -43,8 +43,11 @@ wxString sizeChoices[] = {
 MakerFrame::MakerFrame(const wxString &title) : wxFrame((wxFrame*) NULL, wxID_ANY, title) {
     this->SetIcon(Icon::getIcon(Icon::iMake2));
     
-    // Initialize the CrowdMaker object.
+    // Initialize the CrowdMaker object. Nothing is being painted yet.
     cm = new CrowdMaker();
+    renderer = NULL;
+    renderGeneration = 0;
+    exporter = NULL;
     
     // Initialize the window panels, buttons, and controls.
     initPanels();
@@ -52,6 +55,12 @@ MakerFrame::MakerFrame(const wxString &title) : wxFrame((wxFrame*) NULL, wxID_AN
     initHandlers();
 }
 
+/** Stop any crowd image render and finish any save before the window goes away. */
+MakerFrame::~MakerFrame() {
+    stopRender();
+    stopExport();
+}
+
 /**
  * Create and initialize panels in the maker window: controls (top) panel and 
  * buttons and image (bottom) panels.
@@ -88,6 +97,9 @@ void MakerFrame::initPanels() {
     // Add sizer panel to the maker window.
     // Set window position and size to last used or default.
     this->SetSizer(windowSizer);
+    
+    // The status bar shows render progress.
+    this->CreateStatusBar();
     this->SetPosition(Settings::getMakerLocation());
     this->SetSize(Settings::getMakerSize());
 }
@@ -101,10 +113,10 @@ void MakerFrame::initControls() {
             -1,
             Tools::int2wx(cm->getPeopleCount()),
             wxDefaultPosition,
-            wxSize(60, -1),
+            wxSize(75, -1), // Room for MAXPEOPLE's six digits.
             wxSP_ARROW_KEYS,
             1,
-            1000,
+            MAXPEOPLE,
             10,
             _T(""));
     peopleCtrl->SetToolTip(_T("Enter number of people in the crowd"));
@@ -224,6 +236,14 @@ void MakerFrame::initHandlers() {
             wxMouseEventHandler(MakerFrame::cancel),  NULL, this);
     this->Connect(wxEVT_CLOSE_WINDOW, 
             wxMouseEventHandler(MakerFrame::cancel),  NULL, this);
+    
+    // Init render thread handlers.
+    this->Connect(wxEVT_CROWD_PREVIEW,
+            wxCommandEventHandler(MakerFrame::crowdPreview), NULL, this);
+    this->Connect(wxEVT_CROWD_DONE,
+            wxCommandEventHandler(MakerFrame::crowdDone),    NULL, this);
+    this->Connect(wxEVT_CROWD_SAVED,
+            wxCommandEventHandler(MakerFrame::crowdSaved),   NULL, this);
 }
 
 /**
@@ -244,7 +264,7 @@ void MakerFrame::iSizer(wxEvent &event) {
             _T("Select a background image file"),
             backgroundDir,
             _T(""),
-            _T("JPEG files (*.jpg, *.JPG)|*.jpg;*.JPG"),
+            Tools::imageFileFilter(),
             wxFD_OPEN | wxFD_FILE_MUST_EXIST);
         if (bd->ShowModal() == wxID_CANCEL) {
             // Cancelled.  Restore default size value and clear background path.
@@ -272,9 +292,26 @@ void MakerFrame::iSizer(wxEvent &event) {
 #endif
 }
 
-/** Make command button pressed. */
+/**
+ * Make command button pressed. Ctrl-click instead replaces one person of the
+ * current crowd, repainting only around them.
+ */
 void MakerFrame::make(wxMouseEvent &event) {
     try {
+        // A new Make replaces any render or banded save in progress.
+        stopRender();
+        stopBandedExport();
+        if (event.ControlDown()) {
+            cm->setDraftSize(imagePanel->GetClientSize());
+            if (cm->replacePeople(1)) {
+                startRender();
+            }
+            else {
+                logReadErrors();
+            }
+            return;
+        }
+        
         // Transfer crowd settings to the crowd maker.
         cm->setPeopleCount(peopleCtrl->GetValue());
         cm->setPerspective(perCtrl->GetValue());
@@ -295,36 +332,74 @@ void MakerFrame::make(wxMouseEvent &event) {
             cm->setBackgroundPath(_T(""));
         }
         
-        // Create and display the crowd image.
-        cm->makeCrowdImage(this);
-        imagePanel->setImage(cm->getCrowdImage());
-	sndPlaySound("C:\User\Desktop\"AnyPang_Game" ,SND_ASYNCISND_NODEFAULT);
+        // Create and display a draft of the crowd image. The full resolution
+        // image is painted when it is saved.
+        cm->setDraftSize(imagePanel->GetClientSize());
+        if (cm->makeCrowdImage()) {
+            startRender();
+        }
     }
     catch (Exception e) {
         Tools::log(Tools::str2wx(e.msg) + _T("\nError on Make operation"));
     }
 }
 
-/** Shuffle People command button pressed. */
+/**
+ * Shuffle People command button pressed. Ctrl-click swaps one pair of people,
+ * repainting only around them.
+ */
 void MakerFrame::shuffle(wxMouseEvent &event) {
     try {
-        cm->shuffle(this);
-        imagePanel->setImage(cm->getCrowdImage());
-	sndPlaySound("C:\User\Desktop\"AnyPang_Game" ,SND_ASYNCISND_NODEFAULT);
+        stopRender();
+        stopBandedExport();
+        cm->setDraftSize(imagePanel->GetClientSize());
+        if (event.ControlDown()) {
+            if (cm->swapPeople(1)) {
+                startRender();
+            }
+            else {
+                logReadErrors();
+            }
+            return;
+        }
+        if (cm->shuffle()) {
+            startRender();
+        }
     }
     catch (Exception e) {
         Tools::log(Tools::str2wx(e.msg) + _T("\nError on Shuffle operation"));
     }
 }
 
-/** Save Crowd Photo command button pressed.*/
+/**
+ * Save Crowd Photo command button pressed. Crowd images of more than
+ * BANDEDPIXELS pixels, and any crowd image on Shift-click, are painted at full
+ * resolution in bands straight into the file. The encoder settings are asked
+ * for once the file is chosen. While the crowd image is being painted or
+ * saved, the user is asked to wait.
+ */
 void MakerFrame::save(wxMouseEvent &event) {
+    if (renderer != NULL || exporter != NULL) {
+        // The crowd image is not finished or is still being saved. Say so
+        // rather than ignore the click; the status line is busy with progress.
+        wxString busyMsg = exporter != NULL || pendingSavePath.Length() > 0 ?
+                _T("The crowd image is still being saved.\n"
+                   "Please save again when the status line shows \"Saved\".") :
+                _T("The crowd image is still being painted.\n"
+                   "Please save it when it is finished.");
+        wxMessageDialog *busy = new wxMessageDialog(this, busyMsg, _T("Please wait"),
+                wxOK | wxICON_INFORMATION, wxDefaultPosition);
+        busy->ShowModal();
+        busy->Destroy();
+        return;
+    }
     wxFileDialog *sd = new wxFileDialog(
             this,
             _T("Save the crowd image"),
             Settings::getCrowdPath(),
             _T(""),
-            _T("JPEG files (*.jpg, *.JPG)|*.jpg;*.JPG"),
+            _T("JPEG files (*.jpg, *.JPG)|*.jpg;*.JPG|PNG files (*.png, *.PNG)|*.png;*.PNG|")
+            _T("TIFF files (*.tif, *.TIF)|*.tif;*.TIF;*.tiff;*.TIFF"),
             wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
     if (sd->ShowModal() == wxID_CANCEL) {
         return;
@@ -332,15 +407,263 @@ void MakerFrame::save(wxMouseEvent &event) {
     // Save the selected folder in settings.  Save the crowd image.
     Settings::setCrowdPath(sd->GetDirectory());
     wxString targetFile = sd->GetFilename();
-    if ( ! targetFile.EndsWith(_T(".jpg"))) {
+    if (sd->GetFilterIndex() == 1) {
+        if ( ! targetFile.Lower().EndsWith(_T(".png"))) {
+            targetFile.Append(_T(".png"));
+        }
+    }
+    else if (sd->GetFilterIndex() == 2) {
+        if ( ! targetFile.Lower().EndsWith(_T(".tif")) &&
+                ! targetFile.Lower().EndsWith(_T(".tiff"))) {
+            targetFile.Append(_T(".tif"));
+        }
+    }
+    else if ( ! targetFile.Lower().EndsWith(_T(".jpg"))) {
         targetFile.Append(_T(".jpg"));
     }
     targetFile = sd->GetDirectory() + SEPARATOR + targetFile;
-    wxImage *theCrowd = new wxImage(cm->getCrowdImage());
-    theCrowd->SaveFile(targetFile, wxBITMAP_TYPE_JPEG);
+    if ( ! chooseSaveOptions(targetFile)) {
+        return;
+    }
+    
+    wxSize fullSize = cm->getImageSize();
+    if (event.ShiftDown() ||
+            fullSize.GetWidth() * (double) fullSize.GetHeight() > BANDEDPIXELS) {
+        // Too large to hold in memory: paint and write it band by band.
+        startExport(new CrowdExporter(this, cm, targetFile,
+                                      CrowdExporter::savedOptions()));
+        return;
+    }
+    if (cm->isDraft()) {
+        // Paint the same crowd at full resolution, then save it.
+        cm->setDraftSize(wxDefaultSize);
+        startRender();
+        if (renderer != NULL) {
+            pendingSavePath = targetFile;
+        }
+        return;
+    }
+    writeCrowd(targetFile);
+}
+
+/**
+ * Ask the user for the encoder settings of the file type being saved, and save
+ * them in the user preferences for CrowdExporter::savedOptions(). TIFF files
+ * have no settings to ask for.
+ * @param targetFile The file path. A .png extension asks for PNG settings,
+ * .tif or .tiff none, else JPEG settings.
+ * @return false if the user cancelled, else true.
+ */
+bool MakerFrame::chooseSaveOptions(const wxString& targetFile) {
+    wxString lowerFile = targetFile.Lower();
+    if (lowerFile.EndsWith(_T(".tif")) || lowerFile.EndsWith(_T(".tiff"))) {
+        return true;
+    }
+    bool png = lowerFile.EndsWith(_T(".png"));
+    wxDialog *od = new wxDialog(this, -1, png ? _T("PNG options") : _T("JPEG options"));
+    wxFlexGridSizer *optionsSizer = new wxFlexGridSizer(0, 2, 5, 5);
+    wxSpinCtrl *levelCtrl = NULL;
+    wxSpinCtrl *qualityCtrl = NULL;
+    wxCheckBox *progressiveCtrl = NULL;
+    wxSpinCtrl *restartCtrl = NULL;
+    if (png) {
+        wxInt32 level = Settings::getPngCompression();
+        wxStaticText *levelLabel = new wxStaticText(od, -1, _T("Compression:"));
+        levelCtrl = new wxSpinCtrl(od, -1, Tools::int2wx(level), wxDefaultPosition,
+                                   wxSize(75, -1), wxSP_ARROW_KEYS, 0, 9, level, _T(""));
+        levelCtrl->SetToolTip(_T("0 saves fastest, 9 saves the smallest file"));
+        optionsSizer->Add(levelLabel, 0, wxALIGN_CENTRE_VERTICAL);
+        optionsSizer->Add(levelCtrl,  0, wxALIGN_CENTRE_VERTICAL);
+    }
+    else {
+        wxInt32 quality = Settings::getJpegQuality();
+        wxStaticText *qualityLabel = new wxStaticText(od, -1, _T("Quality:"));
+        qualityCtrl = new wxSpinCtrl(od, -1, Tools::int2wx(quality), wxDefaultPosition,
+                                     wxSize(75, -1), wxSP_ARROW_KEYS, 0, 100, quality,
+                                     _T(""));
+        qualityCtrl->SetToolTip(_T("Higher quality makes a larger file"));
+        
+        wxStaticText *progressiveLabel = new wxStaticText(od, -1, _T("Progressive:"));
+        progressiveCtrl = new wxCheckBox(od, -1, _T(""), wxDefaultPosition,
+                                         wxDefaultSize, wxCHK_2STATE);
+        progressiveCtrl->SetValue(Settings::getJpegProgressive());
+        progressiveCtrl->SetToolTip(_T("Show a coarse image first while it loads"));
+        
+        wxInt32 interval = Settings::getJpegRestartInterval();
+        wxStaticText *restartLabel = new wxStaticText(od, -1, _T("Restart interval:"));
+        restartCtrl = new wxSpinCtrl(od, -1, Tools::int2wx(interval), wxDefaultPosition,
+                                     wxSize(75, -1), wxSP_ARROW_KEYS, 0, 65535, interval,
+                                     _T(""));
+        restartCtrl->SetToolTip(_T("Rows of blocks between restart markers, or 0 for none"));
+        
+        optionsSizer->Add(qualityLabel,     0, wxALIGN_CENTRE_VERTICAL);
+        optionsSizer->Add(qualityCtrl,      0, wxALIGN_CENTRE_VERTICAL);
+        optionsSizer->Add(progressiveLabel, 0, wxALIGN_CENTRE_VERTICAL);
+        optionsSizer->Add(progressiveCtrl,  0, wxALIGN_CENTRE_VERTICAL);
+        optionsSizer->Add(restartLabel,     0, wxALIGN_CENTRE_VERTICAL);
+        optionsSizer->Add(restartCtrl,      0, wxALIGN_CENTRE_VERTICAL);
+    }
+    wxBoxSizer *dialogSizer = new wxBoxSizer(wxVERTICAL);
+    dialogSizer->Add(optionsSizer, 0, wxALL, 10);
+    dialogSizer->Add(od->CreateButtonSizer(wxOK | wxCANCEL), 0, wxEXPAND | wxALL, 10);
+    od->SetSizerAndFit(dialogSizer);
+    
+    bool accepted = od->ShowModal() == wxID_OK;
+    if (accepted && png) {
+        Settings::setPngCompression(levelCtrl->GetValue());
+    }
+    else if (accepted) {
+        Settings::setJpegQuality(qualityCtrl->GetValue());
+        Settings::setJpegProgressive(progressiveCtrl->GetValue());
+        Settings::setJpegRestartInterval(restartCtrl->GetValue());
+    }
+    od->Destroy();
+    return accepted;
+}
+
+/**
+ * Write the crowd image to a file on a background thread, using the encoder
+ * settings from the user preferences.
+ * @param targetFile The file path. A .png extension writes PNG, else JPEG.
+ */
+void MakerFrame::writeCrowd(wxString targetFile) {
+    startExport(new CrowdExporter(this, cm->getCrowdImage(), targetFile,
+                                  CrowdExporter::savedOptions()));
+}
+
+/**
+ * Start a save thread.
+ * @param anExporter The new, not yet started, save thread.
+ */
+void MakerFrame::startExport(CrowdExporter *anExporter) {
+    exporter = anExporter;
+    if (exporter->Create() != wxTHREAD_NO_ERROR || exporter->Run() != wxTHREAD_NO_ERROR) {
+        Tools::log(_T("The crowd image save thread could not be started"));
+        delete exporter;
+        exporter = NULL;
+        return;
+    }
+    SetStatusText(_T("Saving..."));
+}
+
+/** Wait for the save in progress, if any, to finish writing its file. A
+ * banded save is cancelled instead, and its file deleted. */
+void MakerFrame::stopExport() {
+    if (exporter != NULL) {
+        exporter->cancel();
+        exporter->Wait();
+        delete exporter;
+        exporter = NULL;
+    }
+}
+
+/** Cancel the banded save in progress, if any, so the crowd maker can be used. */
+void MakerFrame::stopBandedExport() {
+    if (exporter != NULL && exporter->isBanded()) {
+        stopExport();
+        SetStatusText(_T(""));
+    }
+}
+
+/**
+ * The save thread ended.
+ * @param event GetInt() is 1 if the file was written.
+ */
+void MakerFrame::crowdSaved(wxCommandEvent &event) {
+    if (exporter == NULL) {
+        return;
+    }
+    bool banded = exporter->isBanded();
+    stopExport();
+    if (banded) {
+        logReadErrors();
+    }
+    if (event.GetInt() == 1) {
+        SetStatusText(_T("Saved"));
+    }
+    else {
+        SetStatusText(_T(""));
+        Tools::log(_T("Error on Save operation"));
+    }
 }
 
 /** Cancel operation command button pressed. */
 void MakerFrame::cancel(wxMouseEvent &event) {
+    stopRender();
     Hide();
 }
+
+/** Start painting the crowd image chosen by the crowd maker on a background thread. */
+void MakerFrame::startRender() {
+    logReadErrors();
+    renderGeneration++;
+    renderer = new CrowdRenderer(this, cm, imagePanel->GetClientSize(), renderGeneration);
+    if (renderer->Create() != wxTHREAD_NO_ERROR || renderer->Run() != wxTHREAD_NO_ERROR) {
+        Tools::log(_T("The crowd image thread could not be started"));
+        delete renderer;
+        renderer = NULL;
+        return;
+    }
+    SetStatusText(_T("Starting..."));
+}
+
+/** Cancel the render in progress, if any, and wait for its thread to end. */
+void MakerFrame::stopRender() {
+    if (renderer != NULL) {
+        renderer->cancel();
+        renderer->Wait();
+        delete renderer;
+        renderer = NULL;
+        pendingSavePath = _T("");
+        SetStatusText(_T(""));
+    }
+}
+
+/**
+ * A partly painted crowd image arrived from the render thread. Display it.
+ * @param event Holds the preview image, owned by this handler.
+ */
+void MakerFrame::crowdPreview(wxCommandEvent &event) {
+    wxImage *preview = (wxImage*) event.GetClientData();
+    if (event.GetExtraLong() == renderGeneration && renderer != NULL) {
+        imagePanel->setImage(*preview);
+        SetStatusText(_T("Images added: ") + Tools::int2wx(event.GetInt()));
+    }
+    delete preview;
+}
+
+/**
+ * The render thread ended. Display the finished crowd image.
+ * @param event GetInt() is 1 if the crowd image is complete.
+ */
+void MakerFrame::crowdDone(wxCommandEvent &event) {
+    if (event.GetExtraLong() != renderGeneration || renderer == NULL) {
+        return; // From a render that was already stopped.
+    }
+    renderer->Wait();
+    delete renderer;
+    renderer = NULL;
+    SetStatusText(_T(""));
+    logReadErrors();
+    
+    if (event.GetInt() == 1) {
+        imagePanel->setImage(cm->getCrowdImage());
+	sndPlaySound("C:\User\Desktop\"AnyPang_Game" ,SND_ASYNCISND_NODEFAULT);
+        if (pendingSavePath.Length() > 0) {
+            writeCrowd(pendingSavePath);
+        }
+    }
+    pendingSavePath = _T("");
+}
+
+/**
+ * Log the files the crowd maker could not read. Render threads keep their
+ * errors in the crowd maker, since only the main thread may log. Call only
+ * while no render or banded save is using the crowd maker.
+ */
+void MakerFrame::logReadErrors() {
+    std::vector<string> errors = cm->takeReadErrors();
+    for (size_t i = 0; i < errors.size(); i++) {
+        Tools::log(Tools::str2wx(errors[i]));
+    }
+}
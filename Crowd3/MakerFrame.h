@@ -37,6 +37,8 @@
 #include <wx/sizer.h>
 #include <wx/msgdlg.h>
 #include <wx/filedlg.h>
+#include <wx/dialog.h>
+#include <wx/checkbox.h>
 #include <wx/filepicker.h>
 #include <wx/spinctrl.h>
 #include <wx/mstream.h>
@@ -47,6 +49,8 @@
 #include "Tools.h"
 #include "Settings.h"
 #include "CrowdMaker.h"
+#include "CrowdRenderer.h"
+#include "CrowdExporter.h"
 
 /** Provide the user interface for customizing and displaying crowd images.
  * Use a CrowdMaker object to save/load preferences and create the crowd image. */
@@ -54,11 +58,26 @@ class MakerFrame : public wxFrame {
     
 public:
     MakerFrame(const wxString &title);
+    virtual ~MakerFrame();
     
 private:
     /** The crowd maker object. */
     CrowdMaker *cm;
     
+    /** The background thread painting the crowd image, or NULL. */
+    CrowdRenderer *renderer;
+    
+    /** Incremented for each render so that events from cancelled renders
+     * can be recognized and ignored. */
+    long renderGeneration;
+    
+    /** The background thread writing the crowd image file, or NULL. */
+    CrowdExporter *exporter;
+    
+    /** Where to save the crowd image when the render in progress is done, or
+     * empty. */
+    wxString pendingSavePath;
+    
     /** The top panel on the maker window.  Contains controls. */
     wxPanel *controlsPanel;
     
@@ -108,6 +127,17 @@ private:
     void shuffle(wxMouseEvent &event);
     void save(wxMouseEvent &event);
     void cancel(wxMouseEvent &event);
+    void startRender();
+    void stopRender();
+    void crowdPreview(wxCommandEvent &event);
+    void crowdDone(wxCommandEvent &event);
+    bool chooseSaveOptions(const wxString& targetFile);
+    void writeCrowd(wxString targetFile);
+    void startExport(CrowdExporter *anExporter);
+    void stopExport();
+    void stopBandedExport();
+    void crowdSaved(wxCommandEvent &event);
+    void logReadErrors();
 };
 
 #endif	/* _MAKERFRAME_H */
@@ -28,59 +28,217 @@
  */
 
 #include "PeopleFinder.h"
-using namespace cv;
+#include <wx/choicdlg.h>
 
-/** The face detection cascade object. */
-CascadeClassifier faceCascade;
-
-// Colors.
-const Scalar redColor = Scalar(0,0,255);
-const Scalar greenColor = Scalar(0,255,0);
-const Scalar blueColor = Scalar(255,0,0);
-const Scalar yellowColor = Scalar(0,255,255);
-
-// Line drawing constants.
-const wxInt32 lineWidth = 2;
-const wxInt32 lineType = 8;
-
-/** Create and initialize the PeopleFinder. */
+/**
+ * Create and initialize the PeopleFinder. The face detectors are loaded when
+ * the first search starts, so that starting the program stays quick.
+ */
 PeopleFinder::PeopleFinder() {
-    initFaceDetection();
+    myDetector = NULL;
+    myPrescreenDetector = NULL;
     initImageTypes();
 }
 
 PeopleFinder::PeopleFinder(const PeopleFinder& orig) {}
 PeopleFinder::~PeopleFinder() {}
 
-/** Initialize the PeopleFinder object by loading the face detection cascade. */
-void PeopleFinder::initFaceDetection() {
-    wxString cascadeFile = Tools::dataFolder() + SEPARATOR + FACECASCADENAME;
-    if ( ! faceCascade.load(Tools::wx2str(cascadeFile))) {
-        Tools::logFatal(cascadeFile + _T("\nThe cascade file could not be loaded"));
+/** Loads face detectors on its own thread. Parsing a cascade takes a while. */
+class DetectorLoader : public wxThread {
+public:
+    /**
+     * Create a joinable loading thread. Call Run() to start it.
+     * @param name The detector name, one of the DETECTOR_ constants.
+     * @param count The number of detectors of that kind to load.
+     */
+    DetectorLoader(wxString name, wxInt32 count) : wxThread(wxTHREAD_JOINABLE) {
+        // Plain strings, so that no wxString is shared with the main thread.
+        myName = Tools::wx2str(name);
+        myDataFolder = Tools::wx2str(Tools::dataFolder() + SEPARATOR);
+        myCacheFolder = Tools::wx2str(Tools::crowd3Folder() + SEPARATOR);
+        myCount = count;
+    }
+
+    /** The loaded detectors. Read after Wait(). */
+    vector<FaceDetector*> detectors;
+
+    /** Why the named detector could not be loaded, or empty. Read after Wait(). */
+    string error;
+
+protected:
+    /**
+     * Thread body: load the detectors. Fall back to the Haar cascade if the
+     * named detector is unavailable.
+     */
+    virtual ExitCode Entry() {
+        for (wxInt32 i = 0; i < myCount; i++) {
+            FaceDetector *d = FaceDetector::create(myName, myDataFolder, myCacheFolder, error);
+            if (d == NULL && i == 0 && myName != DETECTOR_HAAR) {
+                myName = DETECTOR_HAAR;
+                string haarError;
+                d = FaceDetector::create(myName, myDataFolder, myCacheFolder, haarError);
+            }
+            if (d == NULL) {
+                break;
+            }
+            detectors.push_back(d);
+        }
+        return 0;
+    }
+
+private:
+    /** The detector name. */
+    string myName;
+
+    /** The folder holding the detector data files, with a trailing separator. */
+    string myDataFolder;
+
+    /** The folder for converted cascades, with a trailing separator. */
+    string myCacheFolder;
+
+    /** The number of detectors to load. */
+    wxInt32 myCount;
+};
+
+/**
+ * Start loading the face detectors the next search needs, unless they are
+ * already loaded. Detectors stay loaded for later searches.
+ * @return The loading thread, or NULL if nothing needs loading.
+ */
+DetectorLoader* PeopleFinder::startLoading() {
+    wxInt32 count = 0;
+    if (myDetector == NULL) {
+        count++;
+    }
+    if (Settings::getThumbnailPrescreen() && myPrescreenDetector == NULL) {
+        count++; // The pre-screen runs on another thread, so needs its own.
+    }
+    if (count == 0) {
+        return NULL;
+    }
+    DetectorLoader *loader = new DetectorLoader(Settings::getFaceDetector(), count);
+    if (loader->Create() != wxTHREAD_NO_ERROR || loader->Run() != wxTHREAD_NO_ERROR) {
+        Tools::logFatal(_T("The face detector loading thread could not be started"));
+    }
+    return loader;
+}
+
+/**
+ * Wait for the face detectors to load. Show a progress dialog if they are not
+ * ready yet.
+ * @param parent The parent frame.
+ * @param loader The loading thread or NULL. Deleted.
+ * @return false if the search's face detector could not be loaded.
+ */
+bool PeopleFinder::finishLoading(wxFrame *parent, DetectorLoader *loader) {
+    if (loader != NULL) {
+        if (loader->IsAlive()) {
+            wxProgressDialog *wait = new wxProgressDialog(
+                    _T("Face detector"),
+                    _T("Loading the face detector..."),
+                    100,
+                    parent,
+                    wxPD_APP_MODAL | wxPD_SMOOTH);
+            while (loader->IsAlive()) {
+                wait->Pulse();
+                wxMilliSleep(PIPELINEWAIT);
+            }
+            wait->Destroy();
+        }
+        loader->Wait();
+        
+        vector<FaceDetector*> loaded = loader->detectors;
+        if (myDetector == NULL && ! loaded.empty()) {
+            myDetector = loaded[0];
+            loaded.erase(loaded.begin());
+        }
+        if ( ! loaded.empty()) {
+            myPrescreenDetector = loaded[0];
+        }
+        if (myDetector == NULL) {
+            Tools::log(Tools::str2wx(loader->error) + _T("\nNo face detector could be loaded"));
+        }
+        else if ( ! loader->error.empty()) {
+            Tools::log(Tools::str2wx(loader->error) + _T("\nUsing the Haar face detector"));
+        }
+        delete loader;
+    }
+    return myDetector != NULL;
+}
+
+/**
+ * Ask the user which face detector to use for the next search. Faster
+ * detectors miss more faces.
+ * @param parent The parent frame.
+ * @return false if the user cancelled, else true.
+ */
+bool PeopleFinder::chooseDetector(wxFrame *parent) {
+    vector<string> available = FaceDetector::available(
+            Tools::wx2str(Tools::dataFolder() + SEPARATOR));
+    wxArrayString names;
+    for (size_t i = 0; i < available.size(); i++) {
+        names.Add(Tools::str2wx(available[i]));
+    }
+    wxSingleChoiceDialog *cd = new wxSingleChoiceDialog(
+            parent,
+            _T("Select a face detector for this search"),
+            _T("Face detector"),
+            names);
+    wxInt32 current = names.Index(Settings::getFaceDetector());
+    if (current != wxNOT_FOUND) {
+        cd->SetSelection(current);
+    }
+    if (cd->ShowModal() == wxID_CANCEL) {
+        return false;
     }
+    
+    wxString chosen = cd->GetStringSelection();
+    if ( ! chosen.IsSameAs(Settings::getFaceDetector())) {
+        // The new detector is loaded when the search starts.
+        delete myDetector;
+        delete myPrescreenDetector;
+        myDetector = NULL;
+        myPrescreenDetector = NULL;
+        Settings::setFaceDetector(chosen);
+    }
+    
+    // The pre-screen trades missed people for speed on collections with few.
+    wxMessageDialog *pd = new wxMessageDialog(
+            parent,
+            _T("Search only the photos whose thumbnail shows a face?\n")
+            _T("This is much faster for photos of mostly scenery, but misses some people."),
+            _T("Thumbnail pre-screen"),
+            wxYES_NO | wxCANCEL | wxICON_QUESTION |
+            (Settings::getThumbnailPrescreen() ? wxYES_DEFAULT : wxNO_DEFAULT));
+    wxInt32 answer = pd->ShowModal();
+    if (answer == wxID_CANCEL) {
+        return false;
+    }
+    Settings::setThumbnailPrescreen(answer == wxID_YES);
+    return true;
 }
 
 /** Initialize the list of source image types to search. */
 void PeopleFinder::initImageTypes() {
-    // Search files with these extensions.
+    // Search files with the extensions of the known formats, in any case. The
+    // format itself is decided from the file contents.
+    vector<string> extensions = ImageDecoder::extensions();
     myTypes = new wxArrayString();
-    myTypes->Add(_T("*.jpg"));
-#ifdef __UNIX__
-    myTypes->Add(_T("*.JPG")); // Linux filenames are case sensitive.
-#endif
+    for (size_t i = 0; i < extensions.size(); i++) {
+        myTypes->Add(Tools::str2wx(extensions[i]));
+    }
 }
 
 /**
- * Search for people in a source image. Write the people images to disk. Write
- * an image tree/database record for the source image file stating which people
- * image files belong to it. (ImageTree is the interface to the on-screen display
- * of source image files and the on-disk database.)
+ * Decide whether a source image file must be searched for people. Files that
+ * are already in the database with unchanged modification dates are skipped
+ * unless rescan is requested. The records and people images of changed files
+ * are deleted. (ImageTree is the interface to the on-screen display of source
+ * image files and the on-disk database.)
  * @param imageFile the source image pathname.
- * @return the number of people images found.
+ * @return true if the file must be searched.
  */
-wxInt32 PeopleFinder::findPeople(wxString imageFile) {
-    // Skip source image files that are already in the database and whose
-    // modification dates have not changed unless rescan is requested.
+bool PeopleFinder::needsSearch(wxString imageFile) {
     const wxString dbDateFormat = _T("%d-%b-%Y %H:%M:%S");
     wxString dbModDate;
     wxInt32 dbFirstID = -1;
@@ -92,7 +250,7 @@ wxInt32 PeopleFinder::findPeople(wxString imageFile) {
         wxString osModDate = md.Format(dbDateFormat, wxDateTime::UTC);
         if ( (myRescan == false) && osModDate.IsSameAs(dbModDate)) {
             // Mod date has not changed. Skip this file.
-            return 0;
+            return false;
         }
         else {
             // ImageFile is in the database but the mod date has changed or a
@@ -103,151 +261,73 @@ wxInt32 PeopleFinder::findPeople(wxString imageFile) {
             deleteOldImages(dbFirstID, dbLastID);
         }
     }
+    return true;
+}
 
-    // Read the source image file.
-    string imageFilePath = Tools::wx2str(imageFile);
-    Mat theImage = imread(imageFilePath, CV_LOAD_IMAGE_UNCHANGED);
-    if ( ! theImage.data) {
-        // Unsuccessful read. Quit.
-        Tools::log(_T("An error occurred while trying to read ") +
-                Tools::str2wx(imageFilePath));
-        return 0;
-    }
-
-    // Get the next available image ID from settings. Image IDs are never reused.
-    myNextImageID = Settings::getImageID();
-
-    // Remember the first image id associated with this source image file.
-    wxInt32 firstImageID = myNextImageID;
-    wxInt32 lastImageID = -1;
-
-    // Search for faces in the source image.
-    vector<Rect> faces;
-    faces = findFaces(theImage);
-
-    // Convert grayscale images to color so that only 3-channel color images will
-    // have to be dealt with from this point on.
-    if (theImage.channels() == 1) {
-        cvtColor(theImage, theImage, CV_GRAY2BGR);
-    }
-    // Convert non unsigned 8-bit images to 8-bit images. Not sure if this can occur.
-    if (theImage.depth() != CV_8U) {
-        theImage.convertTo(theImage, CV_8UC3);
-    }
-
-    // Enlarge each detected face and assume a body beneath it.
-    for(wxInt32 i = 0; i < faces.size(); i++) {
-        Rect aFaceRect = faces[i];
-
-        // For debugging: Draw key rectangles on face. Disable call to maskHead when drawing.
-        // rectangle(theImage, aFaceRect, blueColor, 3); // Outline the face.
-        // Rect central = Rect(aFaceRect.x + aFaceRect.width/3, aFaceRect.y + aFaceRect.height/4, aFaceRect.width/3, aFaceRect.height/2);
-        // rectangle(theImage, central, redColor, 3);
-        // Rect topcentral = Rect(aFaceRect.x + aFaceRect.width/3, aFaceRect.y - aFaceRect.height/5, aFaceRect.width/3, aFaceRect.height/2);
-        // rectangle(theImage, topcentral, yellowColor, 3);
-
-        // Expand the face area to encompass the entire (mostly) head.
-        Rect head = aFaceRect;
-        head.x = head.x - ((HEADWIDTH - 1) * aFaceRect.width) / 2;
-        head.width = HEADWIDTH * aFaceRect.width;
-        head.y = head.y - ((HEADHEIGHT - 1) * aFaceRect.height);
-        head.height = HEADHEIGHT * aFaceRect.height;
-        // rectangle(theImage, head, greenColor, 2); // Outline the head.
-
-        // Assume an area below head is part of the upper body.
-        Rect body;
-        body.x = head.x - ((BODYWIDTH - 1) * head.width) / 2;
-        body.width = BODYWIDTH * head.width;
-        body.y = head.y + head.height;
-        body.height = BODYHEIGHT * head.height;
-
-        // Bounds corrections: the enlarged rectangles surrounding the head
-        // and body may extend beyond the image boundaries. Bring them back in.
-        if (head.x < 0) {
-            head.width = head.width + head.x; // Subtract head.x
-            head.x = 0;
-        }
-        if (head.y < 0) {
-            head.height = head.height + head.y; // Subtract head.y
-            head.y = 0;
-        }
-        if (head.x + head.width > theImage.cols) {
-            head.width = theImage.cols - head.x;
-        }
-        if (head.y + head.height > theImage.rows) {
-            head.height = theImage.rows - head.y;
-        }
-        if (body.x < 0) {
-            body.width = body.width + body.x; // Subtract body.x
-            body.x = 0;
-        }
-        if (body.y < 0) {
-            body.height = body.height + body.y; // Subtract body.y
-            body.y = 0;
-        }
-        if (body.x + body.width > theImage.cols) {
-            body.width = theImage.cols - body.x;
-        }
-        if (body.y + body.height > theImage.rows) {
-            body.height = theImage.rows - body.y;
-        }
-
-        // Combine head & body then scale to a standard size.
-        Mat p(theImage, Rect(body.x, head.y, body.width, head.height + body.height));
-        Mat person;
-        double scaleFactor = SCALEDFACEWIDTH/aFaceRect.width;
-        resize(p, person, Size(), scaleFactor, scaleFactor);
-
-        // Scale the face rectangle and make relative to head/body.
-        aFaceRect.x = (aFaceRect.x - body.x) * scaleFactor;
-        aFaceRect.y = (aFaceRect.y - head.y) * scaleFactor;
-        aFaceRect.width = aFaceRect.width * scaleFactor;
-        aFaceRect.height = aFaceRect.height * scaleFactor;
-
-        // Make the head rectangle relative to the top-left of the scaled person.
-        head.x = (head.x - body.x) * scaleFactor;
-        head.y = 0;
-        head.width = head.width * scaleFactor;
-        head.height = head.height * scaleFactor;
-
-        // Make regions around the head and shoulders invisible.
-        maskHead(person, head, aFaceRect);
-
-        // Write the person image to disk with uniqueImageID as filename.
-        string prefix = Tools::wx2str(Tools::crowd3Folder() + SEPARATOR);
-        string destPath = prefix + Tools::int2str(myNextImageID++) + ".png";
-        imwrite(destPath, person);
+/**
+ * Write an image tree/database record for a searched source image file
+ * stating which people image files belong to it. Called by the ScanEngine.
+ * @param result What the search found.
+ */
+void PeopleFinder::scanned(const ScanResult& result) {
+    wxString path = Tools::str2wx(result.path);
+    if ( ! result.readOK) {
+        Tools::log(_T("An error occurred while trying to read ") + path);
+        if ( ! result.skipped) {
+            // Unsuccessful decode. No record is written.
+            return;
+        }
+    }
+    if ( ! result.error.empty()) {
+        // No image IDs. No record is written, so the file is searched again
+        // next time.
+        Tools::log(Tools::str2wx(result.error) + _T("\n") + path +
+                _T("\nError reserving image IDs"));
+        return;
     }
 
-    // Write a record for this source image file.
     // Write a range of image IDs or write -1 if no image IDs.
-    wxFileName imageFileNameObject(imageFile);
+    const wxString dbDateFormat = _T("%d-%b-%Y %H:%M:%S");
+    wxFileName imageFileNameObject(path);
     wxDateTime md = imageFileNameObject.GetModificationTime();
     wxString osModDate = md.Format(dbDateFormat, wxDateTime::UTC);
-    if (firstImageID == myNextImageID) {
-        // There were no people found in this image. Write -1 for this file.
-        firstImageID = -1;
-        lastImageID = -1;
-    }
-    else {
-        // Get the last image ID for this image file.
-        lastImageID = myNextImageID - 1;
+    ImageTree::write(path, osModDate, result.firstID, result.lastID,
+                     Tools::str2wx(result.detector));
+    if (result.firstID >= 0) {
+        myFaceCount = myFaceCount + result.lastID - result.firstID + 1;
     }
-    ImageTree::write(imageFile, osModDate, firstImageID, lastImageID);
-
-    // Write the next available image ID to settings.
-    Settings::setImageID(myNextImageID);
+}
 
-    return faces.size();
+/**
+ * Update the progress dialog. Called by the ScanEngine.
+ * @return false if the user asked to stop the search.
+ */
+bool PeopleFinder::progress() {
+    wxString status = myCurrent +
+            _T("\nFiles searched: ") + Tools::int2wx(myFileCount) +
+            _T(", People found: ") + Tools::int2wx(myFaceCount);
+    if (myEngine.getAuditCount() > 0) {
+        status = status + _T("\nPre-screen checked ") +
+                Tools::int2wx(myEngine.getAuditCount()) + _T(" photos, finds ") +
+                Tools::int2wx((wxInt32) (myEngine.getPrescreenRecall() * 100.0 + 0.5)) +
+                _T("% of photos with people");
+    }
+    return myProgress->Pulse(status);
 }
 
 /**
  * Search recursively for faces in a user selected folder hierarchy.
  * @param parent The parent frame.
  * @param rescan True if the folder should be reanalyzed.
+ * @param chooseDetector True to ask the user which face detector to use.
  */
-void PeopleFinder::searchFolder(wxFrame *parent, bool rescan) {
+void PeopleFinder::searchFolder(wxFrame *parent, bool rescan, bool chooseDetector) {
     myRescan = rescan;
+    if (chooseDetector && ! this->chooseDetector(parent)) {
+        return;
+    }
+    // Load the face detectors while the user picks a folder.
+    DetectorLoader *loader = startLoading();
 
     // Ask user to select a folder to search for person images.
     wxString prompt = _T("Select a folder to search");
@@ -257,7 +337,8 @@ void PeopleFinder::searchFolder(wxFrame *parent, bool rescan) {
             prompt,
             Settings::getPersonPath(),
             wxDD_DIR_MUST_EXIST);
-    if (dd->ShowModal() == wxID_CANCEL) {
+    bool cancelled = dd->ShowModal() == wxID_CANCEL;
+    if ( ! finishLoading(parent, loader) || cancelled) {
         return;
     }
     wxString folder = dd->GetPath();
@@ -275,7 +356,7 @@ void PeopleFinder::searchFolder(wxFrame *parent, bool rescan) {
     myFaceCount = 0;
     myFileCount = 0; // Set to -1 to stop the search.
     myProgress = new wxProgressDialog(
-            _T("Searching..."),
+            _T("Searching (") + Tools::str2wx(myDetector->name()) + _T(")..."),
             _T("Searching..."),
             100,
             parent,
@@ -284,11 +365,13 @@ void PeopleFinder::searchFolder(wxFrame *parent, bool rescan) {
                         myProgress->GetSize().GetHeight());
 
     // Start the search.
-    for (wxInt32 i = 0; i < myTypes->Count(); i++) {
-        if (myFileCount >= 0) { // Search continuing...
-            dir.Traverse(*this, myTypes->Item(i), wxDIR_DIRS | wxDIR_FILES);
-        }
-    }
+    // Walk the folder hierarchy once; OnFile() picks out the image types.
+    myEngine.start(myDetector,
+                   Settings::getThumbnailPrescreen() ? myPrescreenDetector : NULL,
+                   Tools::wx2str(Tools::crowd3Folder() + SEPARATOR), this);
+    dir.Traverse(*this, wxEmptyString, wxDIR_DIRS | wxDIR_FILES);
+    myCurrent = _T("Finishing...");
+    myEngine.finish(myFileCount >= 0);
     // Search complete. Sort the new source images into the image tree.
     ImageTree::sortImageTree();
 
@@ -297,18 +380,25 @@ void PeopleFinder::searchFolder(wxFrame *parent, bool rescan) {
 
 /**
  * Called from searchFolder() with a discovered file when searching a folder hierarchy.
+ * Hand the file to the search engine unless it can be skipped.
  * @param filename The discovered file path.
  * @return Continue flag.
  */
 wxDirTraverseResult PeopleFinder::OnFile(const wxString& filename) {
-    // Find the faces in the image.
-    wxInt32 found = findPeople(filename);
-    myFaceCount = myFaceCount + found;
-    myFileCount++;
+    wxString extension = filename.AfterLast(_T('.')).Lower();
+    bool imageType = extension != filename.Lower() &&
+            myTypes->Index(extension) != wxNOT_FOUND;
+    if (imageType) {
+        myFileCount++;
+    }
+    myCurrent = filename;
+    if (imageType && needsSearch(filename) &&
+            ! myEngine.submit(Tools::wx2str(filename))) {
+        myFileCount = -1; // Stop traversing.
+        return wxDIR_STOP;
+    }
 
-    if (myProgress->Pulse(filename +
-            _T("\nFiles searched: ") + Tools::int2wx(myFileCount) +
-            _T(", People found: ") + Tools::int2wx(myFaceCount))) {
+    if (myEngine.poll()) {
         return wxDIR_CONTINUE;
     }
     else {
@@ -323,9 +413,8 @@ wxDirTraverseResult PeopleFinder::OnFile(const wxString& filename) {
  * @return Continue flag.
  */
 wxDirTraverseResult PeopleFinder::OnDir(const wxString& dirname) {
-    if (myProgress->Pulse(dirname +
-            _T("\nFiles searched: ") + Tools::int2wx(myFileCount) +
-            _T(", People found: ") + Tools::int2wx(myFaceCount))) {
+    myCurrent = dirname;
+    if (myEngine.poll()) {
         return wxDIR_CONTINUE;
     }
     else {
@@ -344,307 +433,6 @@ wxDirTraverseResult PeopleFinder::OnOpenError(const wxString& dirname) {
     return wxDIR_IGNORE;
 }
 
-/**
- * Search for faces in an image.
- * @param theImage a Mat structure containing an image.
- * @return a vector of discovered faces.
- */
-std::vector<Rect> PeopleFinder::findFaces(Mat theImage) {
-    // Convert color images to grayscale for the face search.
-    Mat theImageGray;
-    if (theImage.channels() != 1) {
-        cvtColor(theImage, theImageGray, CV_RGB2GRAY);
-        equalizeHist(theImageGray, theImageGray);
-    }
-    else {
-        theImageGray = theImage;
-    }
-
-    // Search for faces that exceed a minimum size.
-    wxInt32 faceMin = FACEPERCENT * min(theImageGray.rows, theImageGray.cols);
-    std::vector<Rect> faces;
-    faceCascade.detectMultiScale(theImageGray, faces, 1.1, 10,
-            0 |CV_HAAR_SCALE_IMAGE, Size(faceMin, faceMin));
-
-    return faces;
-}
-
-/**
- * Set pixels outside the head and shoulder areas to an "invisible" color that
- * can be detected and blended away when crowd images are created.
- * @param m A Mat structure containing a person image (head & body).
- * @param aHead The head rectangle in the person.
- * @param aFace The face rectangle discovered by face detection.
- */
-void PeopleFinder::maskHead(Mat& m, Rect aHead, Rect aFace) {
-
-    // This function has two parts:
-    // 1. Use the person image features to mask out pixels around the head.
-    // 2. Use a fixed-size small "keyhole" mask around the head and shoulders
-    //    to define a minimum size image to be returned.
-
-    // 1. Try to find the contour of the person's head by identifying the
-    // face and hair, and then drawing a convex hull around it.
-
-    // Top part of the image down to the bottom of the head.
-    Mat mTop(m, Rect(0, 0, m.cols, max(aHead.height, aFace.y + aFace.height)));
-    // Collection of discovered face/hair points.
-    vector<Point> facePoints;
-    // Contains points in a hull drawn around the discovered head.
-    vector<vector<Point> >hullFacePoints(1);
-    // The ellipse drawn around the hull around the discovered head.
-    RotatedRect rotEll;
-    // Contains an ellipse drawn around the discovered head.
-    Mat hullMat = Mat::zeros(m.size(), m.type());
-    // The new face and head rectangles resulting from face/hair searches.
-    Rect newFace = Rect(0, 0, 0, 0);
-    Rect newHead = Rect(0, 0, 0, 0);
-    // For debugging: record the face and hair search sensitivity.
-    int faceSens = 0;
-    int hairSens = 0;
-
-    // Search for face.
-    // Find connected color regions for a set of points on the face.
-    // The objective is to identify the entire set of face points. Sometimes
-    // hair is also discovered.
-    // Search with declining sensitivity trying to find the largest acceptable face.
-    // Use only the top part of the image (mTop).
-    vector<Point> facePointsCopy;
-    Mat hullMatCopy;
-    for (wxInt32 sens = 20; sens > 0; sens = sens - 5) {
-        // Save facePoints and hullMat. Restore later.
-        facePointsCopy = facePoints;
-        hullMatCopy = hullMat.clone();
-
-        faceSearch(mTop, aFace, facePointsCopy, sens);
-
-        // Find a new face rectangle based on discovered face points.
-        Rect faceCopy = Rect(0,0,0,0);
-        if (facePointsCopy.size() > 2) {
-            faceCopy = boundingRect(facePointsCopy);
-
-            // First test for acceptable face.  If face has grown too much
-            // then reject and try search zerowith lower sensitivity.
-            if ((faceCopy.width / (double) aFace.width) > 1.5) {
-                continue;
-            }
-
-            // Construct a hull around all the discovered face and hair points.
-            convexHull(facePointsCopy, hullFacePoints[0], false);
-        }
-
-        // Smooth the hull by drawing an ellipse around it.
-        if (hullFacePoints[0].size() >= 5) {
-            rotEll = fitEllipse(hullFacePoints[0]);
-
-            // Draw the ellipse (filled) on hullMat.
-            ellipse(hullMatCopy, rotEll, greenColor, -lineWidth, lineType); // Filled
-        }
-
-        // Second test for an acceptable face.
-        if (headOK(mTop, hullMatCopy, faceCopy)) {
-            // Acceptable. Restore facePoints and hullMat.
-            hullMat = hullMatCopy;
-            facePoints = facePointsCopy;
-            newFace = faceCopy;
-            faceSens = sens;
-            break;
-        }
-    }
-
-    /* For debugging: clear the face points so we can examine only hair points.
-        facePoints.clear();
-    */
-
-    // Search for hair if a face was found. Same method as face search.
-    if (newFace.width > 0) {
-        for (wxInt32 sens = 20; sens > 0; sens = sens - 5) {
-            // Save facePoints and hullMat. Restore later.
-            facePointsCopy = facePoints;
-            hullMatCopy = hullMat.clone();
-
-            hairSearch(mTop, aFace, newFace, facePointsCopy, sens);
-
-            // Find a new head rectangle based on discovered face and hair points.
-            Rect headCopy = Rect(0,0,0,0);
-            if (facePointsCopy.size() > 2) {
-                headCopy = boundingRect(facePointsCopy);
-
-                // First test for acceptable head.  If head has grown too much
-                // then reject and try search with lower sensitivity.
-                if ((headCopy.width / (double) aHead.width) > 1.7) {
-                    continue;
-                }
-
-                // Construct a hull around all the discovered face and hair points.
-                convexHull(facePointsCopy, hullFacePoints[0], false);
-            }
-
-            // Smooth the hull by drawing an ellipse around it.
-            if (hullFacePoints[0].size() >= 5) {
-                rotEll = fitEllipse(hullFacePoints[0]);
-
-                // Draw the ellipse (filled) on hullMat.
-                ellipse(hullMatCopy, rotEll, greenColor, -lineWidth, lineType); // Filled
-            }
-
-            // Second test for an acceptable head.
-            if (headOK(mTop, hullMatCopy, headCopy)) {
-                // Acceptable. Restore facePoints and hullMat.
-                hullMat = hullMatCopy;
-                facePoints = facePointsCopy;
-                newHead = headCopy;
-                hairSens = sens;
-                break;
-            }
-        }
-    }
-
-    // Note that rotEll and hullFacePoints[0] are invalid if no acceptable head found.
-
-    /* For debugging: set discovered face/hair points to red.
-    for (wxInt32 i = 0; i<facePoints.size(); i++) {
-        Point p = facePoints.at(i);
-        m.at<Vec3b>(p) = Vec<unsigned char,3>(0,0,255);
-    }
-    */
-
-    /* For debugging: Output image data.
-    cout << myNextImageID  << " " <<
-            faceSens       << " " << hairSens     << " " <<
-            newHead.width  << " " << aHead.width  << " " <<
-            newHead.height << " " << aHead.height << " " <<
-            newFace.width  << " " << aFace.width  << " " <<
-            newFace.height << " " << aFace.height << " " << endl;
-    */
-
-    /* For debugging: show face/hair discoveries and contours. Skip keyhole.
-        rectangle(m, aFace, yellowColor, lineWidth); // Outline the old face.
-        rectangle(m, newFace, blueColor, lineWidth); // Outline the new face.
-        drawContours(m, hullFacePoints, 0, redColor, lineWidth, lineType, vector<Vec4i>(), 0, Point()); // Draw the hull.
-        ellipse(m, rotEll, greenColor, lineWidth, lineType); // Draw the smoothed hull.
-        return; // Skip keyhole.
-    */
-
-    // 2. Define a small keyhole outline around the head and body.
-    // The small keyhole defines the minimum size of the person image to be
-    // returned.  The image may be larger if the hull extends outside the keyhole.
-
-    wxInt32 hx, hy, hw, hh, hcx, hcy, h2, sx, sy, s2;
-    // Use either the old (original) head or the new head as center of the keyhole.
-    // If a good new head wasn't found use the old head.
-    // Compute head and shoulder characteristics using the choice.
-
-    // Test for a too narrow head.  If so, default to old head and throw away
-    // face/hair discoveries.
-    if ((newHead.width / (double) aHead.height) < 0.5) {
-        hullMat = Mat::zeros(m.size(), m.type());
-        newHead.width = 0;
-    }
-
-    // Test for a narrow new face width vs. old face width.
-    if (newHead.width > 0 && (newFace.width / (double) aFace.width) >= 0.7) {
-        // It's likely that a good head was discovered.  Use newHead.
-
-        // Get y, height, y-center of new head.
-        hy = newHead.y;
-        hh = newHead.height;
-        hcy = hy + hh/2;
-
-        // Find the actual head x and width half way down the head.
-        for (wxInt32 c = 0; c < m.cols; c++) {
-            if (hullMat.at<Vec3b>(hcy, c) != Vec<unsigned char,3>(0,0,0)) {
-                hx = c;
-                break;
-            }
-        }
-        for (wxInt32 c = m.cols - 1; c > 0; c--) {
-            if (hullMat.at<Vec3b>(hcy, c) != Vec<unsigned char,3>(0,0,0)) {
-                hw = c - hx;
-                break;
-            }
-        }
-
-        // Get x-center of new head.
-        hcx = hx + hw/2;
-
-        // Suppress top (round) part of keyhole since there is a good head.
-        // Set square of head radius (h2) to zero to suppress top part of keyhole.
-        h2=0;
-    }
-    else {
-        // Use old head as default.
-        hx = aHead.x;
-        hy = aHead.y;
-        hw = aHead.width;
-        hh = aHead.height;
-
-        // Compute head center (hx, hy) and square of head radius (h2).
-        hcx = hx + hw/2;
-        hcy = aFace.y + (aFace.height / 5); // (hy is always = 0, can't be used.)
-        h2 = hw/2 * hw/2;
-    }
-
-    // Compute shoulder center (sx, sy) and square of shoulder radius (s2).
-    // s2 is distance from (sx, sy) to leftmost point where head and body meet.
-    sx = hcx;
-    wxInt32 radius = max(hcx, m.cols - hcx);
-    sy = hy + hh + radius;
-    s2 = (hx - sx) * (hx - sx) + (hy + hh - sy) * (hy + hh - sy);
-
-    // Construct the keyhole:
-    // Upper half of head: black out points outside the hull but not inside
-    // the head circle.
-    for (wxInt32 c = 0; c < m.cols; c++) {
-        for (wxInt32 r=0; r<hcy; r++) {
-            for (wxInt32 r=0; r<hcy; r++) {
-                if (hullMat.at<Vec3b>(r, c) != Vec<unsigned char,3>(0,0,0)) break;
-                if ((hcx-c)*(hcx-c) + (hcy-r)*(hcy-r) > h2) {
-                    m.at<Vec3b>(r, c) = CV_COLOR_TRANSPARENT;
-                }
-            }
-        }
-    }
-
-    // Lower half of head: black out points outside the hull but not inside
-    // the head rectangle.
-    for(wxInt32 r = 0; r < hy + hh; r++) {
-        // Black out left of head.
-        for(wxInt32 c = 0; c < hx; c++) {
-            if (hullMat.at<Vec3b>(r, c) != Vec<unsigned char,3>(0,0,0)) break;
-            m.at<Vec3b>(r, c) = CV_COLOR_TRANSPARENT;
-        }
-        // Black out right of head.
-        for(wxInt32 c = m.cols - 1; c > hx + hw; c--) {
-            if (hullMat.at<Vec3b>(r, c) != Vec<unsigned char,3>(0,0,0)) break;
-            m.at<Vec3b>(r, c) = CV_COLOR_TRANSPARENT;
-        }
-    }
-
-    // Upper half of body: black out points outside of shoulder circle but not
-    // inside the hull.
-    for (wxInt32 c = 0; c < m.cols; c++) {
-        for (wxInt32 r=hy + hh; r<min(sy, m.rows); r++) {
-            if (hullMat.at<Vec3b>(r, c) == Vec<unsigned char,3>(0,0,0)) {
-                if ((sx-c)*(sx-c) + (sy-r)*(sy-r) > s2) {
-                    m.at<Vec3b>(r, c) = CV_COLOR_TRANSPARENT;
-                }
-            }
-        }
-    }
-
-    // Finally, remove top rows of the image that are marked as invisible.
-   for (wxInt32 r = 0; r < m.rows; r++) {
-       for (wxInt32 c = 0; c < m.cols; c++) {
-            if (m.at<Vec3b>(r, c) != CV_COLOR_TRANSPARENT) {
-                // Remove rows above r from mat m.
-                m = m.rowRange(r, m.rows);
-                return;
-            }
-        }
-    }
-}
-
 /**
  * Delete a set of obsolete person image files. Image IDs are sequential.
  * @param firstID Image ID of first image or -1 if no images.
@@ -660,309 +448,3 @@ void PeopleFinder::deleteOldImages(wxInt32 firstID, wxInt32 lastID) {
         }
     }
 }
-
-/**
- * Isolate the skin points on a discovered face by searching for colors similar
- * to those of the skin points on a cross through a central rectangle on the
- * discovered face.
- * @param m An image
- * @param aFace A discovered face on m.
- * @param facePoints The skin colored face points discovered.
- * @param sensitivity The sensitivity of the search.
- */
-void PeopleFinder::faceSearch(Mat& m, Rect aFace,
-        vector<Point>& facePoints, wxInt32 sensitivity) {
-    Point seed;
-
-    // Create a mask slightly larger than the image for floodFill.
-    Mat imgMask = Mat::zeros(m.rows+2, m.cols+2, CV_8UC1);
-
-    // Vertical part of the cross:
-    for (wxInt32 y = aFace.y + aFace.height/4; y < aFace.y + aFace.height*3/4; y=y+2) {
-        seed = Point(aFace.x + aFace.width/2, y);
-        findColorRegion(m, imgMask, seed, sensitivity);
-    }
-    // Horizontal part of the cross:
-    for (wxInt32 x = aFace.x + aFace.width/3; x < aFace.x + aFace.width*2/3; x=x+2) {
-        seed = Point(x, aFace.y + aFace.height/2);
-        findColorRegion(m, imgMask, seed, sensitivity);
-    }
-
-    // Reduce the mask to the image size.
-    Mat imgSMask(imgMask, Rect(1, 1, m.cols, m.rows));
-
-    // Test the leftmost and rightmost discovered point half way down the face
-    // to try to extend the sides of the head.
-    wxInt32 r = aFace.y + aFace.height/2;
-    for (wxInt32 c = 0; c < m.cols; c++) {
-        if (imgSMask.at<unsigned char>(r, c) == 1) {
-            seed = Point(c, r);
-            findColorRegion(m, imgMask, seed, sensitivity);
-            break;
-        }
-    }
-    for (wxInt32 c = m.cols-1; c >= 0; c--) {
-        if (imgSMask.at<unsigned char>(r, c) == 1) {
-            seed = Point(c, r);
-            findColorRegion(m, imgMask, seed, sensitivity);
-            break;
-        }
-    }
-
-    // Get the points from the mask to facePoints.
-    for (wxInt32 c = 0; c < m.cols; c++) {
-        for (wxInt32 r = 0; r < m.rows; r++) {
-            if (imgSMask.at<unsigned char>(r, c) == 1) {
-                facePoints.push_back(Point(c, r));
-            }
-        }
-    }
-}
-
-/**
- * Search for hair points.
- * @param m An Image.
- * @param oldFace A discovered face on m.
- * @param newFace A face expanded by a faceSearch.
- * @param facePoints The skin and hair points discovered.
- * @param sensitivity The sensitivity of the search.
- */
-void PeopleFinder::hairSearch(Mat& m, Rect oldFace, Rect newFace,
-        vector<Point>& facePoints, wxInt32 sensitivity) {
-    Point seed;
-
-    // Create a mask slightly larger than the image for floodFill.
-    Mat imgMask = Mat::zeros(m.rows+2, m.cols+2, CV_8UC1);
-
-    // Search differently for hair depending on the face growth due to the face search.
-    if ((newFace.height / (double) oldFace.height) > 1.25) {
-        // If the new face grew significantly:
-        // Search upwards from the old face toward but not reaching the new face.
-        wxInt32 x = newFace.x + newFace.width/2;
-        for (wxInt32 y = oldFace.y;
-                y > std::max(0.0, newFace.y + newFace.height - 1.20 * oldFace.height); y=y-2) {
-            seed = Point(x, y);
-            findColorRegion(m, imgMask, seed, sensitivity);
-        }
-    }
-    else {
-        // Search the center of the newFace top line.
-        for (wxInt32 x = newFace.x + newFace.width*4/10;
-                x < newFace.x + newFace.width*6/10; x = x + 4) {
-            seed = Point(x, newFace.y);
-            findColorRegion(m, imgMask, seed, sensitivity);
-        }
-
-        // Search slightly upwards from the newFace top line.
-        for (wxInt32 y = newFace.y; y > max(0, newFace.y - newFace.height/20); y = y - 2) {
-            seed = Point(newFace.x + newFace.width/2, y);
-            findColorRegion(m, imgMask, seed, sensitivity);
-        }
-
-        // Near left corner of oldFace top line.
-        // If top-left corner of old face is inside top-left corner of new face
-        // then test a point on old face top line in from corner.
-        if (oldFace.x > newFace.x && oldFace.y > newFace.y) {
-            seed = Point(oldFace.x + oldFace.width/10, oldFace.y);
-            findColorRegion(m, imgMask, seed, sensitivity);
-        }
-
-        // Near right corner of oldFace top line.
-        // If top-right corner of old face is inside top-right corner of new face
-        // then test a point on old face top line in from corner.
-        if (oldFace.x + oldFace.width < newFace.x + newFace.width) {
-            seed = Point(oldFace.x + oldFace.width*9/10, oldFace.y);
-            findColorRegion(m, imgMask, seed, sensitivity);
-        }
-
-        // Near left and right corners of oldFace top line.
-        // If newFace sides are inside oldFace sides and newFace top is
-        // above oldFace top then test points in from corners on oldFace top.
-        if (oldFace.y > newFace.y && newFace.x > oldFace.x &&
-                newFace.x + newFace.width < oldFace.x + oldFace.width) {
-            seed = Point(newFace.x + newFace.width/10, oldFace.y);
-            findColorRegion(m, imgMask, seed, sensitivity);
-            seed = Point(newFace.x + newFace.width*9/10, oldFace.y);
-            findColorRegion(m, imgMask, seed, sensitivity);
-        }
-
-        // If newFace top corners are inside oldFace top corners then test
-        // near corners of both faces.
-        if (newFace.x > oldFace.x &&
-                newFace.x + newFace.width < oldFace.x + oldFace.width &&
-                newFace.y > oldFace.y) {
-            // Test 20% from corners on old line, at corners on new line.
-            seed = Point(oldFace.x + oldFace.width*2/10, oldFace.y);
-            findColorRegion(m, imgMask, seed, sensitivity);
-            seed = Point(oldFace.x + oldFace.width*8/10, oldFace.y);
-            findColorRegion(m, imgMask, seed, sensitivity);
-            seed = Point(newFace.x, newFace.y);
-            findColorRegion(m, imgMask, seed, sensitivity);
-            seed = Point(newFace.x + newFace.width, newFace.y);
-            findColorRegion(m, imgMask, seed, sensitivity);
-        }
-    }
-
-    // Reduce the mask to the image size.
-    Mat imgSMask(imgMask, Rect(1, 1, m.cols, m.rows));
-
-    // Test the topmost discovered point in the center of the new face
-    // to try to extend the top of the head..
-    wxInt32 c = newFace.x + newFace.width/2;
-    for (wxInt32 r = 0; r < m.rows; r++) {
-        if (imgSMask.at<unsigned char>(r, c) == 1) {
-            seed = Point(c, r);
-            findColorRegion(m, imgMask, seed, sensitivity);
-            break;
-        }
-    }
-    // test the leftmost point on the new face top line
-    wxInt32 r = newFace.y;
-    for (wxInt32 c = 0; c < m.cols; c++) {
-        if (imgSMask.at<unsigned char>(r, c) == 1) {
-            seed = Point(c, r);
-            findColorRegion(m, imgMask, seed, sensitivity);
-            break;
-        }
-    }
-    // Test the rightmost point on the new face top line
-    for (wxInt32 c = m.cols-1; c >=0; c--) {
-        if (imgSMask.at<unsigned char>(r, c) == 1) {
-            seed = Point(c, r);
-            findColorRegion(m, imgMask, seed, sensitivity);
-            break;
-        }
-    }
-
-    // test the leftmost point on the old face top line
-    r = oldFace.y;
-    for (wxInt32 c = 0; c < m.cols; c++) {
-        if (imgSMask.at<unsigned char>(r, c) == 1) {
-            seed = Point(c, r);
-            findColorRegion(m, imgMask, seed, sensitivity);
-            break;
-        }
-    }
-    // Test the rightmost point on the old face top line
-    for (wxInt32 c = m.cols-1; c >=0; c--) {
-        if (imgSMask.at<unsigned char>(r, c) == 1) {
-            seed = Point(c, r);
-            findColorRegion(m, imgMask, seed, sensitivity);
-            break;
-        }
-    }
-
-    // Get the points from the mask to facePoints.
-    for (wxInt32 c = 0; c < m.cols; c++) {
-        for (wxInt32 r = 0; r < m.rows; r++) {
-            if (imgSMask.at<unsigned char>(r, c) == 1) {
-                facePoints.push_back(Point(c, r));
-            }
-        }
-    }
-}
-
-/**
- * Find a contiguous region in an image with similar colors.
- * @param img The image.
- * @param imgMask Returned cumulative mask indicating points matching color of interest.
- * @param seed A starting point for the region with the color of interest.
- * @param dl The delta to define similar colors.
- */
-void PeopleFinder::findColorRegion(Mat& img, Mat& imgMask, Point seed, wxInt32 dl) {
-    findColorRegion(img, imgMask, seed, dl, dl, dl);
-}
-
-/**
- * Find a contiguous region in an image with similar colors.
- * @param img The image.
- * @param imgMask Returned cumulative points matching color of interest.
- * @param seed A starting point for the region with the color of interest.
- * @param dl1 The delta to define similar colors, subscript 1.
- * @param dl2 The delta to define similar colors, subscript 2.
- * @param dl3 The delta to define similar colors, subscript 3.
- */
-void PeopleFinder::findColorRegion(Mat& img, Mat& imgMask, Point seed,
-                                   wxInt32 dl1, wxInt32 dl2, wxInt32 dl3) {
-    Scalar loDiff = Scalar(dl1, dl2, dl3);
-    Scalar upDiff = Scalar(dl1, dl2, dl3);
-
-    // Find the region. Set the mask to 1 wherever there is a similar color.
-    Rect region;
-    Mat newMask = Mat::zeros(imgMask.rows, imgMask.cols, CV_8UC1);
-    floodFill(img, newMask, seed, Scalar(1), &region, loDiff, upDiff,
-            FLOODFILL_FIXED_RANGE + FLOODFILL_MASK_ONLY + 8);
-
-    // Copy discoveries from newMask to imgMask.
-    for (wxInt32 c = 0; c < imgMask.cols; c++) {
-        for (wxInt32 r = 0; r < imgMask.rows; r++) {
-            if (newMask.at<unsigned char>(r, c) == 1) {
-                imgMask.at<unsigned char>(r, c) = 1;
-            }
-        }
-    }
-}
-
-/**
- * Sanity check the discovered head. If it consumes the entire width or
- * length of the image of if its ellipse extends more than a little over the
- * image top, or it extends over both left and right image bounds, or it
- * covers a significant fraction of the left or right edge, assume the
- * face/hair search failed.
- * Typically failures occur because background colors are too similar to face
- * or hair colors or because other people are in the image.
- * @param headMat The portion of the image where the head was discovered.
- * @param hullMat A scratch pad where an ellipse surrounding the head was drawn.
- * @param headRect The rectangle around the discovered head.
- * @return true if the head is a reasonable size, else false.
- */
-bool PeopleFinder::headOK(Mat headMat, Mat hullMat, Rect headRect) {
-    // Check the head dimensions against the image dimensions.  If the head
-    // is as large as the image width or height then assume a failed search.
-    if (headRect.width == headMat.cols || headRect.height == headMat.rows) {
-        return false;
-    }
-
-    // Sanity check the ellipse around the head.
-    bool overTopEdge = false;
-    bool overLeftEdge = false;
-    bool overRightEdge = false;
-    wxInt32 tCount = 0; // ellipse pixels on top edge.
-    wxInt32 lCount = 0; // ellipse pixels on left edge.
-    wxInt32 rCount = 0; // ellipse pixels on right edge.
-    wxInt32 tMax = 0.10 * headMat.cols; // max pixels allowed on top edge.
-    wxInt32 lrMax = 0.5 * headMat.rows; // max pixels allowed on left/right edge.
-
-    // Check top edge. A little (tMax) over the top edge is OK.
-    for (wxInt32 c = 0; c < headMat.cols; c++) {
-        if (hullMat.at<Vec3b>(0, c) != Vec<unsigned char,3>(0,0,0)) {
-            if (tCount++ > tMax) {
-                overTopEdge = true;
-                break;
-            }
-        }
-    }
-
-    if ( ! overTopEdge) {
-        // Check left and right edges.
-        for (wxInt32 r = 0; r < headMat.rows; r++) {
-            if (hullMat.at<Vec3b>(r, 0) != Vec<unsigned char,3>(0,0,0)) {
-                overLeftEdge = true;
-                if (lCount++ > lrMax) break;
-            }
-        }
-        for (wxInt32 r = 0; r < headMat.rows; r++) {
-            if (hullMat.at<Vec3b>(r, headMat.cols-1) != Vec<unsigned char,3>(0,0,0)) {
-                overRightEdge = true;
-                if (rCount++ > lrMax) break;
-            }
-        }
-    }
-
-    if (overTopEdge || (overLeftEdge && overRightEdge) ||
-            lCount > lrMax || rCount > lrMax) {
-        // A good head has not been found.
-        return false;
-    }
-    return true;
-}
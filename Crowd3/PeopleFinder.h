@@ -30,10 +30,6 @@
 #ifndef PEOPLEFINDER_H
 #define	PEOPLEFINDER_H
 
-#include <opencv2/imgproc/imgproc.hpp>
-#include <opencv2/imgproc/imgproc_c.h>
-#include <opencv2/highgui/highgui.hpp>
-#include <opencv2/objdetect/objdetect.hpp>
 #include <wx/wx.h>
 #include <wx/dir.h>
 #include <wx/dirdlg.h>
@@ -43,86 +39,66 @@
 #include "Tools.h"
 #include "Settings.h"
 #include "ImageTree.h"
+#include "ScanEngine.h"
 #include <string>
 #include <iostream>
 using namespace cv;
 using namespace std;
 
-// Face constants (empirical):
-/** A face must be at least this fraction of the smaller photo dimension.
- *   This helps filter out detection errors. */
-const double FACEPERCENT = 0.08;
-
-/** Enlarge the detected face width by this factor to encompass the entire head. */
-const double HEADWIDTH = 1.02;
-
-/** Enlarge the detected face height by this factor to encompass the entire head. */
-const double HEADHEIGHT = 1.9;
-
-/** Enlarge the enlarged face by this factor to estimate the upper body width. */
-const double BODYWIDTH = 2.1 / HEADWIDTH;
-
-/** Enlarge the enlarged face by this factor to estimate the upper body height. */
-const double BODYHEIGHT = 2.1 / HEADHEIGHT;
-
-/** Scale detected head images to this size. */
-const double SCALEDFACEWIDTH = 200.0;
-
-/** Person images will be this many pixels wide. */
-const double PERSONWIDTH = HEADWIDTH * BODYWIDTH * SCALEDFACEWIDTH;
-
-/** Person images will be this many pixels high. */
-const double FULLPERSONHEIGHT =
-            SCALEDFACEWIDTH * (HEADHEIGHT + (HEADHEIGHT * BODYHEIGHT));
-
-/** Persons displayed in a crowd will have reduced person height. */
-const double PERSONHEIGHT = 0.75 * FULLPERSONHEIGHT;
+class DetectorLoader;
 
 /**
  * Search 'source image files' for people.  Extract the people into individual
  * 'people image files' that can be used to build crowd images.<p>
- * The PeopleFinder uses opencv face detection to find people images (actually
- * just their faces). Then the face portion is enlarged (by skin and hair
- * color searches) to try to include the face's entire head and upper body.<P>
- * Each person image is written to an individual file named with a unique ID. A
- * record is created for the source image file that associates it with
- * the people image files extracted from it.<p>
+ * The PeopleFinder is the user interface of the ScanEngine, which does the
+ * searching: it asks for a face detector and a folder, walks the folder
+ * hierarchy handing the files that need searching to the engine, and shows
+ * progress. Each person image is written to an individual file named with a
+ * unique ID. A record is created for the source image file that associates it
+ * with the people image files extracted from it.<p>
  * Usage: <p><code>
  * p = PeopleFinder();<p>
- * p.searchFolder(aFolder);<p></code>
+ * p.searchFolder(parent, rescan, chooseDetector);<p></code>
  */
-class PeopleFinder : public wxDirTraverser {
+class PeopleFinder : public wxDirTraverser, public ScanListener {
     public:
         PeopleFinder();
         PeopleFinder(const PeopleFinder& orig);
         virtual ~PeopleFinder();
-        void searchFolder(wxFrame *parent, bool rescan);
+        void searchFolder(wxFrame *parent, bool rescan, bool chooseDetector);
+        virtual void scanned(const ScanResult& result);
+        virtual bool progress();
 
     private:
-        void initFaceDetection();
+        bool chooseDetector(wxFrame *parent);
+        DetectorLoader* startLoading();
+        bool finishLoading(wxFrame *parent, DetectorLoader *loader);
         void initImageTypes();
-        wxInt32 findPeople(wxString imageFile);
-        vector<Rect> findFaces(Mat theImage);
-        void maskHead(Mat& m, Rect aHead, Rect aFace);
+        bool needsSearch(wxString imageFile);
         void deleteOldImages(wxInt32 firstID, wxInt32 lastID);
         virtual wxDirTraverseResult OnFile(const wxString& filename);
         virtual wxDirTraverseResult OnDir(const wxString& dirname);
         virtual wxDirTraverseResult OnOpenError(const wxString& dirname);
-        void faceSearch(Mat& m, Rect aFace, vector<Point>& facePoints, wxInt32 sensitivity);
-        void hairSearch(Mat& m, Rect oldFace, Rect newFace, vector<Point>& facePoints, wxInt32 sensitivity);
-        bool headOK(Mat headMat, Mat hullMat, Rect headRect);
-        void findColorRegion(Mat& m, Mat& mask, Point seed, wxInt32 dl);
-        void findColorRegion(Mat& m, Mat& mask, Point seed, wxInt32 dl1,wxInt32 dl2,wxInt32 dl3);
 
-        /** The ID for a person image, also the filename of the person image file. */
-        wxInt32 myNextImageID;
+        /** Searches the source image files. */
+        ScanEngine myEngine;
+
+        /** The face detector used for searches, or NULL until it is loaded. */
+        FaceDetector *myDetector;
 
-        /** A list of source image file types (*.extension) that are searched. */
+        /** A second detector of the same kind for the pre-screen, or NULL
+         * until it is needed. */
+        FaceDetector *myPrescreenDetector;
+
+        /** A list of source image file extensions, lower case, that are searched. */
         wxArrayString *myTypes;
 
         /** A progress indicator while searching source image files. */
         wxProgressDialog *myProgress;
 
+        /** The file or folder shown in the progress dialog. */
+        wxString myCurrent;
+
         /** The number of faces detected while searching image files. */
         wxInt32 myFaceCount;
 
@@ -0,0 +1,546 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "PixelKernels.h"
+#include <algorithm>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define PIXELKERNELS_X86 1
+#include <immintrin.h>
+#if __GNUC__ >= 6
+#define PIXELKERNELS_AVX512 1
+#endif
+#endif
+
+/** The bytes of a block of 16 pixels, one mask bit per byte. */
+static const wxUint64 BLOCKBYTES = 0xFFFFFFFFFFFFULL;
+
+/** The first byte of each pixel of a block, one mask bit per byte. */
+static const wxUint64 BLOCKPIXELS = 0x249249249249ULL;
+
+/** A block of 16 black pixels. */
+static const unsigned char BLACKBLOCK[48] = {0};
+
+/**
+ * Compares a block of 16 pixels with a pattern, byte by byte.
+ * @param pixels The 48 bytes of the block.
+ * @param pattern The 48 bytes to compare with.
+ * @return A mask with bit i set if byte i of the block equals byte i of the pattern.
+ */
+typedef wxUint64 (*BlockCompare)(const unsigned char *pixels,
+                                 const unsigned char *pattern);
+
+/** The kernels that differ between levels. */
+struct KernelTable {
+    /** The block comparison the pixel scans are built on, NULL for the reference scans. */
+    BlockCompare compare;
+    /** The markEqual kernel. */
+    void (*markEqual)(unsigned char*, const unsigned char*, wxInt32, unsigned char);
+    /** The accumulate kernel. */
+    void (*accumulate)(wxInt32*, const unsigned char*, wxInt32, wxInt32);
+};
+
+// The scalar reference kernels.
+
+static void markEqualScalar(unsigned char *target, const unsigned char *source,
+                            wxInt32 count, unsigned char value) {
+    for (wxInt32 i = 0; i < count; i++) {
+        if (source[i] == value) {
+            target[i] = value;
+        }
+    }
+}
+
+static wxInt32 firstSetScalar(const unsigned char *pixels, wxInt32 count) {
+    for (wxInt32 i = 0; i < count; i++, pixels += 3) {
+        if ((pixels[0] | pixels[1] | pixels[2]) != 0) {
+            return i;
+        }
+    }
+    return count;
+}
+
+static wxInt32 lastSetScalar(const unsigned char *pixels, wxInt32 count) {
+    for (wxInt32 i = count - 1; i >= 0; i--) {
+        const unsigned char *pixel = pixels + 3 * i;
+        if ((pixel[0] | pixel[1] | pixel[2]) != 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static wxInt32 countSetScalar(const unsigned char *pixels, wxInt32 count) {
+    wxInt32 set = 0;
+    for (wxInt32 i = 0; i < count; i++, pixels += 3) {
+        if ((pixels[0] | pixels[1] | pixels[2]) != 0) {
+            set++;
+        }
+    }
+    return set;
+}
+
+static wxInt32 firstOtherScalar(const unsigned char *pixels, wxInt32 count,
+                                const unsigned char colour[3]) {
+    for (wxInt32 i = 0; i < count; i++, pixels += 3) {
+        if (pixels[0] != colour[0] || pixels[1] != colour[1] || pixels[2] != colour[2]) {
+            return i;
+        }
+    }
+    return count;
+}
+
+static void markSetScalar(unsigned char *marks, const unsigned char *pixels,
+                          wxInt32 count) {
+    for (wxInt32 i = 0; i < count; i++, pixels += 3) {
+        if ((pixels[0] | pixels[1] | pixels[2]) != 0) {
+            marks[i] = 1;
+        }
+    }
+}
+
+static void accumulateScalar(wxInt32 *sums, const unsigned char *bytes,
+                             wxInt32 count, wxInt32 weight) {
+    for (wxInt32 i = 0; i < count; i++) {
+        sums[i] += weight * bytes[i];
+    }
+}
+
+// The pixel scans in blocks of 16 pixels, for any block comparison.
+
+/**
+ * Which pixels of a block are set?
+ * @param compare The block comparison.
+ * @param pixels The 48 bytes of the block.
+ * @return A mask with the first bit of each set pixel's bytes set.
+ */
+static inline wxUint64 setPixels(BlockCompare compare, const unsigned char *pixels) {
+    wxUint64 set = ~compare(pixels, BLACKBLOCK) & BLOCKBYTES;
+    return (set | (set >> 1) | (set >> 2)) & BLOCKPIXELS;
+}
+
+static wxInt32 firstSetBlocks(BlockCompare compare, const unsigned char *pixels,
+                              wxInt32 count) {
+    wxInt32 i = 0;
+    for (; i + 16 <= count; i += 16) {
+        wxUint64 set = setPixels(compare, pixels + 3 * i);
+        if (set != 0) {
+            return i + __builtin_ctzll(set) / 3;
+        }
+    }
+    return i + firstSetScalar(pixels + 3 * i, count - i);
+}
+
+static wxInt32 lastSetBlocks(BlockCompare compare, const unsigned char *pixels,
+                             wxInt32 count) {
+    wxInt32 i = count;
+    for (; i >= 16; i -= 16) {
+        wxUint64 set = setPixels(compare, pixels + 3 * (i - 16));
+        if (set != 0) {
+            return i - 16 + (63 - __builtin_clzll(set)) / 3;
+        }
+    }
+    return lastSetScalar(pixels, i);
+}
+
+static wxInt32 countSetBlocks(BlockCompare compare, const unsigned char *pixels,
+                              wxInt32 count) {
+    wxInt32 set = 0;
+    wxInt32 i = 0;
+    for (; i + 16 <= count; i += 16) {
+        set += __builtin_popcountll(setPixels(compare, pixels + 3 * i));
+    }
+    return set + countSetScalar(pixels + 3 * i, count - i);
+}
+
+static wxInt32 firstOtherBlocks(BlockCompare compare, const unsigned char *pixels,
+                                wxInt32 count, const unsigned char colour[3]) {
+    unsigned char pattern[48];
+    for (wxInt32 b = 0; b < 48; b++) {
+        pattern[b] = colour[b % 3];
+    }
+    wxInt32 i = 0;
+    for (; i + 16 <= count; i += 16) {
+        wxUint64 other = ~compare(pixels + 3 * i, pattern) & BLOCKBYTES;
+        if (other != 0) {
+            return i + __builtin_ctzll(other) / 3;
+        }
+    }
+    return i + firstOtherScalar(pixels + 3 * i, count - i, colour);
+}
+
+static void markSetBlocks(BlockCompare compare, unsigned char *marks,
+                          const unsigned char *pixels, wxInt32 count) {
+    wxInt32 i = 0;
+    for (; i + 16 <= count; i += 16) {
+        wxUint64 set = setPixels(compare, pixels + 3 * i);
+        for (; set != 0; set &= set - 1) {
+            marks[i + __builtin_ctzll(set) / 3] = 1;
+        }
+    }
+    markSetScalar(marks + i, pixels + 3 * i, count - i);
+}
+
+#if PIXELKERNELS_X86
+
+// The SSE2 kernels.
+
+__attribute__((target("sse2")))
+static wxUint64 compareSse2(const unsigned char *pixels, const unsigned char *pattern) {
+    __m128i a = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) pixels),
+                               _mm_loadu_si128((const __m128i*) pattern));
+    __m128i b = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) (pixels + 16)),
+                               _mm_loadu_si128((const __m128i*) (pattern + 16)));
+    __m128i c = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) (pixels + 32)),
+                               _mm_loadu_si128((const __m128i*) (pattern + 32)));
+    return (wxUint64) (wxUint32) _mm_movemask_epi8(a)
+            | ((wxUint64) (wxUint32) _mm_movemask_epi8(b) << 16)
+            | ((wxUint64) (wxUint32) _mm_movemask_epi8(c) << 32);
+}
+
+__attribute__((target("sse2")))
+static void markEqualSse2(unsigned char *target, const unsigned char *source,
+                          wxInt32 count, unsigned char value) {
+    __m128i values = _mm_set1_epi8((char) value);
+    wxInt32 i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) (source + i)), values);
+        __m128i kept = _mm_andnot_si128(equal, _mm_loadu_si128((const __m128i*) (target + i)));
+        _mm_storeu_si128((__m128i*) (target + i),
+                         _mm_or_si128(kept, _mm_and_si128(equal, values)));
+    }
+    markEqualScalar(target + i, source + i, count - i, value);
+}
+
+__attribute__((target("sse2")))
+static void accumulateSse2(wxInt32 *sums, const unsigned char *bytes,
+                           wxInt32 count, wxInt32 weight) {
+    // Each 32-bit lane holds (byte, 0) as 16-bit halves; madd by (weight, 0)
+    // multiplies them exactly.
+    __m128i weights = _mm_set1_epi32(weight);
+    __m128i zero = _mm_setzero_si128();
+    wxInt32 i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i all = _mm_loadu_si128((const __m128i*) (bytes + i));
+        __m128i low = _mm_unpacklo_epi8(all, zero);
+        __m128i high = _mm_unpackhi_epi8(all, zero);
+        __m128i words[4] = {_mm_unpacklo_epi16(low, zero), _mm_unpackhi_epi16(low, zero),
+                            _mm_unpacklo_epi16(high, zero), _mm_unpackhi_epi16(high, zero)};
+        for (wxInt32 w = 0; w < 4; w++) {
+            __m128i *sum = (__m128i*) (sums + i + 4 * w);
+            _mm_storeu_si128(sum, _mm_add_epi32(_mm_loadu_si128(sum),
+                                                _mm_madd_epi16(words[w], weights)));
+        }
+    }
+    accumulateScalar(sums + i, bytes + i, count - i, weight);
+}
+
+// The AVX2 kernels.
+
+__attribute__((target("avx2")))
+static wxUint64 compareAvx2(const unsigned char *pixels, const unsigned char *pattern) {
+    __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) pixels),
+                                  _mm256_loadu_si256((const __m256i*) pattern));
+    __m128i b = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) (pixels + 32)),
+                               _mm_loadu_si128((const __m128i*) (pattern + 32)));
+    return (wxUint64) (wxUint32) _mm256_movemask_epi8(a)
+            | ((wxUint64) (wxUint32) _mm_movemask_epi8(b) << 32);
+}
+
+__attribute__((target("avx2")))
+static void markEqualAvx2(unsigned char *target, const unsigned char *source,
+                          wxInt32 count, unsigned char value) {
+    __m256i values = _mm256_set1_epi8((char) value);
+    wxInt32 i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i equal = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) (source + i)), values);
+        __m256i old = _mm256_loadu_si256((const __m256i*) (target + i));
+        _mm256_storeu_si256((__m256i*) (target + i), _mm256_blendv_epi8(old, values, equal));
+    }
+    markEqualScalar(target + i, source + i, count - i, value);
+}
+
+__attribute__((target("avx2")))
+static void accumulateAvx2(wxInt32 *sums, const unsigned char *bytes,
+                           wxInt32 count, wxInt32 weight) {
+    __m256i weights = _mm256_set1_epi32(weight);
+    wxInt32 i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i words = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) (bytes + i)));
+        __m256i *sum = (__m256i*) (sums + i);
+        _mm256_storeu_si256(sum, _mm256_add_epi32(_mm256_loadu_si256(sum),
+                                                  _mm256_mullo_epi32(words, weights)));
+    }
+    accumulateScalar(sums + i, bytes + i, count - i, weight);
+}
+
+#endif
+
+#if PIXELKERNELS_AVX512
+
+// The AVX-512 kernels.
+
+__attribute__((target("avx512f,avx512bw")))
+static wxUint64 compareAvx512(const unsigned char *pixels, const unsigned char *pattern) {
+    // Masked loads read exactly the block, and nothing past it.
+    __mmask64 block = BLOCKBYTES;
+    return _mm512_mask_cmpeq_epi8_mask(block, _mm512_maskz_loadu_epi8(block, pixels),
+                                       _mm512_maskz_loadu_epi8(block, pattern));
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void markEqualAvx512(unsigned char *target, const unsigned char *source,
+                            wxInt32 count, unsigned char value) {
+    __m512i values = _mm512_set1_epi8((char) value);
+    wxInt32 i = 0;
+    for (; i + 64 <= count; i += 64) {
+        __mmask64 equal = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(source + i), values);
+        _mm512_mask_storeu_epi8(target + i, equal, values);
+    }
+    markEqualScalar(target + i, source + i, count - i, value);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void accumulateAvx512(wxInt32 *sums, const unsigned char *bytes,
+                             wxInt32 count, wxInt32 weight) {
+    __m512i weights = _mm512_set1_epi32(weight);
+    wxInt32 i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512i words = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*) (bytes + i)));
+        _mm512_storeu_si512(sums + i, _mm512_add_epi32(_mm512_loadu_si512(sums + i),
+                                                       _mm512_mullo_epi32(words, weights)));
+    }
+    accumulateScalar(sums + i, bytes + i, count - i, weight);
+}
+
+#endif
+
+/** The kernels of each level, indexed by level; levels not compiled use the reference. */
+static const KernelTable KERNELS[] = {
+    {NULL, markEqualScalar, accumulateScalar},
+#if PIXELKERNELS_X86
+    {compareSse2, markEqualSse2, accumulateSse2},
+    {compareAvx2, markEqualAvx2, accumulateAvx2},
+#else
+    {NULL, markEqualScalar, accumulateScalar},
+    {NULL, markEqualScalar, accumulateScalar},
+#endif
+#if PIXELKERNELS_AVX512
+    {compareAvx512, markEqualAvx512, accumulateAvx512}
+#else
+    {NULL, markEqualScalar, accumulateScalar}
+#endif
+};
+
+/**
+ * Get the fastest level this processor and operating system support, among
+ * those compiled.
+ * @return The level.
+ */
+PixelKernels::Level PixelKernels::supported() {
+#if PIXELKERNELS_X86
+    __builtin_cpu_init();
+#if PIXELKERNELS_AVX512
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        return AVX512;
+    }
+#endif
+    if (__builtin_cpu_supports("avx2")) {
+        return AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SSE2;
+    }
+#endif
+    return SCALAR;
+}
+
+/**
+ * Get the level in use. The first call chooses the fastest supported level.
+ * @return The level.
+ */
+PixelKernels::Level PixelKernels::level() {
+    return chosen();
+}
+
+/**
+ * Use another level, for example to test or time it. Only call this on the
+ * main thread, while no kernels are running.
+ * @param aLevel The wanted level. A level the processor does not support is
+ * lowered to the fastest one it does.
+ * @return The level now in use.
+ */
+PixelKernels::Level PixelKernels::use(Level aLevel) {
+    chosen() = std::min(aLevel, supported());
+    return chosen();
+}
+
+/**
+ * Get the name of a level, for messages.
+ * @param aLevel The level.
+ * @return Its name.
+ */
+string PixelKernels::name(Level aLevel) {
+    static const char *NAMES[] = {"scalar", "SSE2", "AVX2", "AVX-512"};
+    return NAMES[aLevel];
+}
+
+/**
+ * Copy one value from a row of bytes to another wherever the source has it.
+ * The other target bytes are left alone.
+ * @param target The bytes to mark.
+ * @param source The bytes to look for the value in.
+ * @param count The number of bytes in each.
+ * @param value The value.
+ */
+void PixelKernels::markEqual(unsigned char *target, const unsigned char *source,
+                             wxInt32 count, unsigned char value) {
+    KERNELS[level()].markEqual(target, source, count, value);
+}
+
+/**
+ * Find the first set pixel of a row.
+ * @param pixels The pixels.
+ * @param count The number of pixels.
+ * @return Its index, or count if none is set.
+ */
+wxInt32 PixelKernels::firstSet(const unsigned char *pixels, wxInt32 count) {
+    BlockCompare compare = KERNELS[level()].compare;
+    return compare == NULL ? firstSetScalar(pixels, count)
+            : firstSetBlocks(compare, pixels, count);
+}
+
+/**
+ * Find the last set pixel of a row.
+ * @param pixels The pixels.
+ * @param count The number of pixels.
+ * @return Its index, or -1 if none is set.
+ */
+wxInt32 PixelKernels::lastSet(const unsigned char *pixels, wxInt32 count) {
+    BlockCompare compare = KERNELS[level()].compare;
+    return compare == NULL ? lastSetScalar(pixels, count)
+            : lastSetBlocks(compare, pixels, count);
+}
+
+/**
+ * Count the set pixels of a row.
+ * @param pixels The pixels.
+ * @param count The number of pixels.
+ * @return The number set.
+ */
+wxInt32 PixelKernels::countSet(const unsigned char *pixels, wxInt32 count) {
+    BlockCompare compare = KERNELS[level()].compare;
+    return compare == NULL ? countSetScalar(pixels, count)
+            : countSetBlocks(compare, pixels, count);
+}
+
+/**
+ * Find the first pixel of a row that is not a given colour.
+ * @param pixels The pixels.
+ * @param count The number of pixels.
+ * @param colour The colour's 3 bytes.
+ * @return Its index, or count if all pixels are the colour.
+ */
+wxInt32 PixelKernels::firstOther(const unsigned char *pixels, wxInt32 count,
+                                 const unsigned char colour[3]) {
+    BlockCompare compare = KERNELS[level()].compare;
+    return compare == NULL ? firstOtherScalar(pixels, count, colour)
+            : firstOtherBlocks(compare, pixels, count, colour);
+}
+
+/**
+ * Set the mark of each set pixel of a row to 1. Other marks are left alone.
+ * @param marks One byte per pixel.
+ * @param pixels The pixels.
+ * @param count The number of pixels.
+ */
+void PixelKernels::markSet(unsigned char *marks, const unsigned char *pixels,
+                           wxInt32 count) {
+    BlockCompare compare = KERNELS[level()].compare;
+    if (compare == NULL) {
+        markSetScalar(marks, pixels, count);
+    } else {
+        markSetBlocks(compare, marks, pixels, count);
+    }
+}
+
+/**
+ * Paint a row of pixels one colour.
+ * @param pixels The pixels.
+ * @param count The number of pixels.
+ * @param colour The colour's 3 bytes.
+ */
+void PixelKernels::fill(unsigned char *pixels, wxInt32 count,
+                        const unsigned char colour[3]) {
+    for (wxInt32 i = 0; i < count; i++, pixels += 3) {
+        pixels[0] = colour[0];
+        pixels[1] = colour[1];
+        pixels[2] = colour[2];
+    }
+}
+
+/**
+ * Paint the pixels of a row whose marks are 0 one colour.
+ * @param pixels The pixels.
+ * @param marks One byte per pixel.
+ * @param count The number of pixels.
+ * @param colour The colour's 3 bytes.
+ */
+void PixelKernels::fillUnmarked(unsigned char *pixels, const unsigned char *marks,
+                                wxInt32 count, const unsigned char colour[3]) {
+    for (wxInt32 i = 0; i < count; i++, pixels += 3) {
+        if (marks[i] == 0) {
+            pixels[0] = colour[0];
+            pixels[1] = colour[1];
+            pixels[2] = colour[2];
+        }
+    }
+}
+
+/**
+ * Add a weighted row of bytes to a row of sums: sums[i] += weight * bytes[i].
+ * @param sums The sums.
+ * @param bytes The bytes.
+ * @param count The number of bytes.
+ * @param weight The weight, 0 to 32767.
+ */
+void PixelKernels::accumulate(wxInt32 *sums, const unsigned char *bytes,
+                              wxInt32 count, wxInt32 weight) {
+    KERNELS[level()].accumulate(sums, bytes, count, weight);
+}
+
+/**
+ * Get the level in use, choosing the fastest supported one on the first call.
+ * @return A reference to it.
+ */
+PixelKernels::Level& PixelKernels::chosen() {
+    static Level aLevel = supported();
+    return aLevel;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef PIXELKERNELS_H
+#define	PIXELKERNELS_H
+
+#include "CoreTools.h"
+
+/**
+ * The hot pixel loops of the people search and the compositors. Each has a
+ * scalar reference version, and all but fill() and fillUnmarked() also have
+ * SSE2, AVX2 and AVX-512 versions; the fastest version the processor and
+ * operating system support is chosen at run time, so one binary suits old and
+ * new processors alike. The kernels use integer arithmetic only, and every
+ * version gives exactly the reference's results: tests/PixelKernelsTest.cpp
+ * checks this for each level the test machine supports.<p>
+ * The vector versions are compiled by GCC 4.9 or later on x86 (AVX-512 by GCC
+ * 6 or later); other builds use the reference. Uses no wxWidgets objects, so
+ * the kernels may be used on any thread, but the first call must be made on
+ * the main thread, which chooses the level.<p>
+ * Pixels are 3 bytes each, in either colour order, unless stated otherwise.
+ * A pixel is set if any of its bytes is nonzero.<p>
+ * Usage:<p><code>
+ * wxInt32 c = PixelKernels::firstSet(mat.ptr(row), mat.cols);<p></code>
+ */
+class PixelKernels {
+public:
+    /** The instruction set levels, slowest first. */
+    enum Level {SCALAR, SSE2, AVX2, AVX512};
+    
+    static Level supported();
+    static Level level();
+    static Level use(Level aLevel);
+    static string name(Level aLevel);
+    
+    static void markEqual(unsigned char *target, const unsigned char *source,
+                          wxInt32 count, unsigned char value);
+    static wxInt32 firstSet(const unsigned char *pixels, wxInt32 count);
+    static wxInt32 lastSet(const unsigned char *pixels, wxInt32 count);
+    static wxInt32 countSet(const unsigned char *pixels, wxInt32 count);
+    static wxInt32 firstOther(const unsigned char *pixels, wxInt32 count,
+                              const unsigned char colour[3]);
+    static void markSet(unsigned char *marks, const unsigned char *pixels,
+                        wxInt32 count);
+    static void fill(unsigned char *pixels, wxInt32 count,
+                     const unsigned char colour[3]);
+    static void fillUnmarked(unsigned char *pixels, const unsigned char *marks,
+                             wxInt32 count, const unsigned char colour[3]);
+    static void accumulate(wxInt32 *sums, const unsigned char *bytes,
+                           wxInt32 count, wxInt32 weight);
+
+private:
+    static Level& chosen();
+};
+
+#endif	/* PIXELKERNELS_H */
@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "ResampleKernel.h"
+#include "PixelKernels.h"
+#include <cstring>
+
+/** The fraction bits of a pixel's sum over both axes' weights. */
+static const wxInt32 SUMBITS = 2 * RESAMPLEBITS;
+
+/** A half in those bits, for rounding. */
+static const wxInt64 SUMHALF = (wxInt64) 1 << (SUMBITS - 1);
+
+/** Create a kernel with empty buffers. */
+ResampleKernel::ResampleKernel() {
+}
+
+/**
+ * Paint a person image onto a canvas, scaled to a placement.
+ * @param person The person image.
+ * @param at The placement on the canvas. May extend past the canvas edges.
+ * @param canvas The canvas, without alpha.
+ * @param area The canvas area to paint in. Pixels outside it are left alone.
+ * @param coverage One byte per canvas pixel, nonzero where a nearer person is
+ * already painted, or NULL to paint over anything. Painted pixels are marked.
+ */
+void ResampleKernel::paint(const PixelView& person, const wxRect& at,
+                           const PixelView& canvas, const wxRect& area,
+                           unsigned char *coverage) {
+    wxRect painted = wxRect(0, 0, canvas.width, canvas.height).Intersect(area).Intersect(at);
+    if (painted.IsEmpty() || person.width <= 0 || person.height <= 0) {
+        return;
+    }
+    findTaps(person.width, at.width, painted.x - at.x, painted.width,
+             myColumnTaps, myColumnStarts);
+    findTaps(person.height, at.height, painted.y - at.y, painted.height,
+             myRowTaps, myRowStarts);
+    const ResampleTap *columnTaps = &myColumnTaps[0];
+    const ResampleTap *rowTaps = &myRowTaps[0];
+    
+    // The source columns the painted columns sample, low to high.
+    wxInt32 low = person.width;
+    wxInt32 high = -1;
+    for (size_t t = 0; t < myColumnTaps.size(); t++) {
+        low = min(low, myColumnTaps[t].index);
+        high = max(high, myColumnTaps[t].index);
+    }
+    wxInt32 span = high - low + 1;
+    wxInt32 colourBytes = span * person.rgbPixel;
+    myColourSums.resize(colourBytes);
+    wxInt32 *colourSums = &myColourSums[0];
+    
+    // Interleaved alpha is summed with the colour, separate alpha apart.
+    const wxInt32 *alphaSums = NULL;
+    wxInt32 alphaStride = 0;
+    wxInt32 alphaBytes = 0;
+    if (person.alpha != NULL) {
+        if (person.alphaPixel == person.rgbPixel && person.alphaRow == person.rgbRow
+                && person.alpha > person.rgb && person.alpha < person.rgb + person.rgbPixel) {
+            alphaSums = colourSums + (person.alpha - person.rgb);
+            alphaStride = person.rgbPixel;
+        }
+        else {
+            alphaBytes = span * person.alphaPixel;
+            myAlphaSums.resize(alphaBytes);
+            alphaSums = &myAlphaSums[0];
+            alphaStride = person.alphaPixel;
+        }
+    }
+    
+    for (wxInt32 row = 0; row < painted.height; row++) {
+        wxInt32 cy = painted.y + row;
+        unsigned char *target = canvas.rgb + cy * canvas.rgbRow + painted.x * canvas.rgbPixel;
+        unsigned char *covered = coverage == NULL ? NULL :
+                coverage + cy * canvas.width + painted.x;
+        if (covered != NULL && memchr(covered, 0, painted.width) == NULL) {
+            continue; // Nearer people already fill the row.
+        }
+        
+        // Sum the source rows this row samples.
+        std::fill(myColourSums.begin(), myColourSums.end(), 0);
+        std::fill(myAlphaSums.begin(), myAlphaSums.begin() + alphaBytes, 0);
+        for (const ResampleTap *y = rowTaps + myRowStarts[row];
+                y < rowTaps + myRowStarts[row + 1]; y++) {
+            PixelKernels::accumulate(colourSums,
+                    person.rgb + y->index * person.rgbRow + low * person.rgbPixel,
+                    colourBytes, y->weight);
+            if (alphaBytes > 0) {
+                PixelKernels::accumulate(&myAlphaSums[0],
+                        person.alpha + y->index * person.alphaRow + low * person.alphaPixel,
+                        alphaBytes, y->weight);
+            }
+        }
+        
+        for (wxInt32 column = 0; column < painted.width; column++, target += canvas.rgbPixel) {
+            if (covered != NULL && covered[column]) {
+                continue; // A nearer person is already here.
+            }
+            const ResampleTap *columnFirst = columnTaps + myColumnStarts[column];
+            const ResampleTap *columnEnd = columnTaps + myColumnStarts[column + 1];
+            
+            // Sample alpha first: invisible pixels need no colour.
+            if (alphaSums != NULL) {
+                wxInt64 alpha = 0;
+                for (const ResampleTap *x = columnFirst; x < columnEnd; x++) {
+                    alpha += (wxInt64) x->weight * alphaSums[(x->index - low) * alphaStride];
+                }
+                if ((wxInt32) ((alpha + SUMHALF) >> SUMBITS) < wxIMAGE_ALPHA_THRESHOLD) {
+                    continue;
+                }
+            }
+            wxInt64 red = 0;
+            wxInt64 green = 0;
+            wxInt64 blue = 0;
+            for (const ResampleTap *x = columnFirst; x < columnEnd; x++) {
+                const wxInt32 *sums = colourSums + (x->index - low) * person.rgbPixel;
+                red += (wxInt64) x->weight * sums[0];
+                green += (wxInt64) x->weight * sums[1];
+                blue += (wxInt64) x->weight * sums[2];
+            }
+            target[0] = min(255, (wxInt32) ((red + SUMHALF) >> SUMBITS));
+            target[1] = min(255, (wxInt32) ((green + SUMHALF) >> SUMBITS));
+            target[2] = min(255, (wxInt32) ((blue + SUMHALF) >> SUMBITS));
+            if (covered != NULL) {
+                covered[column] = 1;
+            }
+        }
+    }
+}
+
+/**
+ * Work out where a run of a placement's columns, or rows, sample the source.
+ * Shrinking, a pixel averages the source pixels it covers, weighted by how
+ * much of each it covers, as OpenCV's INTER_AREA does. Enlarging, it
+ * interpolates between the two source pixels nearest its centre. The weights
+ * are rounded to fixed point, the largest taking up the rounding.
+ * @param sourceLength The source width or height.
+ * @param length The placement width or height.
+ * @param first The first column or row of the run, from the placement's edge.
+ * @param count The number of columns or rows in the run.
+ * @param taps The returned taps of each column or row of the run, in order.
+ * @param starts The returned index in taps of each column's or row's first
+ * tap, and one more for the end of the last one's.
+ */
+void ResampleKernel::findTaps(wxInt32 sourceLength, wxInt32 length, wxInt32 first,
+                              wxInt32 count, std::vector<ResampleTap>& taps,
+                              std::vector<wxInt32>& starts) {
+    const wxInt32 ONE = 1 << RESAMPLEBITS;
+    taps.clear();
+    starts.clear();
+    double scale = sourceLength / (double) length;
+    for (wxInt32 d = first; d < first + count; d++) {
+        starts.push_back(taps.size());
+        if (scale > 1.0) {
+            double from = d * scale;
+            double to = (d + 1) * scale;
+            wxInt32 end = min(sourceLength, (wxInt32) ceil(to));
+            size_t firstTap = taps.size();
+            size_t largest = firstTap;
+            wxInt32 total = 0;
+            for (wxInt32 i = floor(from); i < end; i++) {
+                double weight = (min(i + 1.0, to) - max((double) i, from)) / scale;
+                if (weight > 1e-6) {
+                    ResampleTap aTap = {i, (wxInt32) floor(weight * ONE + 0.5)};
+                    if (taps.size() == firstTap || aTap.weight > taps[largest].weight) {
+                        largest = taps.size();
+                    }
+                    total += aTap.weight;
+                    taps.push_back(aTap);
+                }
+            }
+            // Make the rounded weights add up exactly.
+            taps[largest].weight += ONE - total;
+        }
+        else {
+            double centre = max(0.0, (d + 0.5) * scale - 0.5);
+            wxInt32 i = floor(centre);
+            wxInt32 t = (wxInt32) floor((centre - i) * ONE + 0.5);
+            if (i >= sourceLength - 1) {
+                i = sourceLength - 1;
+                t = 0;
+            }
+            if (t == ONE) {
+                i++;
+                t = 0;
+            }
+            ResampleTap nearer = {i, ONE - t};
+            taps.push_back(nearer);
+            if (t > 0) {
+                ResampleTap farther = {i + 1, t};
+                taps.push_back(farther);
+            }
+        }
+    }
+    starts.push_back(taps.size());
+}
+
+/**
+ * View a Mat's pixels.
+ * @param anImage An 8-bit RGBA image with straight alpha, or an 8-bit RGB
+ * image, which is opaque.
+ * @return The view. Valid while anImage's pixels are.
+ */
+PixelView ResampleKernel::view(const Mat& anImage) {
+    PixelView aView;
+    aView.rgb = anImage.data;
+    aView.rgbPixel = anImage.channels();
+    aView.rgbRow = anImage.step;
+    aView.alpha = anImage.channels() == 4 ? anImage.data + 3 : NULL;
+    aView.alphaPixel = 4;
+    aView.alphaRow = anImage.step;
+    aView.width = anImage.cols;
+    aView.height = anImage.rows;
+    return aView;
+}
+
+/**
+ * View a wxImage's pixels.
+ * @param anImage The image. A mask colour is ignored, so masked images need
+ * InitAlpha() first.
+ * @return The view. Valid while anImage's pixels are.
+ */
+PixelView ResampleKernel::view(const wxImage& anImage) {
+    PixelView aView;
+    aView.rgb = anImage.GetData();
+    aView.rgbPixel = 3;
+    aView.rgbRow = 3 * anImage.GetWidth();
+    aView.alpha = anImage.HasAlpha() ? anImage.GetAlpha() : NULL;
+    aView.alphaPixel = 1;
+    aView.alphaRow = anImage.GetWidth();
+    aView.width = anImage.GetWidth();
+    aView.height = anImage.GetHeight();
+    return aView;
+}
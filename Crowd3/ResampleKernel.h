@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef RESAMPLEKERNEL_H
+#define	RESAMPLEKERNEL_H
+
+#include <opencv2/core/core.hpp>
+#include <wx/wx.h>
+#include "const.h"
+#include <vector>
+using namespace cv;
+
+/** The fixed point of resampling weights: a weight of 1 << RESAMPLEBITS is 1. */
+const wxInt32 RESAMPLEBITS = 14;
+
+/** 8-bit pixels with three colour bytes and an optional alpha byte each, in
+ * any layout: interleaved RGBA, or wxImage's separate RGB and alpha planes. */
+struct PixelView {
+    /** The first pixel's red byte. Green and blue follow it. */
+    unsigned char *rgb;
+    
+    /** Bytes from one pixel's colour to the next pixel's. */
+    wxInt32 rgbPixel;
+    
+    /** Bytes from one row's colour to the next row's. */
+    wxInt32 rgbRow;
+    
+    /** The first pixel's alpha byte, or NULL if every pixel is opaque. */
+    unsigned char *alpha;
+    
+    /** Bytes from one pixel's alpha to the next pixel's. */
+    wxInt32 alphaPixel;
+    
+    /** Bytes from one row's alpha to the next row's. */
+    wxInt32 alphaRow;
+    
+    /** The width in pixels. */
+    wxInt32 width;
+    
+    /** The height in pixels. */
+    wxInt32 height;
+};
+
+/** One source pixel's share of a resampled pixel, along one axis. */
+struct ResampleTap {
+    /** The source column or row. */
+    wxInt32 index;
+    
+    /** Its weight, in fixed point. The weights of one resampled pixel add up
+     * to exactly 1 << RESAMPLEBITS. */
+    wxInt32 weight;
+};
+
+/**
+ * Paint a person image onto a canvas at a placement, resampling it while
+ * painting: each canvas pixel is sampled from the person image where it lands,
+ * averaging the source pixels it covers when shrinking and interpolating
+ * bilinearly when enlarging. No scaled copy of the person is made. A pixel is
+ * visible where its sampled alpha reaches wxImage's transparency threshold, as
+ * a scaled wxImage decides.<p>
+ * Each painted row first sums the source rows it samples, over the sampled
+ * columns, with the vectorised PixelKernels::accumulate. Each visible pixel
+ * then sums its columns of that; hidden pixels cost no colour work. The
+ * arithmetic is fixed point, so the result does not depend on the processor.
+ * The sampling positions and the row sums are kept in buffers for the next
+ * person, so painting allocates nothing once the buffers have grown. A kernel
+ * is used by one thread at a time.<p>
+ * Usage:<p><code>
+ * ResampleKernel k;<p>
+ * k.paint(ResampleKernel::view(rgbaPerson), placement,<p>
+ *         ResampleKernel::view(rgbCanvas), area, coverage);<p></code>
+ */
+class ResampleKernel {
+public:
+    ResampleKernel();
+    void paint(const PixelView& person, const wxRect& at, const PixelView& canvas,
+               const wxRect& area, unsigned char *coverage);
+    static PixelView view(const Mat& anImage);
+    static PixelView view(const wxImage& anImage);
+
+private:
+    static void findTaps(wxInt32 sourceLength, wxInt32 length, wxInt32 first,
+                         wxInt32 count, std::vector<ResampleTap>& taps,
+                         std::vector<wxInt32>& starts);
+    
+    /** The taps of each painted column, in order. */
+    std::vector<ResampleTap> myColumnTaps;
+    
+    /** Where each painted column's taps start in myColumnTaps, and one more
+     * for the end of the last column's. */
+    std::vector<wxInt32> myColumnStarts;
+    
+    /** The taps of each painted row, in order. */
+    std::vector<ResampleTap> myRowTaps;
+    
+    /** Where each painted row's taps start in myRowTaps, and one more for the
+     * end of the last row's. */
+    std::vector<wxInt32> myRowStarts;
+    
+    /** The weighted sums of the current painted row's source rows, one per
+     * colour byte of the sampled columns, including interleaved alpha. */
+    std::vector<wxInt32> myColourSums;
+    
+    /** The same for alpha held apart from the colour, as in a wxImage. */
+    std::vector<wxInt32> myAlphaSums;
+};
+
+#endif	/* RESAMPLEKERNEL_H */
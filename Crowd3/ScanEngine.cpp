@@ -0,0 +1,1317 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "ScanEngine.h"
+#include "PixelKernels.h"
+#include <cmath>
+#include <fstream>
+using namespace cv;
+
+// Colors.
+const Scalar redColor = Scalar(0,0,255);
+const Scalar greenColor = Scalar(0,255,0);
+const Scalar blueColor = Scalar(255,0,0);
+const Scalar yellowColor = Scalar(0,255,255);
+
+// Line drawing constants.
+const wxInt32 lineWidth = 2;
+const wxInt32 lineType = 8;
+
+/** The bytes of CV_COLOR_TRANSPARENT, for the pixel kernels. */
+static const unsigned char KEYHOLECOLOR[3] = {1, 1, 1};
+
+/**
+ * Black out the unmarked pixels of a keyhole row outside a circle.
+ * @param row The row's pixels.
+ * @param marks One byte per pixel; pixels marked nonzero are left alone.
+ * @param cols The number of pixels.
+ * @param centre The circle centre's column.
+ * @param room The square of the circle's half width on this row: columns c
+ * with (centre - c)^2 <= room are inside. Negative if the row misses the circle.
+ */
+static void blackOutside(unsigned char *row, const unsigned char *marks,
+                         wxInt32 cols, wxInt32 centre, wxInt32 room) {
+    if (room < 0) {
+        PixelKernels::fillUnmarked(row, marks, cols, KEYHOLECOLOR);
+        return;
+    }
+    // The exact integer square root of room.
+    wxInt32 reach = (wxInt32) sqrt((double) room);
+    while (reach * reach > room) reach--;
+    while ((reach + 1) * (reach + 1) <= room) reach++;
+    wxInt32 left = min(cols, max(0, centre - reach));
+    wxInt32 right = max(left, min(cols, centre + reach + 1));
+    PixelKernels::fillUnmarked(row, marks, left, KEYHOLECOLOR);
+    PixelKernels::fillUnmarked(row + 3 * right, marks + right, cols - right, KEYHOLECOLOR);
+}
+
+/**
+ * Create the engine. The face detectors are given to each search by start().
+ */
+ScanEngine::ScanEngine() {
+    myListener = NULL;
+    myDetector = NULL;
+    myPrescreenDetector = NULL;
+    myRejectCount = 0;
+    myPassedCount = 0;
+    myAuditCount = 0;
+    myMissedCount = 0;
+}
+
+ScanEngine::~ScanEngine() {}
+
+/** Runs one search stage, a ScanEngine member function, on its own thread. */
+class StageThread : public wxThread {
+public:
+    /**
+     * Create a joinable stage thread. Call Run() to start it.
+     * @param engine The search engine.
+     * @param stage The stage function.
+     */
+    StageThread(ScanEngine *engine, void (ScanEngine::*stage)())
+            : wxThread(wxTHREAD_JOINABLE) {
+        myEngine = engine;
+        myStage = stage;
+    }
+
+protected:
+    /** Thread body: run the stage until its input queue is finished. */
+    virtual ExitCode Entry() {
+        (myEngine->*myStage)();
+        return 0;
+    }
+
+private:
+    /** The search engine. */
+    ScanEngine *myEngine;
+
+    /** The stage function. */
+    void (ScanEngine::*myStage)();
+};
+
+/**
+ * Start a search: create the search stage queues and start the stage threads.
+ * @param detector The face detector. Used by one stage thread until finish().
+ * @param prescreenDetector A second detector of the same kind for the
+ * thumbnail pre-screen, or NULL for no pre-screen.
+ * @param peopleFolder The folder people images are written to, with a
+ * trailing separator.
+ * @param listener Receives the results and progress.
+ */
+void ScanEngine::start(FaceDetector *detector, FaceDetector *prescreenDetector,
+                       const string& peopleFolder, ScanListener *listener) {
+    myDetector = detector;
+    myPrescreenDetector = prescreenDetector;
+    myDetectorName = detector->name();
+    myPeopleFolder = peopleFolder;
+    myListener = listener;
+    myCancelled = false;
+    myRejectCount = 0;
+    myPassedCount = 0;
+    myAuditCount = 0;
+    myMissedCount = 0;
+
+    // One masking thread per processor. The other stages are mostly I/O or
+    // internally parallel.
+    myMaskersRunning = max(1, wxThread::GetCPUCount());
+
+    myDecodeQueue = new BoundedQueue<ScanJob*>(PIPELINEDEPTH);
+    myDetectQueue = new BoundedQueue<ScanJob*>(PIPELINEDEPTH);
+    myMaskQueue   = new BoundedQueue<FaceTask>(PIPELINEDEPTH * myMaskersRunning);
+    myEncodeQueue = new BoundedQueue<ScanJob*>(PIPELINEDEPTH);
+    myDoneQueue   = new BoundedQueue<ScanJob*>(PIPELINEDEPTH);
+
+    myStages.push_back(new StageThread(this, &ScanEngine::decodeStage));
+    myStages.push_back(new StageThread(this, &ScanEngine::detectStage));
+    for (wxInt32 i = 0; i < myMaskersRunning; i++) {
+        myStages.push_back(new StageThread(this, &ScanEngine::maskStage));
+    }
+    myStages.push_back(new StageThread(this, &ScanEngine::encodeStage));
+    for (size_t i = 0; i < myStages.size(); i++) {
+        if (myStages[i]->Create() != wxTHREAD_NO_ERROR ||
+                myStages[i]->Run() != wxTHREAD_NO_ERROR) {
+            CoreTools::error("The people search threads could not be started");
+        }
+    }
+}
+
+/**
+ * Hand a source image file to the search stages. While the stages are busy,
+ * finished files are handed to the listener and progress is reported.
+ * @param path The source image pathname.
+ * @return false if the listener asked to stop the search. The file was not
+ * submitted.
+ */
+bool ScanEngine::submit(const string& path) {
+    ScanJob *job = new ScanJob();
+    job->path = path;
+    job->readOK = false;
+    job->decoder = NULL;
+    job->skipped = false;
+    job->rejected = false;
+    job->audited = false;
+    while ( ! myDecodeQueue->push(job, PIPELINEWAIT)) {
+        if ( ! poll()) {
+            delete job;
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Hand finished source image files to the listener, then report progress.
+ * @return false if the listener asked to stop the search.
+ */
+bool ScanEngine::poll() {
+    ScanJob *job;
+    while (myDoneQueue->tryPop(job)) {
+        deliver(job);
+    }
+    return myListener->progress();
+}
+
+/**
+ * Wait for the search stages to finish, handing the remaining source images
+ * to the listener, then stop the stage threads.
+ * @param completed false to discard the source images still in the stages.
+ */
+void ScanEngine::finish(bool completed) {
+    myDecodeQueue->close();
+    ScanJob *job;
+    while (completed) {
+        if (myDoneQueue->pop(job, PIPELINEWAIT)) {
+            deliver(job);
+        }
+        else if (myDoneQueue->isFinished()) {
+            break;
+        }
+        if ( ! myListener->progress()) {
+            completed = false;
+        }
+    }
+
+    if ( ! completed) {
+        // Stop early. Every stage discards what it receives from now on.
+        myCancelled = true;
+        myDetectQueue->close();
+        myMaskQueue->close();
+        myEncodeQueue->close();
+        myDoneQueue->close();
+    }
+    for (size_t i = 0; i < myStages.size(); i++) {
+        myStages[i]->Wait();
+        delete myStages[i];
+    }
+    myStages.clear();
+    while (myDoneQueue->tryPop(job)) {
+        delete job;
+    }
+
+    // Give back the image IDs that were reserved but not used. IDs reserved
+    // for discarded source images are never reused.
+    myImageIDs.release();
+
+    delete myDecodeQueue;
+    delete myDetectQueue;
+    delete myMaskQueue;
+    delete myEncodeQueue;
+    delete myDoneQueue;
+}
+
+/**
+ * Hand a finished source image file to the listener and count it in the
+ * pre-screen's statistics.
+ * @param job The finished source image. Deleted.
+ */
+void ScanEngine::deliver(ScanJob *job) {
+    ScanResult result;
+    result.path = job->path;
+    result.readOK = job->readOK;
+    result.skipped = job->skipped;
+    result.error = job->error;
+    result.firstID = -1;
+    result.lastID = -1;
+    if (job->faces.size() > 0) {
+        result.firstID = job->firstID;
+        result.lastID = job->firstID + job->faces.size() - 1;
+    }
+    result.detector = myDetectorName;
+    if (job->skipped) {
+        result.detector = SKIPPEDDETECTOR;
+    }
+    else if (job->rejected) {
+        result.detector = myDetectorName + PRESCREENTAG;
+    }
+    wxMutexLocker lock(myCountsLock);
+    if (job->audited) {
+        myAuditCount++;
+        myMissedCount = myMissedCount + (job->faces.empty() ? 0 : 1);
+    }
+    else if (myPrescreenDetector != NULL && ! job->faces.empty()) {
+        myPassedCount++;
+    }
+    delete job;
+    myListener->scanned(result);
+}
+
+/** @return The number of photos rejected by the pre-screen but searched anyway. */
+wxInt32 ScanEngine::getAuditCount() {
+    wxMutexLocker lock(myCountsLock);
+    return myAuditCount;
+}
+
+/**
+ * Estimate the pre-screen's recall from the rejected photos that were
+ * searched anyway.
+ * @return The estimated fraction of photos with people that the pre-screen
+ * passes. 1 until a rejected photo has been checked.
+ */
+double ScanEngine::getPrescreenRecall() {
+    wxMutexLocker lock(myCountsLock);
+    if (myAuditCount == 0) {
+        return 1.0;
+    }
+    double missed = (double) myMissedCount / myAuditCount *
+                    (myRejectCount - myAuditCount);
+    return (myPassedCount + myMissedCount) == 0 ? 1.0 :
+            (myPassedCount + myMissedCount) / (myPassedCount + myMissedCount + missed);
+}
+
+/**
+ * Search stage: read source image files. Files whose header shows they are
+ * not images of a known format, or are too small to hold a face of
+ * FACEPERCENT size, are not decoded and go straight to be recorded. So are
+ * photos the pre-screen finds no face in, except every PRESCREENAUDIT'th.
+ */
+void ScanEngine::decodeStage() {
+    ScanJob *job;
+    while (myDecodeQueue->pop(job)) {
+        if ( ! myCancelled) {
+            // The leading bytes decide the format. A JPEG header also locates
+            // the thumbnail for the pre-screen.
+            wxInt32 width = 0;
+            wxInt32 height = 0;
+            job->decoder = ImageDecoder::find(job->path);
+            if (job->decoder == NULL) {
+                job->readOK = false;
+            }
+            else if (job->header.read(job->path)) {
+                job->readOK = true;
+                width = job->header.getWidth();
+                height = job->header.getHeight();
+            }
+            else {
+                job->readOK = job->decoder->readSize(job->path, width, height);
+            }
+            // Sizes are not known for every format.
+            job->skipped = ! job->readOK ||
+                    (width > 0 && min(width, height) * FACEPERCENT < MINFACEWIDTH);
+        }
+        if ( ! myCancelled && ! job->skipped && myPrescreenDetector != NULL &&
+                ! prescreen(job)) {
+            wxMutexLocker lock(myCountsLock);
+            myRejectCount++;
+            job->audited = myRejectCount % PRESCREENAUDIT == 0;
+            job->rejected = ! job->audited;
+        }
+        if ( ! myCancelled && (job->skipped || job->rejected)) {
+            if ( ! myDoneQueue->push(job)) {
+                delete job;
+            }
+            continue;
+        }
+        if ( ! myCancelled) {
+            // Decoded as stored. Detection and cropping happen in the upright
+            // frame the EXIF orientation gives.
+            job->planes.setSource(job->decoder->decode(job->path, CV_LOAD_IMAGE_UNCHANGED),
+                                  job->header.getOrientation());
+            job->readOK = job->planes.source().data != NULL;
+        }
+        if (myCancelled || ! myDetectQueue->push(job)) {
+            delete job;
+        }
+    }
+    myDetectQueue->close();
+}
+
+/**
+ * Look for a face in a small version of a photo: its EXIF thumbnail, or a
+ * reduced decode where OpenCV supports one. Used by the decoding stage.
+ * @param job The photo. Its header has been read.
+ * @return false if no face was found, true if one was or the photo has no
+ * small version.
+ */
+bool ScanEngine::prescreen(ScanJob *job) {
+    Mat small;
+    long offset = job->header.getThumbnailOffset();
+    if (offset >= 0 && job->header.getThumbnailLength() > 0) {
+        vector<uchar> thumbnail(job->header.getThumbnailLength());
+        ifstream in(job->path.c_str(), ios::in | ios::binary);
+        in.seekg(offset);
+        in.read((char*) &thumbnail[0], thumbnail.size());
+        if (in) {
+            // Thumbnails are stored the same way up as the photo.
+            ImagePlanes::orient(imdecode(thumbnail, CV_LOAD_IMAGE_COLOR), small,
+                                job->header.getOrientation());
+        }
+    }
+#if CV_MAJOR_VERSION > 3 || (CV_MAJOR_VERSION == 3 && CV_MINOR_VERSION >= 2)
+    if (small.empty()) {
+        // Decode at the smallest scale that still shows a FACEPERCENT face.
+        double face = FACEPERCENT * min(job->header.getWidth(), job->header.getHeight());
+        if (face >= 2 * PRESCREENFACEWIDTH) {
+            wxInt32 flag = face >= 8 * PRESCREENFACEWIDTH ? IMREAD_REDUCED_COLOR_8 :
+                           face >= 4 * PRESCREENFACEWIDTH ? IMREAD_REDUCED_COLOR_4 :
+                                                            IMREAD_REDUCED_COLOR_2;
+            small = imread(job->path, flag);
+        }
+    }
+#endif
+    if (small.empty()) {
+        return true;
+    }
+    
+    double scale = PRESCREENFACEWIDTH / (FACEPERCENT * min(small.rows, small.cols));
+    if (scale > 1.0) {
+        resize(small, small, Size(), scale, scale, INTER_LINEAR);
+    }
+    Mat gray;
+    cvtColor(small, gray, CV_BGR2GRAY);
+    equalizeHist(gray, gray);
+    wxInt32 faceMin = FACEPERCENT * min(gray.rows, gray.cols);
+    return ! myPrescreenDetector->detect(gray, small, faceMin).empty();
+}
+
+/** Search stage: detect faces and reserve an image ID for each. */
+void ScanEngine::detectStage() {
+    ScanJob *job;
+    while (myDetectQueue->pop(job)) {
+        if (myCancelled) {
+            delete job;
+            continue;
+        }
+        if ( ! job->readOK) {
+            // Nothing to search. Report the error.
+            if ( ! myDoneQueue->push(job)) {
+                delete job;
+            }
+            continue;
+        }
+        job->faces = findFaces(job->planes);
+        job->planes.releaseDerived(); // Masking needs only the source.
+        if ( ! job->faces.empty()) {
+            job->firstID = myImageIDs.reserve(job->faces.size(), job->error);
+            if (job->firstID < 0) {
+                job->faces.clear();
+            }
+        }
+        if (job->faces.empty()) {
+            // No people to cut out.
+            job->planes.release();
+            if ( ! myEncodeQueue->push(job)) {
+                delete job;
+            }
+            continue;
+        }
+
+        // Mask the faces of this photo in parallel. Each face's image ID is
+        // fixed by its position, whatever order the faces finish in.
+        job->people.resize(job->faces.size());
+        job->facesLeft = job->faces.size();
+        for (size_t i = 0; i < job->faces.size(); i++) {
+            FaceTask task;
+            task.job = job;
+            task.index = i;
+            if ( ! myMaskQueue->push(task)) {
+                faceDone(job); // Cancelled. The job is deleted with its last face.
+            }
+        }
+    }
+    myMaskQueue->close();
+}
+
+/** Search stage: cut one detected person out of its source image. */
+void ScanEngine::maskStage() {
+    FaceTask task;
+    while (myMaskQueue->pop(task)) {
+        if ( ! myCancelled) {
+            ScanJob *job = task.job;
+            job->people[task.index] = makePerson(job->planes, job->faces[task.index]);
+        }
+        faceDone(task.job);
+    }
+
+    // The last masking thread to finish ends the encoding stage's input.
+    wxMutexLocker lock(myMaskersLock);
+    myMaskersRunning--;
+    if (myMaskersRunning == 0) {
+        myEncodeQueue->close();
+    }
+}
+
+/**
+ * Count a face of a source image as masked. When it is the image's last face,
+ * pass the image on to the encoding stage.
+ * @param job The source image.
+ */
+void ScanEngine::faceDone(ScanJob *job) {
+    bool last;
+    {
+        wxMutexLocker lock(myMaskersLock);
+        job->facesLeft--;
+        last = job->facesLeft == 0;
+    }
+    if (last) {
+        job->planes.release();
+        if (myCancelled || ! myEncodeQueue->push(job)) {
+            delete job;
+        }
+    }
+}
+
+/** Search stage: write the people images to disk, named by image ID. */
+void ScanEngine::encodeStage() {
+    ScanJob *job;
+    while (myEncodeQueue->pop(job)) {
+        for (size_t i = 0; i < job->people.size() && ! myCancelled; i++) {
+            string destPath = myPeopleFolder + CoreTools::int2str(job->firstID + i) + ".png";
+            imwrite(destPath, job->people[i]);
+        }
+        job->people.clear();
+        if (myCancelled || ! myDoneQueue->push(job)) {
+            delete job;
+        }
+    }
+    myDoneQueue->close();
+}
+
+/**
+ * Enlarge a detected face to take in the head, assume a body beneath it, and
+ * cut out the person scaled to a standard size with the background masked.
+ * Only the person's region of the source image is converted to 8-bit BGR.
+ * Called from the masking stage threads.
+ * @param planes The source image.
+ * @param aFaceRect The detected face.
+ * @return The person image.
+ */
+Mat ScanEngine::makePerson(ImagePlanes& planes, Rect aFaceRect) {
+    Size imageSize = planes.size(); // Upright.
+
+    // For debugging: Draw key rectangles on face. Disable call to maskHead when drawing.
+    // rectangle(theImage, aFaceRect, blueColor, 3); // Outline the face.
+    // Rect central = Rect(aFaceRect.x + aFaceRect.width/3, aFaceRect.y + aFaceRect.height/4, aFaceRect.width/3, aFaceRect.height/2);
+    // rectangle(theImage, central, redColor, 3);
+    // Rect topcentral = Rect(aFaceRect.x + aFaceRect.width/3, aFaceRect.y - aFaceRect.height/5, aFaceRect.width/3, aFaceRect.height/2);
+    // rectangle(theImage, topcentral, yellowColor, 3);
+
+    // Expand the face area to encompass the entire (mostly) head.
+    Rect head = aFaceRect;
+    head.x = head.x - ((HEADWIDTH - 1) * aFaceRect.width) / 2;
+    head.width = HEADWIDTH * aFaceRect.width;
+    head.y = head.y - ((HEADHEIGHT - 1) * aFaceRect.height);
+    head.height = HEADHEIGHT * aFaceRect.height;
+    // rectangle(theImage, head, greenColor, 2); // Outline the head.
+
+    // Assume an area below head is part of the upper body.
+    Rect body;
+    body.x = head.x - ((BODYWIDTH - 1) * head.width) / 2;
+    body.width = BODYWIDTH * head.width;
+    body.y = head.y + head.height;
+    body.height = BODYHEIGHT * head.height;
+
+    // Bounds corrections: the enlarged rectangles surrounding the head
+    // and body may extend beyond the image boundaries. Bring them back in.
+    if (head.x < 0) {
+        head.width = head.width + head.x; // Subtract head.x
+        head.x = 0;
+    }
+    if (head.y < 0) {
+        head.height = head.height + head.y; // Subtract head.y
+        head.y = 0;
+    }
+    if (head.x + head.width > imageSize.width) {
+        head.width = imageSize.width - head.x;
+    }
+    if (head.y + head.height > imageSize.height) {
+        head.height = imageSize.height - head.y;
+    }
+    if (body.x < 0) {
+        body.width = body.width + body.x; // Subtract body.x
+        body.x = 0;
+    }
+    if (body.y < 0) {
+        body.height = body.height + body.y; // Subtract body.y
+        body.y = 0;
+    }
+    if (body.x + body.width > imageSize.width) {
+        body.width = imageSize.width - body.x;
+    }
+    if (body.y + body.height > imageSize.height) {
+        body.height = imageSize.height - body.y;
+    }
+
+    // Combine head & body then scale to a standard size.
+    Mat p = planes.bgr(Rect(body.x, head.y, body.width, head.height + body.height));
+    Mat person;
+    double scaleFactor = SCALEDFACEWIDTH/aFaceRect.width;
+    resize(p, person, Size(), scaleFactor, scaleFactor);
+
+    // Scale the face rectangle and make relative to head/body.
+    aFaceRect.x = (aFaceRect.x - body.x) * scaleFactor;
+    aFaceRect.y = (aFaceRect.y - head.y) * scaleFactor;
+    aFaceRect.width = aFaceRect.width * scaleFactor;
+    aFaceRect.height = aFaceRect.height * scaleFactor;
+
+    // Make the head rectangle relative to the top-left of the scaled person.
+    head.x = (head.x - body.x) * scaleFactor;
+    head.y = 0;
+    head.width = head.width * scaleFactor;
+    head.height = head.height * scaleFactor;
+
+    // Make regions around the head and shoulders invisible.
+    maskHead(person, head, aFaceRect);
+    return person;
+}
+
+/**
+ * Search for faces in an image. The equalized grayscale plane is computed here,
+ * once. Called from the detection stage thread.
+ * @param planes The source image.
+ * @return a vector of discovered faces.
+ */
+std::vector<Rect> ScanEngine::findFaces(ImagePlanes& planes) {
+    // Search for faces that exceed a minimum size.
+    const Mat& theImageGray = planes.equalized();
+    wxInt32 faceMin = FACEPERCENT * min(theImageGray.rows, theImageGray.cols);
+    if (planes.orientation() == 1) {
+        return myDetector->detect(theImageGray, planes.source(), faceMin);
+    }
+    // Not stored upright. Give the detector a small upright colour image rather
+    // than turning the whole photo.
+    return myDetector->detect(theImageGray, planes.preview(PREVIEWSIDE), faceMin);
+}
+
+/**
+ * Set pixels outside the head and shoulder areas to an "invisible" color that
+ * can be detected and blended away when crowd images are created.
+ * @param m A Mat structure containing a person image (head & body).
+ * @param aHead The head rectangle in the person.
+ * @param aFace The face rectangle discovered by face detection.
+ */
+void ScanEngine::maskHead(Mat& m, Rect aHead, Rect aFace) {
+
+    // This function has two parts:
+    // 1. Use the person image features to mask out pixels around the head.
+    // 2. Use a fixed-size small "keyhole" mask around the head and shoulders
+    //    to define a minimum size image to be returned.
+
+    // 1. Try to find the contour of the person's head by identifying the
+    // face and hair, and then drawing a convex hull around it.
+
+    // Top part of the image down to the bottom of the head.
+    Mat mTop(m, Rect(0, 0, m.cols, max(aHead.height, aFace.y + aFace.height)));
+    // Collection of discovered face/hair points.
+    vector<Point> facePoints;
+    // Contains points in a hull drawn around the discovered head.
+    vector<vector<Point> >hullFacePoints(1);
+    // Contains an ellipse drawn around the discovered head.
+    Mat hullMat = Mat::zeros(m.size(), m.type());
+    // The new face and head rectangles resulting from face/hair searches.
+    Rect newFace = Rect(0, 0, 0, 0);
+    Rect newHead = Rect(0, 0, 0, 0);
+    // For debugging: record the face and hair search sensitivity (-1 = colour model).
+    int faceSens = 0;
+    int hairSens = 0;
+
+    // Search for face.
+    // Find connected color regions for a set of points on the face.
+    // The objective is to identify the entire set of face points. Sometimes
+    // hair is also discovered.
+    // First grow the face from a skin colour model of its centre. This usually
+    // succeeds in one pass. Otherwise search with declining sensitivity trying
+    // to find the largest acceptable face.
+    // Use only the top part of the image (mTop).
+    Mat mTopYCrCb;
+    cvtColor(mTop, mTopYCrCb, CV_BGR2YCrCb);
+    vector<Point> facePointsCopy = facePoints;
+    Mat hullMatCopy = hullMat.clone();
+    Rect faceCopy;
+    bool faceFound = false;
+    skinSearch(mTopYCrCb, aFace, facePointsCopy);
+    if (acceptRegion(mTop, facePointsCopy, hullMatCopy, hullFacePoints,
+            aFace.width, 1.5, faceCopy)) {
+        faceFound = true;
+        hullMat = hullMatCopy;
+        facePoints = facePointsCopy;
+        newFace = faceCopy;
+        faceSens = -1;
+    }
+    for (wxInt32 sens = 20; sens > 0 && ! faceFound; sens = sens - 5) {
+        // Save facePoints and hullMat. Restore later.
+        facePointsCopy = facePoints;
+        hullMatCopy = hullMat.clone();
+
+        faceSearch(mTop, aFace, facePointsCopy, sens);
+
+        // Test for an acceptable face. If face has grown too much
+        // or fails the sanity check then try search with lower sensitivity.
+        if (acceptRegion(mTop, facePointsCopy, hullMatCopy, hullFacePoints,
+                aFace.width, 1.5, faceCopy)) {
+            // Acceptable. Restore facePoints and hullMat.
+            faceFound = true;
+            hullMat = hullMatCopy;
+            facePoints = facePointsCopy;
+            newFace = faceCopy;
+            faceSens = sens;
+        }
+    }
+
+    /* For debugging: clear the face points so we can examine only hair points.
+        facePoints.clear();
+    */
+
+    // Search for hair if a face was found. Same method as face search: a hair
+    // colour model sampled just above the face first, then the retry ladder.
+    if (newFace.width > 0) {
+        facePointsCopy = facePoints;
+        hullMatCopy = hullMat.clone();
+        Rect headCopy;
+        bool headFound = false;
+        hairModelSearch(mTopYCrCb, newFace, facePointsCopy);
+        if (acceptRegion(mTop, facePointsCopy, hullMatCopy, hullFacePoints,
+                aHead.width, 1.7, headCopy)) {
+            headFound = true;
+            hullMat = hullMatCopy;
+            facePoints = facePointsCopy;
+            newHead = headCopy;
+            hairSens = -1;
+        }
+        for (wxInt32 sens = 20; sens > 0 && ! headFound; sens = sens - 5) {
+            // Save facePoints and hullMat. Restore later.
+            facePointsCopy = facePoints;
+            hullMatCopy = hullMat.clone();
+
+            hairSearch(mTop, aFace, newFace, facePointsCopy, sens);
+
+            // Test for an acceptable head. If head has grown too much
+            // or fails the sanity check then try search with lower sensitivity.
+            if (acceptRegion(mTop, facePointsCopy, hullMatCopy, hullFacePoints,
+                    aHead.width, 1.7, headCopy)) {
+                // Acceptable. Restore facePoints and hullMat.
+                headFound = true;
+                hullMat = hullMatCopy;
+                facePoints = facePointsCopy;
+                newHead = headCopy;
+                hairSens = sens;
+            }
+        }
+    }
+
+    // Note that hullFacePoints[0] is invalid if no acceptable head found.
+
+    /* For debugging: set discovered face/hair points to red.
+    for (wxInt32 i = 0; i<facePoints.size(); i++) {
+        Point p = facePoints.at(i);
+        m.at<Vec3b>(p) = Vec<unsigned char,3>(0,0,255);
+    }
+    */
+
+    /* For debugging: Output image data.
+    cout << myNextImageID  << " " <<
+            faceSens       << " " << hairSens     << " " <<
+            newHead.width  << " " << aHead.width  << " " <<
+            newHead.height << " " << aHead.height << " " <<
+            newFace.width  << " " << aFace.width  << " " <<
+            newFace.height << " " << aFace.height << " " << endl;
+    */
+
+    /* For debugging: show face/hair discoveries and contours. Skip keyhole.
+        rectangle(m, aFace, yellowColor, lineWidth); // Outline the old face.
+        rectangle(m, newFace, blueColor, lineWidth); // Outline the new face.
+        drawContours(m, hullFacePoints, 0, redColor, lineWidth, lineType, vector<Vec4i>(), 0, Point()); // Draw the hull.
+        ellipse(m, fitEllipse(hullFacePoints[0]), greenColor, lineWidth, lineType); // Draw the smoothed hull.
+        return; // Skip keyhole.
+    */
+
+    // 2. Define a small keyhole outline around the head and body.
+    // The small keyhole defines the minimum size of the person image to be
+    // returned.  The image may be larger if the hull extends outside the keyhole.
+
+    wxInt32 hx, hy, hw, hh, hcx, hcy, h2, sx, sy, s2;
+    // Use either the old (original) head or the new head as center of the keyhole.
+    // If a good new head wasn't found use the old head.
+    // Compute head and shoulder characteristics using the choice.
+
+    // Test for a too narrow head.  If so, default to old head and throw away
+    // face/hair discoveries.
+    if ((newHead.width / (double) aHead.height) < 0.5) {
+        hullMat = Mat::zeros(m.size(), m.type());
+        newHead.width = 0;
+    }
+
+    // Test for a narrow new face width vs. old face width.
+    if (newHead.width > 0 && (newFace.width / (double) aFace.width) >= 0.7) {
+        // It's likely that a good head was discovered.  Use newHead.
+
+        // Get y, height, y-center of new head.
+        hy = newHead.y;
+        hh = newHead.height;
+        hcy = hy + hh/2;
+
+        // Find the actual head x and width half way down the head.
+        const unsigned char *middle = hullMat.ptr(hcy);
+        wxInt32 first = PixelKernels::firstSet(middle, m.cols);
+        if (first < m.cols) {
+            hx = first;
+        }
+        wxInt32 last = PixelKernels::lastSet(middle, m.cols);
+        if (last > 0) {
+            hw = last - hx;
+        }
+
+        // Get x-center of new head.
+        hcx = hx + hw/2;
+
+        // Suppress top (round) part of keyhole since there is a good head.
+        // Set square of head radius (h2) to zero to suppress top part of keyhole.
+        h2=0;
+    }
+    else {
+        // Use old head as default.
+        hx = aHead.x;
+        hy = aHead.y;
+        hw = aHead.width;
+        hh = aHead.height;
+
+        // Compute head center (hx, hy) and square of head radius (h2).
+        hcx = hx + hw/2;
+        hcy = aFace.y + (aFace.height / 5); // (hy is always = 0, can't be used.)
+        h2 = hw/2 * hw/2;
+    }
+
+    // Compute shoulder center (sx, sy) and square of shoulder radius (s2).
+    // s2 is distance from (sx, sy) to leftmost point where head and body meet.
+    sx = hcx;
+    wxInt32 radius = max(hcx, m.cols - hcx);
+    sy = hy + hh + radius;
+    s2 = (hx - sx) * (hx - sx) + (hy + hh - sy) * (hy + hh - sy);
+
+    // Construct the keyhole, a row at a time with the pixel kernels.
+    // Upper half of head: black out points outside the hull but not inside
+    // the head circle. Each column is blacked out down to its first hull
+    // point; marks records the columns that have reached it.
+    vector<unsigned char> marks(m.cols, 0);
+    for (wxInt32 r = 0; r < hcy; r++) {
+        PixelKernels::markSet(&marks[0], hullMat.ptr(r), m.cols);
+        blackOutside(m.ptr(r), &marks[0], m.cols, hcx, h2 - (hcy-r)*(hcy-r));
+    }
+
+    // Lower half of head: black out points outside the hull but not inside
+    // the head rectangle.
+    wxInt32 leftEnd = min(hx, m.cols);
+    wxInt32 rightStart = max(0, hx + hw + 1);
+    for(wxInt32 r = 0; r < hy + hh; r++) {
+        const unsigned char *hullRow = hullMat.ptr(r);
+        unsigned char *row = m.ptr(r);
+        // Black out left of head.
+        PixelKernels::fill(row, PixelKernels::firstSet(hullRow, leftEnd), KEYHOLECOLOR);
+        // Black out right of head.
+        if (rightStart < m.cols) {
+            wxInt32 edge = rightStart + 1 + PixelKernels::lastSet(
+                    hullRow + 3 * rightStart, m.cols - rightStart);
+            PixelKernels::fill(row + 3 * edge, m.cols - edge, KEYHOLECOLOR);
+        }
+    }
+
+    // Upper half of body: black out points outside of shoulder circle but not
+    // inside the hull.
+    for (wxInt32 r = hy + hh; r < min(sy, m.rows); r++) {
+        std::fill(marks.begin(), marks.end(), 0);
+        PixelKernels::markSet(&marks[0], hullMat.ptr(r), m.cols);
+        blackOutside(m.ptr(r), &marks[0], m.cols, sx, s2 - (sy-r)*(sy-r));
+    }
+
+    // Finally, remove top rows of the image that are marked as invisible.
+    for (wxInt32 r = 0; r < m.rows; r++) {
+        if (PixelKernels::firstOther(m.ptr(r), m.cols, KEYHOLECOLOR) < m.cols) {
+            // Remove rows above r from mat m.
+            m = m.rowRange(r, m.rows);
+            return;
+        }
+    }
+}
+
+/**
+ * Isolate the skin points on a discovered face by searching for colors similar
+ * to those of the skin points on a cross through a central rectangle on the
+ * discovered face.
+ * @param m An image
+ * @param aFace A discovered face on m.
+ * @param facePoints The skin colored face points discovered.
+ * @param sensitivity The sensitivity of the search.
+ */
+void ScanEngine::faceSearch(Mat& m, Rect aFace,
+        vector<Point>& facePoints, wxInt32 sensitivity) {
+    Point seed;
+
+    // Create a mask slightly larger than the image for floodFill.
+    Mat imgMask = Mat::zeros(m.rows+2, m.cols+2, CV_8UC1);
+
+    // Vertical part of the cross:
+    for (wxInt32 y = aFace.y + aFace.height/4; y < aFace.y + aFace.height*3/4; y=y+2) {
+        seed = Point(aFace.x + aFace.width/2, y);
+        findColorRegion(m, imgMask, seed, sensitivity);
+    }
+    // Horizontal part of the cross:
+    for (wxInt32 x = aFace.x + aFace.width/3; x < aFace.x + aFace.width*2/3; x=x+2) {
+        seed = Point(x, aFace.y + aFace.height/2);
+        findColorRegion(m, imgMask, seed, sensitivity);
+    }
+
+    // Reduce the mask to the image size.
+    Mat imgSMask(imgMask, Rect(1, 1, m.cols, m.rows));
+
+    // Test the leftmost and rightmost discovered point half way down the face
+    // to try to extend the sides of the head.
+    wxInt32 r = aFace.y + aFace.height/2;
+    for (wxInt32 c = 0; c < m.cols; c++) {
+        if (imgSMask.at<unsigned char>(r, c) == 1) {
+            seed = Point(c, r);
+            findColorRegion(m, imgMask, seed, sensitivity);
+            break;
+        }
+    }
+    for (wxInt32 c = m.cols-1; c >= 0; c--) {
+        if (imgSMask.at<unsigned char>(r, c) == 1) {
+            seed = Point(c, r);
+            findColorRegion(m, imgMask, seed, sensitivity);
+            break;
+        }
+    }
+
+    // Get the points from the mask to facePoints.
+    for (wxInt32 c = 0; c < m.cols; c++) {
+        for (wxInt32 r = 0; r < m.rows; r++) {
+            if (imgSMask.at<unsigned char>(r, c) == 1) {
+                facePoints.push_back(Point(c, r));
+            }
+        }
+    }
+}
+
+/**
+ * Search for hair points.
+ * @param m An Image.
+ * @param oldFace A discovered face on m.
+ * @param newFace A face expanded by a faceSearch.
+ * @param facePoints The skin and hair points discovered.
+ * @param sensitivity The sensitivity of the search.
+ */
+void ScanEngine::hairSearch(Mat& m, Rect oldFace, Rect newFace,
+        vector<Point>& facePoints, wxInt32 sensitivity) {
+    Point seed;
+
+    // Create a mask slightly larger than the image for floodFill.
+    Mat imgMask = Mat::zeros(m.rows+2, m.cols+2, CV_8UC1);
+
+    // Search differently for hair depending on the face growth due to the face search.
+    if ((newFace.height / (double) oldFace.height) > 1.25) {
+        // If the new face grew significantly:
+        // Search upwards from the old face toward but not reaching the new face.
+        wxInt32 x = newFace.x + newFace.width/2;
+        for (wxInt32 y = oldFace.y;
+                y > std::max(0.0, newFace.y + newFace.height - 1.20 * oldFace.height); y=y-2) {
+            seed = Point(x, y);
+            findColorRegion(m, imgMask, seed, sensitivity);
+        }
+    }
+    else {
+        // Search the center of the newFace top line.
+        for (wxInt32 x = newFace.x + newFace.width*4/10;
+                x < newFace.x + newFace.width*6/10; x = x + 4) {
+            seed = Point(x, newFace.y);
+            findColorRegion(m, imgMask, seed, sensitivity);
+        }
+
+        // Search slightly upwards from the newFace top line.
+        for (wxInt32 y = newFace.y; y > max(0, newFace.y - newFace.height/20); y = y - 2) {
+            seed = Point(newFace.x + newFace.width/2, y);
+            findColorRegion(m, imgMask, seed, sensitivity);
+        }
+
+        // Near left corner of oldFace top line.
+        // If top-left corner of old face is inside top-left corner of new face
+        // then test a point on old face top line in from corner.
+        if (oldFace.x > newFace.x && oldFace.y > newFace.y) {
+            seed = Point(oldFace.x + oldFace.width/10, oldFace.y);
+            findColorRegion(m, imgMask, seed, sensitivity);
+        }
+
+        // Near right corner of oldFace top line.
+        // If top-right corner of old face is inside top-right corner of new face
+        // then test a point on old face top line in from corner.
+        if (oldFace.x + oldFace.width < newFace.x + newFace.width) {
+            seed = Point(oldFace.x + oldFace.width*9/10, oldFace.y);
+            findColorRegion(m, imgMask, seed, sensitivity);
+        }
+
+        // Near left and right corners of oldFace top line.
+        // If newFace sides are inside oldFace sides and newFace top is
+        // above oldFace top then test points in from corners on oldFace top.
+        if (oldFace.y > newFace.y && newFace.x > oldFace.x &&
+                newFace.x + newFace.width < oldFace.x + oldFace.width) {
+            seed = Point(newFace.x + newFace.width/10, oldFace.y);
+            findColorRegion(m, imgMask, seed, sensitivity);
+            seed = Point(newFace.x + newFace.width*9/10, oldFace.y);
+            findColorRegion(m, imgMask, seed, sensitivity);
+        }
+
+        // If newFace top corners are inside oldFace top corners then test
+        // near corners of both faces.
+        if (newFace.x > oldFace.x &&
+                newFace.x + newFace.width < oldFace.x + oldFace.width &&
+                newFace.y > oldFace.y) {
+            // Test 20% from corners on old line, at corners on new line.
+            seed = Point(oldFace.x + oldFace.width*2/10, oldFace.y);
+            findColorRegion(m, imgMask, seed, sensitivity);
+            seed = Point(oldFace.x + oldFace.width*8/10, oldFace.y);
+            findColorRegion(m, imgMask, seed, sensitivity);
+            seed = Point(newFace.x, newFace.y);
+            findColorRegion(m, imgMask, seed, sensitivity);
+            seed = Point(newFace.x + newFace.width, newFace.y);
+            findColorRegion(m, imgMask, seed, sensitivity);
+        }
+    }
+
+    // Reduce the mask to the image size.
+    Mat imgSMask(imgMask, Rect(1, 1, m.cols, m.rows));
+
+    // Test the topmost discovered point in the center of the new face
+    // to try to extend the top of the head..
+    wxInt32 c = newFace.x + newFace.width/2;
+    for (wxInt32 r = 0; r < m.rows; r++) {
+        if (imgSMask.at<unsigned char>(r, c) == 1) {
+            seed = Point(c, r);
+            findColorRegion(m, imgMask, seed, sensitivity);
+            break;
+        }
+    }
+    // test the leftmost point on the new face top line
+    wxInt32 r = newFace.y;
+    for (wxInt32 c = 0; c < m.cols; c++) {
+        if (imgSMask.at<unsigned char>(r, c) == 1) {
+            seed = Point(c, r);
+            findColorRegion(m, imgMask, seed, sensitivity);
+            break;
+        }
+    }
+    // Test the rightmost point on the new face top line
+    for (wxInt32 c = m.cols-1; c >=0; c--) {
+        if (imgSMask.at<unsigned char>(r, c) == 1) {
+            seed = Point(c, r);
+            findColorRegion(m, imgMask, seed, sensitivity);
+            break;
+        }
+    }
+
+    // test the leftmost point on the old face top line
+    r = oldFace.y;
+    for (wxInt32 c = 0; c < m.cols; c++) {
+        if (imgSMask.at<unsigned char>(r, c) == 1) {
+            seed = Point(c, r);
+            findColorRegion(m, imgMask, seed, sensitivity);
+            break;
+        }
+    }
+    // Test the rightmost point on the old face top line
+    for (wxInt32 c = m.cols-1; c >=0; c--) {
+        if (imgSMask.at<unsigned char>(r, c) == 1) {
+            seed = Point(c, r);
+            findColorRegion(m, imgMask, seed, sensitivity);
+            break;
+        }
+    }
+
+    // Get the points from the mask to facePoints.
+    for (wxInt32 c = 0; c < m.cols; c++) {
+        for (wxInt32 r = 0; r < m.rows; r++) {
+            if (imgSMask.at<unsigned char>(r, c) == 1) {
+                facePoints.push_back(Point(c, r));
+            }
+        }
+    }
+}
+
+/**
+ * Decide whether a set of discovered face or hair points is an acceptable
+ * head. Draw a smoothed hull around the points on hullMat.
+ * @param mTop The top part of the person image, where the points were found.
+ * @param points The discovered points.
+ * @param hullMat Scratch pad. The ellipse around the points is drawn on it.
+ * @param hull Receives the convex hull around the points.
+ * @param refWidth The width of the face or head the points started from.
+ * @param maxGrowth The points may be at most this many times refWidth wide.
+ * @param found Receives the rectangle around the points.
+ * @return true if the points make an acceptable head.
+ */
+bool ScanEngine::acceptRegion(Mat& mTop, vector<Point>& points, Mat& hullMat,
+        vector<vector<Point> >& hull, double refWidth, double maxGrowth, Rect& found) {
+    found = Rect(0, 0, 0, 0);
+    if (points.size() > 2) {
+        found = boundingRect(points);
+
+        // First test: reject a region that has grown too much.
+        if ((found.width / refWidth) > maxGrowth) {
+            return false;
+        }
+
+        // Construct a hull around all the discovered face and hair points.
+        convexHull(points, hull[0], false);
+    }
+
+    // Smooth the hull by drawing an ellipse (filled) around it on hullMat.
+    if (hull[0].size() >= 5) {
+        ellipse(hullMat, fitEllipse(hull[0]), greenColor, -lineWidth, lineType);
+    }
+
+    // Second test: sanity check the head.
+    return headOK(mTop, hullMat, found);
+}
+
+/**
+ * Isolate the skin points on a discovered face in one pass. Model the skin
+ * colour of the central rectangle of the face in the chroma (Cr, Cb) plane,
+ * which is little affected by lighting, and keep the skin coloured points
+ * connected to the cross through the central rectangle.
+ * @param ycrcb An image in YCrCb.
+ * @param aFace A discovered face on the image.
+ * @param facePoints The skin colored face points discovered.
+ */
+void ScanEngine::skinSearch(const Mat& ycrcb, Rect aFace, vector<Point>& facePoints) {
+    Rect central = Rect(aFace.x + aFace.width/3, aFace.y + aFace.height/4,
+                        aFace.width/3, aFace.height/2);
+
+    // The same cross of seeds as faceSearch().
+    vector<Point> seeds;
+    for (wxInt32 y = aFace.y + aFace.height/4; y < aFace.y + aFace.height*3/4; y=y+2) {
+        seeds.push_back(Point(aFace.x + aFace.width/2, y));
+    }
+    for (wxInt32 x = aFace.x + aFace.width/3; x < aFace.x + aFace.width*2/3; x=x+2) {
+        seeds.push_back(Point(x, aFace.y + aFace.height/2));
+    }
+    modelSearch(ycrcb, central, seeds, false, SKINDISTANCE, facePoints);
+}
+
+/**
+ * Search for hair points in one pass. Model the colour, including brightness,
+ * of a band just above the top center of the face, and keep the points of
+ * that colour connected to the band.
+ * @param ycrcb An image in YCrCb.
+ * @param newFace A face expanded by a face search.
+ * @param facePoints The skin and hair points discovered.
+ */
+void ScanEngine::hairModelSearch(const Mat& ycrcb, Rect newFace, vector<Point>& facePoints) {
+    wxInt32 top = max(0, newFace.y - newFace.height/10);
+    Rect band = Rect(newFace.x + newFace.width*4/10, top,
+                     newFace.width/5, newFace.y - top);
+
+    // The same seeds as hairSearch() on and above the face top line.
+    vector<Point> seeds;
+    for (wxInt32 x = band.x; x < band.x + band.width; x = x + 4) {
+        seeds.push_back(Point(x, newFace.y));
+    }
+    for (wxInt32 y = newFace.y; y > top; y = y - 2) {
+        seeds.push_back(Point(newFace.x + newFace.width/2, y));
+    }
+    modelSearch(ycrcb, band, seeds, true, HAIRDISTANCE, facePoints);
+}
+
+/**
+ * Find the points of an image whose colour matches a sample, and that are
+ * connected to seed points. The sample's colours are modelled as a Gaussian.
+ * The likelihood of every point is computed at once, as whole-image operations.
+ * @param ycrcb An image in YCrCb.
+ * @param sample The region whose colours define the model.
+ * @param seeds Start points for region growing.
+ * @param useLuma true to model Y, Cr and Cb, false for Cr and Cb only.
+ * @param maxDistance The largest squared Mahalanobis distance that matches.
+ * @param points The matching connected points are appended here.
+ */
+void ScanEngine::modelSearch(const Mat& ycrcb, Rect sample, const vector<Point>& seeds,
+        bool useLuma, double maxDistance, vector<Point>& points) {
+    sample = sample & Rect(0, 0, ycrcb.cols, ycrcb.rows);
+    if (sample.width < 2 || sample.height < 2) {
+        return; // Too few samples for a model.
+    }
+
+    // Estimate the sample's mean colour and covariance. Regularize so that a
+    // flat sample still gives an invertible covariance.
+    wxInt32 firstChannel = useLuma ? 0 : 1;
+    wxInt32 k = 3 - firstChannel;
+    Mat pixels;
+    Mat(ycrcb, sample).clone().reshape(1, sample.area()).convertTo(pixels, CV_64F);
+    Mat samples = pixels.colRange(firstChannel, 3).clone();
+    Mat covar, mean;
+    calcCovarMatrix(samples, covar, mean, CV_COVAR_NORMAL | CV_COVAR_ROWS | CV_COVAR_SCALE);
+    covar = covar + Mat::eye(k, k, CV_64F) * MODELREGULARIZE;
+    Mat icovar = covar.inv(DECOMP_SVD);
+
+    // Squared Mahalanobis distance of every point from the mean colour.
+    vector<Mat> planes;
+    split(ycrcb, planes);
+    vector<Mat> diffs(k);
+    for (wxInt32 i = 0; i < k; i++) {
+        planes[firstChannel + i].convertTo(diffs[i], CV_32F, 1.0, -mean.at<double>(0, i));
+    }
+    Mat distance = Mat::zeros(ycrcb.size(), CV_32F);
+    for (wxInt32 i = 0; i < k; i++) {
+        for (wxInt32 j = 0; j < k; j++) {
+            distance = distance + diffs[i].mul(diffs[j]) * icovar.at<double>(i, j);
+        }
+    }
+    Mat likely = distance < maxDistance;
+
+    // Grow regions of likely points from the seeds.
+    Mat imgMask = Mat::zeros(ycrcb.rows+2, ycrcb.cols+2, CV_8UC1);
+    Mat imgSMask(imgMask, Rect(1, 1, ycrcb.cols, ycrcb.rows));
+    Rect bounds = Rect(0, 0, ycrcb.cols, ycrcb.rows);
+    for (size_t i = 0; i < seeds.size(); i++) {
+        Point seed = seeds[i];
+        if (bounds.contains(seed) && likely.at<unsigned char>(seed) != 0 &&
+                imgSMask.at<unsigned char>(seed) == 0) {
+            floodFill(likely, imgMask, seed, Scalar(1), 0, Scalar(0), Scalar(0),
+                    FLOODFILL_MASK_ONLY + (1 << 8) + 8);
+        }
+    }
+
+    // Get the points from the mask to points.
+    for (wxInt32 c = 0; c < ycrcb.cols; c++) {
+        for (wxInt32 r = 0; r < ycrcb.rows; r++) {
+            if (imgSMask.at<unsigned char>(r, c) == 1) {
+                points.push_back(Point(c, r));
+            }
+        }
+    }
+}
+
+/**
+ * Find a contiguous region in an image with similar colors.
+ * @param img The image.
+ * @param imgMask Returned cumulative mask indicating points matching color of interest.
+ * @param seed A starting point for the region with the color of interest.
+ * @param dl The delta to define similar colors.
+ */
+void ScanEngine::findColorRegion(Mat& img, Mat& imgMask, Point seed, wxInt32 dl) {
+    findColorRegion(img, imgMask, seed, dl, dl, dl);
+}
+
+/**
+ * Find a contiguous region in an image with similar colors.
+ * @param img The image.
+ * @param imgMask Returned cumulative points matching color of interest.
+ * @param seed A starting point for the region with the color of interest.
+ * @param dl1 The delta to define similar colors, subscript 1.
+ * @param dl2 The delta to define similar colors, subscript 2.
+ * @param dl3 The delta to define similar colors, subscript 3.
+ */
+void ScanEngine::findColorRegion(Mat& img, Mat& imgMask, Point seed,
+                                   wxInt32 dl1, wxInt32 dl2, wxInt32 dl3) {
+    Scalar loDiff = Scalar(dl1, dl2, dl3);
+    Scalar upDiff = Scalar(dl1, dl2, dl3);
+
+    // Find the region. Set the mask to 1 wherever there is a similar color.
+    Rect region;
+    Mat newMask = Mat::zeros(imgMask.rows, imgMask.cols, CV_8UC1);
+    floodFill(img, newMask, seed, Scalar(1), &region, loDiff, upDiff,
+            FLOODFILL_FIXED_RANGE + FLOODFILL_MASK_ONLY + 8);
+
+    // Copy discoveries from newMask to imgMask.
+    for (wxInt32 r = 0; r < imgMask.rows; r++) {
+        PixelKernels::markEqual(imgMask.ptr(r), newMask.ptr(r), imgMask.cols, 1);
+    }
+}
+
+/**
+ * Sanity check the discovered head. If it consumes the entire width or
+ * length of the image of if its ellipse extends more than a little over the
+ * image top, or it extends over both left and right image bounds, or it
+ * covers a significant fraction of the left or right edge, assume the
+ * face/hair search failed.
+ * Typically failures occur because background colors are too similar to face
+ * or hair colors or because other people are in the image.
+ * @param headMat The portion of the image where the head was discovered.
+ * @param hullMat A scratch pad where an ellipse surrounding the head was drawn.
+ * @param headRect The rectangle around the discovered head.
+ * @return true if the head is a reasonable size, else false.
+ */
+bool ScanEngine::headOK(Mat headMat, Mat hullMat, Rect headRect) {
+    // Check the head dimensions against the image dimensions.  If the head
+    // is as large as the image width or height then assume a failed search.
+    if (headRect.width == headMat.cols || headRect.height == headMat.rows) {
+        return false;
+    }
+
+    // Sanity check the ellipse around the head.
+    bool overTopEdge = false;
+    bool overLeftEdge = false;
+    bool overRightEdge = false;
+    wxInt32 lCount = 0; // ellipse pixels on left edge.
+    wxInt32 rCount = 0; // ellipse pixels on right edge.
+    wxInt32 tMax = 0.10 * headMat.cols; // max pixels allowed on top edge.
+    wxInt32 lrMax = 0.5 * headMat.rows; // max pixels allowed on left/right edge.
+
+    // Check top edge. A little (tMax) over the top edge is OK.
+    if (PixelKernels::countSet(hullMat.ptr(0), headMat.cols) > tMax + 1) {
+        overTopEdge = true;
+    }
+
+    if ( ! overTopEdge) {
+        // Check left and right edges.
+        for (wxInt32 r = 0; r < headMat.rows; r++) {
+            if (hullMat.at<Vec3b>(r, 0) != Vec<unsigned char,3>(0,0,0)) {
+                overLeftEdge = true;
+                if (lCount++ > lrMax) break;
+            }
+        }
+        for (wxInt32 r = 0; r < headMat.rows; r++) {
+            if (hullMat.at<Vec3b>(r, headMat.cols-1) != Vec<unsigned char,3>(0,0,0)) {
+                overRightEdge = true;
+                if (rCount++ > lrMax) break;
+            }
+        }
+    }
+
+    if (overTopEdge || (overLeftEdge && overRightEdge) ||
+            lCount > lrMax || rCount > lrMax) {
+        // A good head has not been found.
+        return false;
+    }
+    return true;
+}
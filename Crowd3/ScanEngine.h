@@ -0,0 +1,346 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef SCANENGINE_H
+#define	SCANENGINE_H
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/imgproc/imgproc_c.h>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/objdetect/objdetect.hpp>
+#include <wx/thread.h>
+#include "CoreTools.h"
+#include "FaceDetector.h"
+#include "BoundedQueue.h"
+#include "IDAllocator.h"
+#include "ImagePlanes.h"
+#include "JpegHeader.h"
+#include "ImageDecoder.h"
+#include <string>
+#include <vector>
+using namespace cv;
+using namespace std;
+
+// Face constants (empirical):
+/** A face must be at least this fraction of the smaller photo dimension.
+ *   This helps filter out detection errors. */
+const double FACEPERCENT = 0.08;
+
+/** A face of FACEPERCENT size must be at least this many pixels wide to be
+ * found and to give a usable person image. Smaller photos are not decoded. */
+const double MINFACEWIDTH = 16.0;
+
+/** Enlarge the detected face width by this factor to encompass the entire head. */
+const double HEADWIDTH = 1.02;
+
+/** Enlarge the detected face height by this factor to encompass the entire head. */
+const double HEADHEIGHT = 1.9;
+
+/** Enlarge the enlarged face by this factor to estimate the upper body width. */
+const double BODYWIDTH = 2.1 / HEADWIDTH;
+
+/** Enlarge the enlarged face by this factor to estimate the upper body height. */
+const double BODYHEIGHT = 2.1 / HEADHEIGHT;
+
+/** Scale detected head images to this size. */
+const double SCALEDFACEWIDTH = 200.0;
+
+/** Person images will be this many pixels wide. */
+const double PERSONWIDTH = HEADWIDTH * BODYWIDTH * SCALEDFACEWIDTH;
+
+/** Person images will be this many pixels high. */
+const double FULLPERSONHEIGHT =
+            SCALEDFACEWIDTH * (HEADHEIGHT + (HEADHEIGHT * BODYHEIGHT));
+
+/** Persons displayed in a crowd will have reduced person height. */
+const double PERSONHEIGHT = 0.75 * FULLPERSONHEIGHT;
+
+// Colour model constants:
+/** A point is skin coloured if its squared Mahalanobis distance from the face's
+ * mean chroma is below this (99% of a 2-D Gaussian). */
+const double SKINDISTANCE = 9.21;
+
+/** A point is hair coloured if its squared Mahalanobis distance from the hair
+ * sample's mean colour is below this (99% of a 3-D Gaussian). */
+const double HAIRDISTANCE = 11.34;
+
+/** Added to the variances of a colour model so that flat samples still work. */
+const double MODELREGULARIZE = 4.0;
+
+// Pipeline constants:
+/** Each queue between search stages holds at most this many source images. */
+const wxInt32 PIPELINEDEPTH = 2;
+
+/** The engine waits at most this many milliseconds for the search stages
+ * before reporting progress to its listener. */
+const wxInt32 PIPELINEWAIT = 100;
+
+/** Recorded in the image database as the detector of source image files that
+ * were rejected from their header, so they are not read again. */
+const string SKIPPEDDETECTOR = "Skipped";
+
+/** Photos not stored upright give the face detector an upright colour copy
+ * this many pixels on its longer side, rather than being turned whole. */
+const wxInt32 PREVIEWSIDE = 640;
+
+// Pre-screen constants:
+/** The pre-screen enlarges thumbnails so that a face of FACEPERCENT size is
+ * at least this many pixels wide, about the detector's smallest face. */
+const double PRESCREENFACEWIDTH = 24.0;
+
+/** One in this many photos rejected by the pre-screen is searched anyway, to
+ * measure how many people the pre-screen misses. */
+const wxInt32 PRESCREENAUDIT = 10;
+
+/** Appended to the detector name recorded for photos rejected by the pre-screen. */
+const string PRESCREENTAG = " pre-screen";
+
+/** A source image file passing through the search stages. */
+struct ScanJob {
+    /** The source image pathname. */
+    string path;
+    
+    /** The decoder for the source image file's format, or NULL if unknown. */
+    const ImageDecoder *decoder;
+    
+    /** The source image file header, read before decoding. Empty unless the
+     * file is a JPEG. */
+    JpegHeader header;
+    
+    /** true if the file was rejected from its header and never decoded. */
+    bool skipped;
+    
+    /** true if the pre-screen found no face and the file was never decoded. */
+    bool rejected;
+    
+    /** true if the pre-screen found no face but the file is searched anyway
+     * to check the pre-screen. */
+    bool audited;
+    
+    /** The decoded source image and its derived planes. Released after the
+     * people are cut out. */
+    ImagePlanes planes;
+    
+    /** The detected faces. */
+    vector<Rect> faces;
+    
+    /** The people images, one per face. Released after they are written. */
+    vector<Mat> people;
+    
+    /** The number of faces not yet masked. Guarded by the masking lock. */
+    wxInt32 facesLeft;
+    
+    /** The image ID of the first person. The others follow in order. */
+    wxInt32 firstID;
+    
+    /** false if the source image file could not be read. */
+    bool readOK;
+    
+    /** Why image IDs could not be reserved, or empty. */
+    string error;
+};
+
+/** One face of a source image waiting to be masked. */
+struct FaceTask {
+    /** The source image. */
+    ScanJob *job;
+    
+    /** The face's index in job->faces and job->people. */
+    size_t index;
+};
+
+/** What the search found in one source image file. */
+struct ScanResult {
+    /** The source image pathname. */
+    string path;
+    
+    /** false if the file could not be read. */
+    bool readOK;
+    
+    /** true if the file was rejected from its header and never decoded. A
+     * record is still written so that it is not read again. */
+    bool skipped;
+    
+    /** The image ID of the first person image, or -1 if no people were found. */
+    wxInt32 firstID;
+    
+    /** The image ID of the last person image, or -1 if no people were found. */
+    wxInt32 lastID;
+    
+    /** The face detector to record, marked if the file was skipped or
+     * rejected by the pre-screen. */
+    string detector;
+    
+    /** Why image IDs could not be reserved, or empty. No record should be
+     * written, so that the file is searched again next time. */
+    string error;
+};
+
+/**
+ * Receives the results and progress of a ScanEngine search. All calls are made
+ * on the thread that calls the engine, never on the stage threads.
+ */
+class ScanListener {
+public:
+    virtual ~ScanListener() {}
+    
+    /**
+     * A source image file has been searched and its people images written.
+     * @param result What was found.
+     */
+    virtual void scanned(const ScanResult& result) = 0;
+    
+    /**
+     * Called about every PIPELINEWAIT milliseconds while the engine waits
+     * for its stages, and after each call to poll().
+     * @return false to stop the search.
+     */
+    virtual bool progress() = 0;
+};
+
+/**
+ * Search source image files for people and write each person to a people
+ * image file named with a unique image ID. Plain C++ types only; results and
+ * progress are handed to a ScanListener, so the engine runs the same under
+ * the GUI or without one.<p>
+ * Faces are found with opencv face detection. Then the face portion is
+ * enlarged (by skin and hair color searches) to try to include the face's
+ * entire head and upper body.<p>
+ * Files are searched by a pipeline of threads so that disk and processor work
+ * overlap: decode, then face detection, then person masking (one thread per
+ * processor, with the faces of one photo masked in parallel), then PNG
+ * encoding. Bounded queues between the stages keep a fast stage from running
+ * ahead. Results are handed to the listener on the calling thread.<p>
+ * Usage: <p><code>
+ * ScanEngine e;<p>
+ * e.start(detector, NULL, peopleFolder, &listener);<p>
+ * for each file: if ( ! e.submit(path)) break;<p>
+ * e.finish(true);<p></code>
+ */
+class ScanEngine {
+    public:
+        ScanEngine();
+        virtual ~ScanEngine();
+        void start(FaceDetector *detector, FaceDetector *prescreenDetector,
+                   const string& peopleFolder, ScanListener *listener);
+        bool submit(const string& path);
+        bool poll();
+        void finish(bool completed);
+        wxInt32 getAuditCount();
+        double getPrescreenRecall();
+
+    private:
+        void deliver(ScanJob *job);
+        void decodeStage();
+        bool prescreen(ScanJob *job);
+        void detectStage();
+        void maskStage();
+        void faceDone(ScanJob *job);
+        void encodeStage();
+        Mat makePerson(ImagePlanes& planes, Rect aFaceRect);
+        vector<Rect> findFaces(ImagePlanes& planes);
+        void maskHead(Mat& m, Rect aHead, Rect aFace);
+        void faceSearch(Mat& m, Rect aFace, vector<Point>& facePoints, wxInt32 sensitivity);
+        void hairSearch(Mat& m, Rect oldFace, Rect newFace, vector<Point>& facePoints, wxInt32 sensitivity);
+        bool headOK(Mat headMat, Mat hullMat, Rect headRect);
+        bool acceptRegion(Mat& mTop, vector<Point>& points, Mat& hullMat,
+                vector<vector<Point> >& hull, double refWidth, double maxGrowth, Rect& found);
+        void skinSearch(const Mat& ycrcb, Rect aFace, vector<Point>& facePoints);
+        void hairModelSearch(const Mat& ycrcb, Rect newFace, vector<Point>& facePoints);
+        void modelSearch(const Mat& ycrcb, Rect sample, const vector<Point>& seeds,
+                bool useLuma, double maxDistance, vector<Point>& points);
+        void findColorRegion(Mat& m, Mat& mask, Point seed, wxInt32 dl);
+        void findColorRegion(Mat& m, Mat& mask, Point seed, wxInt32 dl1,wxInt32 dl2,wxInt32 dl3);
+
+        /** Hands out the IDs for person images, also the filenames of the
+         * person image files. Used by the detection stage. */
+        IDAllocator myImageIDs;
+
+        /** Receives the results and progress of the current search. */
+        ScanListener *myListener;
+
+        /** The name of the face detector used for the current search. */
+        string myDetectorName;
+
+        /** The folder people images are written to, with a trailing separator. */
+        string myPeopleFolder;
+
+        /** Source images waiting to be decoded. */
+        BoundedQueue<ScanJob*> *myDecodeQueue;
+
+        /** Decoded source images waiting for face detection. */
+        BoundedQueue<ScanJob*> *myDetectQueue;
+
+        /** Faces waiting to have their people cut out. */
+        BoundedQueue<FaceTask> *myMaskQueue;
+
+        /** People images waiting to be written. */
+        BoundedQueue<ScanJob*> *myEncodeQueue;
+
+        /** Finished source images waiting to be handed to the listener. */
+        BoundedQueue<ScanJob*> *myDoneQueue;
+
+        /** The search stage threads. */
+        vector<wxThread*> myStages;
+
+        /** The number of masking stage threads still running. */
+        wxInt32 myMaskersRunning;
+
+        /** Guards myMaskersRunning and ScanJob::facesLeft. */
+        wxMutex myMaskersLock;
+
+        /** Set to stop the search stages early. */
+        volatile bool myCancelled;
+
+        /** The face detector used for the current search. Not owned. */
+        FaceDetector *myDetector;
+
+        /** A second detector of the same kind for the pre-screen, used by the
+         * decoding stage, or NULL for no pre-screen. Not owned. */
+        FaceDetector *myPrescreenDetector;
+
+        /** Guards the pre-screen counts below, which the decoding stage and
+         * the caller's thread both use. */
+        wxMutex myCountsLock;
+
+        /** The number of photos the pre-screen found no face in. Counted by
+         * the decoding stage. */
+        wxInt32 myRejectCount;
+
+        /** The number of photos the pre-screen passed that had people. */
+        wxInt32 myPassedCount;
+
+        /** The number of rejected photos searched anyway. */
+        wxInt32 myAuditCount;
+
+        /** The number of those that had people. */
+        wxInt32 myMissedCount;
+};
+
+#endif	/* SCANENGINE_H */
@@ -278,4 +278,163 @@ void Settings::setImageID(wxInt32 i) {
  */
 wxInt32 Settings::getImageID() {
     return myConfig->Read(_T("UID"), 0l);
+}
+
+/**
+ * Save the JPEG quality used when saving crowd images.
+ * @param quality The JPEG quality, 0 to 100.
+ */
+void Settings::setJpegQuality(wxInt32 quality) {
+    myConfig->Write(_T("jpegQ"), quality);
+    myConfig->Flush();
+}
+
+/**
+ * Get the JPEG quality used when saving crowd images or default.
+ * @return The JPEG quality, 0 to 100.
+ */
+wxInt32 Settings::getJpegQuality() {
+    return myConfig->Read(_T("jpegQ"), 95l);
+}
+
+/**
+ * Save the progressive JPEG setting.
+ * @param value true to save crowd images as progressive JPEGs.
+ */
+void Settings::setJpegProgressive(bool value) {
+    myConfig->Write(_T("jpegProg"), value);
+    myConfig->Flush();
+}
+
+/**
+ * Get the progressive JPEG setting.
+ * @return true to save crowd images as progressive JPEGs.
+ */
+bool Settings::getJpegProgressive() {
+    bool val = false; // default return value.
+    myConfig->Read(_T("jpegProg"), &val);
+    return val;
+}
+
+/**
+ * Save the JPEG restart interval.
+ * @param mcuRows The restart interval in MCU rows, or 0 for none.
+ */
+void Settings::setJpegRestartInterval(wxInt32 mcuRows) {
+    myConfig->Write(_T("jpegRst"), mcuRows);
+    myConfig->Flush();
+}
+
+/**
+ * Get the JPEG restart interval or default.
+ * @return The restart interval in MCU rows, or 0 for none.
+ */
+wxInt32 Settings::getJpegRestartInterval() {
+    return myConfig->Read(_T("jpegRst"), 0l);
+}
+
+/**
+ * Save the PNG compression level used when saving crowd images.
+ * @param level The zlib compression level, 0 to 9.
+ */
+void Settings::setPngCompression(wxInt32 level) {
+    myConfig->Write(_T("pngZ"), level);
+    myConfig->Flush();
+}
+
+/**
+ * Get the PNG compression level used when saving crowd images or default.
+ * @return The zlib compression level, 0 to 9.
+ */
+wxInt32 Settings::getPngCompression() {
+    return myConfig->Read(_T("pngZ"), 3l);
+}
+
+/**
+ * Save the face detector used for the most recent people search.
+ * @param name The face detector name.
+ */
+void Settings::setFaceDetector(wxString name) {
+    myConfig->Write(_T("faceDet"), name);
+    myConfig->Flush();
+}
+
+/**
+ * Get the face detector used for the most recent people search or default.
+ * @return The face detector name.
+ */
+wxString Settings::getFaceDetector() {
+    return myConfig->Read(_T("faceDet"), _T("Haar")); // DETECTOR_HAAR
+}
+
+/**
+ * Save the thumbnail pre-screen setting.
+ * @param value true to search only photos whose thumbnail shows a face.
+ */
+void Settings::setThumbnailPrescreen(bool value) {
+    myConfig->Write(_T("thumbScr"), value);
+    myConfig->Flush();
+}
+
+/**
+ * Get the thumbnail pre-screen setting.
+ * @return true to search only photos whose thumbnail shows a face.
+ */
+bool Settings::getThumbnailPrescreen() {
+    bool val = false; // default return value.
+    myConfig->Read(_T("thumbScr"), &val);
+    return val;
+}
+
+/**
+ * Save the compositor that paints crowd images.
+ * @param name The compositor name.
+ */
+void Settings::setCompositor(wxString name) {
+    myConfig->Write(_T("compositor"), name);
+    myConfig->Flush();
+}
+
+/**
+ * Get the compositor that paints crowd images or default.
+ * @return The compositor name.
+ */
+wxString Settings::getCompositor() {
+    return myConfig->Read(_T("compositor"), _T("OpenCV")); // COMPOSITOR_OPENCV
+}
+
+/**
+ * Save the layered rows setting.
+ * @param value true to paint each crowd row into its own cached layer.
+ */
+void Settings::setLayeredRows(bool value) {
+    myConfig->Write(_T("layered"), value);
+    myConfig->Flush();
+}
+
+/**
+ * Get the layered rows setting or default.
+ * @return true to paint each crowd row into its own cached layer.
+ */
+bool Settings::getLayeredRows() {
+    bool val = false; // default return value.
+    myConfig->Read(_T("layered"), &val);
+    return val;
+}
+
+/**
+ * Save the memory budget of the cached crowd row layers.
+ * @param megabytes The budget in megabytes.
+ */
+void Settings::setLayerBudget(wxInt32 megabytes) {
+    myConfig->Write(_T("layerMB"), megabytes);
+    myConfig->Flush();
+}
+
+/**
+ * Get the memory budget of the cached crowd row layers or default.
+ * @return The budget in megabytes.
+ */
+wxInt32 Settings::getLayerBudget() {
+    return myConfig->Read(_T("layerMB"), 256l);
 }
\ No newline at end of file
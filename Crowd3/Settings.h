@@ -77,6 +77,27 @@ public:
     static void setImageID(wxInt32 i);
     static wxInt32 getImageID();
     
+    static void setJpegQuality(wxInt32 quality);
+    static wxInt32 getJpegQuality();
+    static void setJpegProgressive(bool value);
+    static bool getJpegProgressive();
+    static void setJpegRestartInterval(wxInt32 mcuRows);
+    static wxInt32 getJpegRestartInterval();
+    static void setPngCompression(wxInt32 level);
+    static wxInt32 getPngCompression();
+    
+    static void setFaceDetector(wxString name);
+    static wxString getFaceDetector();
+    static void setThumbnailPrescreen(bool value);
+    static bool getThumbnailPrescreen();
+    
+    static void setCompositor(wxString name);
+    static wxString getCompositor();
+    static void setLayeredRows(bool value);
+    static bool getLayeredRows();
+    static void setLayerBudget(wxInt32 megabytes);
+    static wxInt32 getLayerBudget();
+    
 private:
 
 };
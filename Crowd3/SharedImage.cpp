@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "SharedImage.h"
+
+/** Create an empty image. isOk() is false. */
+SharedImage::SharedImage() {
+}
+
+/**
+ * Create a black image with a new buffer.
+ * @param width The image width.
+ * @param height The image height.
+ */
+SharedImage::SharedImage(wxInt32 width, wxInt32 height) {
+    myPixels = Mat::zeros(height, width, CV_8UC3);
+}
+
+/**
+ * Share a Mat's pixels. A region of a larger image is copied, as wx needs
+ * continuous rows.
+ * @param rgb The image, 8-bit RGB.
+ */
+SharedImage::SharedImage(const Mat& rgb) {
+    myPixels = rgb.isContinuous() ? rgb : rgb.clone();
+}
+
+/**
+ * Share a wxImage's pixels. The wxImage keeps owning them.
+ * @param anImage The image.
+ */
+SharedImage::SharedImage(const wxImage& anImage) {
+    if (anImage.IsOk()) {
+        myOwner = anImage;
+        myPixels = Mat(anImage.GetHeight(), anImage.GetWidth(), CV_8UC3,
+                       anImage.GetData());
+    }
+}
+
+/** @return true if the image has pixels, else false. */
+bool SharedImage::isOk() const {
+    return ! myPixels.empty();
+}
+
+/** @return The image width. */
+wxInt32 SharedImage::getWidth() const {
+    return myPixels.cols;
+}
+
+/** @return The image height. */
+wxInt32 SharedImage::getHeight() const {
+    return myPixels.rows;
+}
+
+/**
+ * @return A header over the pixels, 8-bit RGB. Writing through it changes
+ * every copy of this image.
+ */
+Mat SharedImage::mat() const {
+    return myPixels;
+}
+
+/**
+ * @return A wxImage over the pixels, or an image that is not ok if this one
+ * is not. It does not keep the pixels alive; this SharedImage must.
+ */
+wxImage SharedImage::wx() const {
+    if (myOwner.IsOk()) {
+        return myOwner;
+    }
+    if (myPixels.empty()) {
+        return wxImage();
+    }
+    return wxImage(myPixels.cols, myPixels.rows, myPixels.data, true);
+}
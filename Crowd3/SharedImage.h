@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef SHAREDIMAGE_H
+#define	SHAREDIMAGE_H
+
+#include <opencv2/core/core.hpp>
+#include <wx/wx.h>
+#include "const.h"
+using namespace cv;
+
+/**
+ * An 8-bit RGB image whose one pixel buffer is seen by both OpenCV and wx
+ * without copying. mat() is a Mat header over the buffer; wx() is a wxImage
+ * over the same bytes as static data, which wx never frees. Copies of a
+ * SharedImage share the buffer, which lives until the last copy is gone, so
+ * keep a SharedImage for as long as any wxImage from wx() is in use.<p>
+ * The buffer is owned by a Mat, or by a wxImage for images made by wx. Copy
+ * and destroy SharedImages made by wx on one thread only, as wxImage counts
+ * its references without locking.<p>
+ * Usage:<p><code>
+ * SharedImage crowd(width, height);<p>
+ * Mat pixels = crowd.mat(); pixels.setTo(...);<p>
+ * panel->setImage(crowd);<p></code>
+ */
+class SharedImage {
+public:
+    SharedImage();
+    SharedImage(wxInt32 width, wxInt32 height);
+    explicit SharedImage(const Mat& rgb);
+    explicit SharedImage(const wxImage& anImage);
+    bool isOk() const;
+    wxInt32 getWidth() const;
+    wxInt32 getHeight() const;
+    Mat mat() const;
+    wxImage wx() const;
+
+private:
+    /** The pixels, 8-bit RGB, rows continuous. Empty if not ok. */
+    Mat myPixels;
+
+    /** The image owning myPixels' buffer if wx made it, else not ok. */
+    wxImage myOwner;
+};
+
+#endif	/* SHAREDIMAGE_H */
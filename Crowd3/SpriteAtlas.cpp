@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "SpriteAtlas.h"
+
+/** Create an empty atlas. */
+SpriteAtlas::SpriteAtlas() {
+}
+
+/**
+ * Get the sprite of a person for a placement, making it on first use. The
+ * sprite's height is the placement's height rounded by spriteHeight(), and
+ * its width keeps the placement's proportions.
+ * @param aCompositor Reads and scales the person image.
+ * @param path The person image file path.
+ * @param at The person's placement on the canvas.
+ * @return The sprite, valid until clear(), or NULL if the person image could
+ * not be read or the placement has no pixels.
+ */
+const Mat* SpriteAtlas::sprite(Compositor& aCompositor, const wxString& path,
+                               const Placement& at) {
+    if (at.width <= 0 || at.height <= 0) {
+        return NULL;
+    }
+    wxInt32 height = spriteHeight(at.height);
+    std::pair<wxString, wxInt32> key(path, height);
+    std::map<std::pair<wxString, wxInt32>, Mat>::iterator found = mySprites.find(key);
+    if (found != mySprites.end()) {
+        return found->second.empty() ? NULL : &found->second;
+    }
+    
+    // Unreadable people are remembered as empty sprites, so they are tried once.
+    Placement scaled = at;
+    scaled.height = height;
+    scaled.width = max(1, (wxInt32) floor(at.width * height / (double) at.height + 0.5));
+    Mat aPerson;
+    Mat& aSprite = mySprites[key];
+    if ( ! aCompositor.scalePerson(path, scaled, true, aPerson) || aPerson.empty()) {
+        return NULL;
+    }
+    
+    // A copy, as the scaled person may share the compositor's mip. Alpha to
+    // 0 or 255 once, so painting only tests it.
+    aSprite = aPerson.clone();
+    Mat alpha(aSprite.size(), CV_8UC1);
+    wxInt32 alphaOnly[] = {3, 0};
+    mixChannels(&aSprite, 1, &alpha, 1, alphaOnly, 1);
+    Mat visible = alpha >= wxIMAGE_ALPHA_THRESHOLD;
+    wxInt32 toAlpha[] = {0, 3};
+    mixChannels(&visible, 1, &aSprite, 1, toAlpha, 1);
+    return &aSprite;
+}
+
+/** Drop every sprite. */
+void SpriteAtlas::clear() {
+    mySprites.clear();
+}
+
+/**
+ * Round a placement height to a sprite height. Small heights are kept; taller
+ * ones are rounded to SPRITESTEPS sizes per doubling, within about 4%.
+ * @param height The placement height, at least 1.
+ * @return The sprite height.
+ */
+wxInt32 SpriteAtlas::spriteHeight(wxInt32 height) {
+    if (height <= EXACTSPRITEHEIGHT) {
+        return height;
+    }
+    double step = floor(SPRITESTEPS * log((double) height) / log(2.0) + 0.5);
+    return (wxInt32) floor(pow(2.0, step / SPRITESTEPS) + 0.5);
+}
+
+/**
+ * Paint the visible pixels of a sprite onto a canvas, within a clip area.
+ * @param canvas The canvas, 8-bit RGB.
+ * @param clip The canvas area that may be painted. Must be within the canvas.
+ * @param aSprite The sprite, from sprite().
+ * @param at The canvas position of the sprite's top left pixel.
+ * @param mirror true to paint the sprite flipped left to right.
+ * @param tint Red, green and blue factors in 256ths: 256 keeps the colour.
+ */
+void SpriteAtlas::paint(Mat& canvas, Rect clip, const Mat& aSprite, Point at,
+                        bool mirror, const wxInt32 tint[3]) {
+    Rect onCanvas = Rect(at.x, at.y, aSprite.cols, aSprite.rows) & clip;
+    for (wxInt32 cy = onCanvas.y; cy < onCanvas.y + onCanvas.height; cy++) {
+        const unsigned char *sRow = aSprite.ptr<unsigned char>(cy - at.y);
+        unsigned char *cRow = canvas.ptr<unsigned char>(cy);
+        for (wxInt32 cx = onCanvas.x; cx < onCanvas.x + onCanvas.width; cx++) {
+            wxInt32 sx = mirror ? aSprite.cols - 1 - (cx - at.x) : cx - at.x;
+            const unsigned char *s = sRow + 4 * sx;
+            if (s[3] == 0) {
+                continue; // Transparent.
+            }
+            unsigned char *c = cRow + 3 * cx;
+            c[0] = min(255, (s[0] * tint[0]) >> 8);
+            c[1] = min(255, (s[1] * tint[1]) >> 8);
+            c[2] = min(255, (s[2] * tint[2]) >> 8);
+        }
+    }
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef SPRITEATLAS_H
+#define	SPRITEATLAS_H
+
+#include <opencv2/core/core.hpp>
+#include <wx/wx.h>
+#include "const.h"
+#include "Compositor.h"
+#include <map>
+using namespace cv;
+
+/** Sprites up to this height are made at the exact height asked for. */
+const wxInt32 EXACTSPRITEHEIGHT = 16;
+
+/** Taller sprite heights are rounded to this many steps per doubling. */
+const wxInt32 SPRITESTEPS = 8;
+
+/**
+ * Pre-shrunk person images for massive crowds, shared by every placement of
+ * the same person at about the same size. Sprite heights are rounded to a few
+ * sizes, so thousands of placements of one person need only a handful of
+ * scaled copies, and each person image file is read about once.<p>
+ * Sprites are 8-bit RGBA with alpha 0 or 255: the compositors' transparency
+ * threshold is applied once, when the sprite is made.<p>
+ * Usage:<p><code>
+ * SpriteAtlas atlas;<p>
+ * const Mat *s = atlas.sprite(compositor, path, placement);<p>
+ * SpriteAtlas::paint(canvas, clip, *s, at, mirror, tint);<p></code>
+ */
+class SpriteAtlas {
+public:
+    SpriteAtlas();
+    const Mat* sprite(Compositor& aCompositor, const wxString& path,
+                      const Placement& at);
+    void clear();
+    static wxInt32 spriteHeight(wxInt32 height);
+    static void paint(Mat& canvas, Rect clip, const Mat& aSprite, Point at,
+                      bool mirror, const wxInt32 tint[3]);
+
+private:
+    /** The sprites, by person image path and sprite height. */
+    std::map<std::pair<wxString, wxInt32>, Mat> mySprites;
+};
+
+#endif	/* SPRITEATLAS_H */
@@ -28,6 +28,8 @@
  */
 
 #include "Tools.h"
+#include "ImageDecoder.h"
+#include <wx/file.h>
 
 Tools::Tools() {}
 Tools::Tools(const Tools& orig) {}
@@ -122,6 +124,22 @@ wxString Tools::dataFolder() {
     return wxStandardPathsBase::Get().GetDataDir();
 }
 
+/**
+ * Get a file dialog wildcard that shows the files of all known image formats.
+ * @return The wildcard.
+ */
+wxString Tools::imageFileFilter() {
+    vector<string> all = ImageDecoder::extensions();
+    wxString patterns = _T("");
+    for (size_t i = 0; i < all.size(); i++) {
+        // Both cases, as Linux filenames are case sensitive.
+        wxString extension = str2wx(all[i]);
+        patterns = patterns + (i == 0 ? _T("") : _T(";")) +
+                _T("*.") + extension + _T(";*.") + extension.Upper();
+    }
+    return _T("Image files|") + patterns;
+}
+
 /**
  * Convert Mat to wxImage.
  * Based on http://forums.wxwidgets.org/viewtopic.php?f=1&t=28986
@@ -138,9 +156,9 @@ void Tools::Mat2WxImage(Mat *cvImg, wxImage& wxImg) {
   wxImg = wxImage(w, h);
   uchar* wxData = wxImg.GetData();
 
-  // Create a Mat using the data of the wxImage. 
+  // Create a Mat header over the data of the wxImage. 
   // wxImg and cvwxImg share data. Mat will never deallocate wxData.
-  Mat *cvwxImg = new Mat(h, w, CV_8UC3, wxData);
+  Mat cvwxImg(h, w, CV_8UC3, wxData);
 
   // Convert Mat's BGR to wxImage's RGB.
   switch (cvImg->channels()) {
@@ -148,11 +166,11 @@ void Tools::Mat2WxImage(Mat *cvImg, wxImage& wxImg) {
         // 1-channel case: expand and copy.
         // Convert type if source is not an integer matrix.
         if (cvImg->depth() != CV_8U) {
-            cvtColor(convertType(*cvImg, CV_8U, 1.0, 0.0), *cvwxImg, CV_GRAY2RGB);
+            cvtColor(convertType(*cvImg, CV_8U, 1.0, 0.0), cvwxImg, CV_GRAY2RGB);
         }
         else {
             // Convert grayscale to color.
-            cvtColor(*cvImg, *cvwxImg, CV_GRAY2RGB);
+            cvtColor(*cvImg, cvwxImg, CV_GRAY2RGB);
         }
         break;
     
@@ -160,7 +178,7 @@ void Tools::Mat2WxImage(Mat *cvImg, wxImage& wxImg) {
         // 3-channel case: Copy input image (cvImg) to output image (cvwxImg aka
         // wxImg) while swapping R&B channels. BGR to RGB.
         wxInt32 mapping[] = {0,2,1,1,2,0}; // Copy channel 0 to 2, 1 to 1, 2 to 0.
-        mixChannels(cvImg, 1, cvwxImg, 1, mapping, 3);
+        mixChannels(cvImg, 1, &cvwxImg, 1, mapping, 3);
         break;
     }
     
@@ -207,6 +225,33 @@ Mat Tools::rgb2gray(const Mat& rgbImg) {
     return grayImg;
 }
 
+/**
+ * Read the width and height of a PNG file from its IHDR chunk without decoding
+ * the image.
+ * @param path The PNG file path.
+ * @param width The returned image width.
+ * @param height The returned image height.
+ * @return true if the file is a readable PNG file, else false.
+ */
+bool Tools::pngSize(wxString path, wxInt32& width, wxInt32& height) {
+    // An 8 byte signature, then the IHDR chunk: 4 byte length, 4 byte type,
+    // 4 byte big-endian width, 4 byte big-endian height.
+    const unsigned char signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    unsigned char header[24];
+    wxFile f;
+    if ( ! wxFile::Exists(path) || ! f.Open(path) ||
+            f.Read(header, sizeof(header)) != sizeof(header)) {
+        return false;
+    }
+    if (memcmp(header, signature, sizeof(signature)) != 0 ||
+            memcmp(header + 12, "IHDR", 4) != 0) {
+        return false;
+    }
+    width  = (header[16] << 24) | (header[17] << 16) | (header[18] << 8) | header[19];
+    height = (header[20] << 24) | (header[21] << 16) | (header[22] << 8) | header[23];
+    return true;
+}
+
 /**
  * Show an error message in a popup window and write it to the application log.
  * @param msg the error message.
@@ -215,6 +260,15 @@ void Tools::log(wxString msg) {
     wxLogError(msg + _T(".\nThis error was written to the program log file.\n"));
 }
 
+/**
+ * Show an error message of the core engines in a popup window and write it to
+ * the application log. The core's error handler.
+ * @param msg the error message.
+ */
+void Tools::logCore(const string& msg) {
+    log(str2wx(msg));
+}
+
 /**
  * Show an error message in a popup window and write it to the application log. 
  * Terminate the program.
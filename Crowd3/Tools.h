@@ -54,15 +54,18 @@ public:
     static void Wx2MatImage(const wxImage& wx, Mat& cv);
     static Mat convertType(const Mat& src, wxInt32 type, double alpha, double beta);
     static Mat rgb2gray(const Mat& rgb);
+    static bool pngSize(wxString path, wxInt32& width, wxInt32& height);
     
     // Logging
     static void log(wxString msg);
+    static void logCore(const string& msg);
     static void logFatal(wxString msg);
     
     // File System
     static wxString userFolder();
     static wxString dataFolder();
     static wxString crowd3Folder();
+    static wxString imageFileFilter();
     
 private:
 
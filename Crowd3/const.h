@@ -34,6 +34,7 @@
 #include <wx/filename.h>
 #include <wx/stdpaths.h>
 #include <opencv2/imgproc/imgproc.hpp>
+#include "CoreTools.h"
 
 // Program constants:
 
@@ -57,11 +58,7 @@
     /** Background color used on control panels. */
     const wxColour WX_COLOR_BACKGROUND = wxColour(200, 227, 255);
 
-    /** A (hopefully) rare (almost black) color used to mark transparent areas 
-     * on an image. For use with OpenCV. */
-    const cv::Vec<unsigned char, 3> CV_COLOR_TRANSPARENT = cv::Vec<unsigned char, 3>(1, 1, 1);
-    
-    /** Another definition of COLOR_TRANSPARENT. For use with wxWidgets. */
+    /** Another definition of CV_COLOR_TRANSPARENT (CoreTools.h). For use with wxWidgets. */
     const wxInt32 WX_COLOR_TRANSPARENT[] = {1, 1, 1};
     
 // Operating system constants:
@@ -74,10 +71,6 @@
     
     /** The Crowd3 database name. */
     const wxString DATABASE = _T("crowd3.sqlite");
-
-    /** The filename of the face detection cascade. */
-    const wxString FACECASCADENAME = _T("crowd3.xml"); 
-    // A copy of "/usr/share/opencv/haarcascades/haarcascade_frontalface_alt.xml";
             
 #endif	/* CONST_H */
 
@@ -52,10 +52,15 @@ bool MyApp::OnInit() {
         Tools::logFatal(_T("The Crowd3 folder could not be created."));
     }
     
+    // Show errors of the core engines like other errors.
+    CoreTools::setErrorHandler(Tools::logCore);
+    
     // Open image database. Close it in onExit().
-    if ( ! ImageDB::open()) {
+    if ( ! ImageDB::open(Tools::wx2str(Tools::crowd3Folder() + SEPARATOR + DATABASE),
+                         Settings::getImageID())) {
         Tools::logFatal(_T("The image database could not be opened."));
     }
+    ImageTree::fix1(); // Apply bug fix to database.
     
     // Create and show the application window.
     AppFrame *app = new AppFrame(PROGRAM_NAME + _T(" ") + PROGRAM_VERSION);
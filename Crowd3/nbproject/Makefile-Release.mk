@@ -47,7 +47,32 @@ OBJECTFILES= \
 	${OBJECTDIR}/ImageTree.o \
 	${OBJECTDIR}/PeopleFinder.o \
 	${OBJECTDIR}/AppFrame.o \
-	${OBJECTDIR}/Icon.o
+	${OBJECTDIR}/Icon.o \
+	${OBJECTDIR}/CrowdRenderer.o \
+	${OBJECTDIR}/CrowdExporter.o \
+	${OBJECTDIR}/FaceDetector.o \
+	${OBJECTDIR}/IDAllocator.o \
+	${OBJECTDIR}/ImagePlanes.o \
+	${OBJECTDIR}/JpegHeader.o \
+	${OBJECTDIR}/ImageDecoder.o \
+	${OBJECTDIR}/CoreTools.o \
+	${OBJECTDIR}/ScanEngine.o \
+	${OBJECTDIR}/Compositor.o \
+	${OBJECTDIR}/SharedImage.o \
+	${OBJECTDIR}/LayerCache.o \
+	${OBJECTDIR}/SpriteAtlas.o \
+	${OBJECTDIR}/ImageBands.o \
+	${OBJECTDIR}/ResampleKernel.o \
+	${OBJECTDIR}/PixelKernels.o
+
+# Test Directory
+TESTDIR=${CND_BUILDDIR}/${CND_CONF}/${CND_PLATFORM}/tests
+
+# Test Files
+TESTFILES= \
+	${TESTDIR}/TestFiles/PixelKernelsTest \
+	${TESTDIR}/TestFiles/CrowdBenchmark \
+	${TESTDIR}/TestFiles/ReviseTest
 
 
 # C Compiler Flags
@@ -64,7 +89,7 @@ FFLAGS=
 ASFLAGS=
 
 # Link Libraries and Options
-LDLIBSOPTIONS=-L/usr/lib/gtk-2.0/2.10.0 `pkg-config --libs opencv` `wx-config --libs --cxxflags --debug=no` -lsqlite3  
+LDLIBSOPTIONS=-L/usr/lib/gtk-2.0/2.10.0 `pkg-config --libs opencv` `wx-config --libs --cxxflags --debug=no` -lsqlite3 -ljpeg -lpng -ltiff  
 
 # Build Targets
 .build-conf: ${BUILD_SUBPROJECTS}
@@ -139,9 +164,136 @@ ${OBJECTDIR}/Icon.o: Icon.cpp
 	${RM} $@.d
 	$(COMPILE.cc) -g -s -D__cplusplus -I/usr/include -I/usr/include/wx-2.8 -I/usr/include/c++/4.6 -I/usr/include/i386-linux-gnu -I/usr/lib/wx/include/gtk2-unicode-release-2.8 `pkg-config --cflags opencv` `wx-config --cflags --cxxflags --debug=no`    -MMD -MP -MF $@.d -o ${OBJECTDIR}/Icon.o Icon.cpp
 
+${OBJECTDIR}/CrowdRenderer.o: CrowdRenderer.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} $@.d
+	$(COMPILE.cc) -g -s -D__cplusplus -I/usr/include -I/usr/include/wx-2.8 -I/usr/include/c++/4.6 -I/usr/include/i386-linux-gnu -I/usr/lib/wx/include/gtk2-unicode-release-2.8 `pkg-config --cflags opencv` `wx-config --cflags --cxxflags --debug=no`    -MMD -MP -MF $@.d -o ${OBJECTDIR}/CrowdRenderer.o CrowdRenderer.cpp
+
+${OBJECTDIR}/CrowdExporter.o: CrowdExporter.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} $@.d
+	$(COMPILE.cc) -g -s -D__cplusplus -I/usr/include -I/usr/include/wx-2.8 -I/usr/include/c++/4.6 -I/usr/include/i386-linux-gnu -I/usr/lib/wx/include/gtk2-unicode-release-2.8 `pkg-config --cflags opencv` `wx-config --cflags --cxxflags --debug=no`    -MMD -MP -MF $@.d -o ${OBJECTDIR}/CrowdExporter.o CrowdExporter.cpp
+
+${OBJECTDIR}/FaceDetector.o: FaceDetector.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} $@.d
+	$(COMPILE.cc) -g -s -D__cplusplus -I/usr/include -I/usr/include/wx-2.8 -I/usr/include/c++/4.6 -I/usr/include/i386-linux-gnu -I/usr/lib/wx/include/gtk2-unicode-release-2.8 `pkg-config --cflags opencv` `wx-config --cflags --cxxflags --debug=no`    -MMD -MP -MF $@.d -o ${OBJECTDIR}/FaceDetector.o FaceDetector.cpp
+
+${OBJECTDIR}/IDAllocator.o: IDAllocator.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} $@.d
+	$(COMPILE.cc) -g -s -D__cplusplus -I/usr/include -I/usr/include/wx-2.8 -I/usr/include/c++/4.6 -I/usr/include/i386-linux-gnu -I/usr/lib/wx/include/gtk2-unicode-release-2.8 `pkg-config --cflags opencv` `wx-config --cflags --cxxflags --debug=no`    -MMD -MP -MF $@.d -o ${OBJECTDIR}/IDAllocator.o IDAllocator.cpp
+
+${OBJECTDIR}/ImagePlanes.o: ImagePlanes.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} $@.d
+	$(COMPILE.cc) -g -s -D__cplusplus -I/usr/include -I/usr/include/wx-2.8 -I/usr/include/c++/4.6 -I/usr/include/i386-linux-gnu -I/usr/lib/wx/include/gtk2-unicode-release-2.8 `pkg-config --cflags opencv` `wx-config --cflags --cxxflags --debug=no`    -MMD -MP -MF $@.d -o ${OBJECTDIR}/ImagePlanes.o ImagePlanes.cpp
+
+${OBJECTDIR}/JpegHeader.o: JpegHeader.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} $@.d
+	$(COMPILE.cc) -g -s -D__cplusplus -I/usr/include -I/usr/include/wx-2.8 -I/usr/include/c++/4.6 -I/usr/include/i386-linux-gnu -I/usr/lib/wx/include/gtk2-unicode-release-2.8 `pkg-config --cflags opencv` `wx-config --cflags --cxxflags --debug=no`    -MMD -MP -MF $@.d -o ${OBJECTDIR}/JpegHeader.o JpegHeader.cpp
+
+${OBJECTDIR}/ImageDecoder.o: ImageDecoder.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} $@.d
+	$(COMPILE.cc) -g -s -D__cplusplus -I/usr/include -I/usr/include/wx-2.8 -I/usr/include/c++/4.6 -I/usr/include/i386-linux-gnu -I/usr/lib/wx/include/gtk2-unicode-release-2.8 `pkg-config --cflags opencv` `wx-config --cflags --cxxflags --debug=no`    -MMD -MP -MF $@.d -o ${OBJECTDIR}/ImageDecoder.o ImageDecoder.cpp
+
+${OBJECTDIR}/CoreTools.o: CoreTools.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} $@.d
+	$(COMPILE.cc) -g -s -D__cplusplus -I/usr/include -I/usr/include/wx-2.8 -I/usr/include/c++/4.6 -I/usr/include/i386-linux-gnu -I/usr/lib/wx/include/gtk2-unicode-release-2.8 `pkg-config --cflags opencv` `wx-config --cflags --cxxflags --debug=no`    -MMD -MP -MF $@.d -o ${OBJECTDIR}/CoreTools.o CoreTools.cpp
+
+${OBJECTDIR}/ScanEngine.o: ScanEngine.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} $@.d
+	$(COMPILE.cc) -g -s -D__cplusplus -I/usr/include -I/usr/include/wx-2.8 -I/usr/include/c++/4.6 -I/usr/include/i386-linux-gnu -I/usr/lib/wx/include/gtk2-unicode-release-2.8 `pkg-config --cflags opencv` `wx-config --cflags --cxxflags --debug=no`    -MMD -MP -MF $@.d -o ${OBJECTDIR}/ScanEngine.o ScanEngine.cpp
+
+${OBJECTDIR}/Compositor.o: Compositor.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} $@.d
+	$(COMPILE.cc) -g -s -D__cplusplus -I/usr/include -I/usr/include/wx-2.8 -I/usr/include/c++/4.6 -I/usr/include/i386-linux-gnu -I/usr/lib/wx/include/gtk2-unicode-release-2.8 `pkg-config --cflags opencv` `wx-config --cflags --cxxflags --debug=no`    -MMD -MP -MF $@.d -o ${OBJECTDIR}/Compositor.o Compositor.cpp
+
+${OBJECTDIR}/SharedImage.o: SharedImage.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} $@.d
+	$(COMPILE.cc) -g -s -D__cplusplus -I/usr/include -I/usr/include/wx-2.8 -I/usr/include/c++/4.6 -I/usr/include/i386-linux-gnu -I/usr/lib/wx/include/gtk2-unicode-release-2.8 `pkg-config --cflags opencv` `wx-config --cflags --cxxflags --debug=no`    -MMD -MP -MF $@.d -o ${OBJECTDIR}/SharedImage.o SharedImage.cpp
+
+${OBJECTDIR}/LayerCache.o: LayerCache.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} $@.d
+	$(COMPILE.cc) -g -s -D__cplusplus -I/usr/include -I/usr/include/wx-2.8 -I/usr/include/c++/4.6 -I/usr/include/i386-linux-gnu -I/usr/lib/wx/include/gtk2-unicode-release-2.8 `pkg-config --cflags opencv` `wx-config --cflags --cxxflags --debug=no`    -MMD -MP -MF $@.d -o ${OBJECTDIR}/LayerCache.o LayerCache.cpp
+
+${OBJECTDIR}/SpriteAtlas.o: SpriteAtlas.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} $@.d
+	$(COMPILE.cc) -g -s -D__cplusplus -I/usr/include -I/usr/include/wx-2.8 -I/usr/include/c++/4.6 -I/usr/include/i386-linux-gnu -I/usr/lib/wx/include/gtk2-unicode-release-2.8 `pkg-config --cflags opencv` `wx-config --cflags --cxxflags --debug=no`    -MMD -MP -MF $@.d -o ${OBJECTDIR}/SpriteAtlas.o SpriteAtlas.cpp
+
+${OBJECTDIR}/ImageBands.o: ImageBands.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} $@.d
+	$(COMPILE.cc) -g -s -D__cplusplus -I/usr/include -I/usr/include/wx-2.8 -I/usr/include/c++/4.6 -I/usr/include/i386-linux-gnu -I/usr/lib/wx/include/gtk2-unicode-release-2.8 `pkg-config --cflags opencv` `wx-config --cflags --cxxflags --debug=no`    -MMD -MP -MF $@.d -o ${OBJECTDIR}/ImageBands.o ImageBands.cpp
+
+${OBJECTDIR}/ResampleKernel.o: ResampleKernel.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} $@.d
+	$(COMPILE.cc) -g -s -D__cplusplus -I/usr/include -I/usr/include/wx-2.8 -I/usr/include/c++/4.6 -I/usr/include/i386-linux-gnu -I/usr/lib/wx/include/gtk2-unicode-release-2.8 `pkg-config --cflags opencv` `wx-config --cflags --cxxflags --debug=no`    -MMD -MP -MF $@.d -o ${OBJECTDIR}/ResampleKernel.o ResampleKernel.cpp
+
+${OBJECTDIR}/PixelKernels.o: PixelKernels.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} $@.d
+	$(COMPILE.cc) -g -s -D__cplusplus -I/usr/include -I/usr/include/wx-2.8 -I/usr/include/c++/4.6 -I/usr/include/i386-linux-gnu -I/usr/lib/wx/include/gtk2-unicode-release-2.8 `pkg-config --cflags opencv` `wx-config --cflags --cxxflags --debug=no`    -MMD -MP -MF $@.d -o ${OBJECTDIR}/PixelKernels.o PixelKernels.cpp
+
 # Subprojects
 .build-subprojects:
 
+# Build Test Targets
+# The benchmark also paints, so it needs the compositors as well as the core.
+BENCHMARKOBJECTS= \
+	${OBJECTDIR}/Compositor.o \
+	${OBJECTDIR}/ResampleKernel.o \
+	${OBJECTDIR}/SharedImage.o \
+	${OBJECTDIR}/Tools.o
+
+.build-tests-conf: .build-conf ${TESTFILES}
+${TESTDIR}/TestFiles/PixelKernelsTest: ${TESTDIR}/tests/PixelKernelsTest.o ${CORELIB}
+	${MKDIR} -p ${TESTDIR}/TestFiles
+	${LINK.cc} -o ${TESTDIR}/TestFiles/PixelKernelsTest -s ${TESTDIR}/tests/PixelKernelsTest.o ${CORELIB} ${LDLIBSOPTIONS} 
+
+${TESTDIR}/tests/PixelKernelsTest.o: tests/PixelKernelsTest.cpp 
+	${MKDIR} -p ${TESTDIR}/tests
+	${RM} $@.d
+	$(COMPILE.cc) -g -s -I. -D__cplusplus -I/usr/include -I/usr/include/wx-2.8 -I/usr/include/c++/4.6 -I/usr/include/i386-linux-gnu -I/usr/lib/wx/include/gtk2-unicode-release-2.8 `pkg-config --cflags opencv` `wx-config --cflags --cxxflags --debug=no`    -MMD -MP -MF $@.d -o ${TESTDIR}/tests/PixelKernelsTest.o tests/PixelKernelsTest.cpp
+
+${TESTDIR}/TestFiles/CrowdBenchmark: ${TESTDIR}/tests/CrowdBenchmark.o ${BENCHMARKOBJECTS} ${CORELIB}
+	${MKDIR} -p ${TESTDIR}/TestFiles
+	${LINK.cc} -o ${TESTDIR}/TestFiles/CrowdBenchmark -s ${TESTDIR}/tests/CrowdBenchmark.o ${BENCHMARKOBJECTS} ${CORELIB} ${LDLIBSOPTIONS} 
+
+${TESTDIR}/tests/CrowdBenchmark.o: tests/CrowdBenchmark.cpp 
+	${MKDIR} -p ${TESTDIR}/tests
+	${RM} $@.d
+	$(COMPILE.cc) -g -s -I. -D__cplusplus -I/usr/include -I/usr/include/wx-2.8 -I/usr/include/c++/4.6 -I/usr/include/i386-linux-gnu -I/usr/lib/wx/include/gtk2-unicode-release-2.8 `pkg-config --cflags opencv` `wx-config --cflags --cxxflags --debug=no`    -MMD -MP -MF $@.d -o ${TESTDIR}/tests/CrowdBenchmark.o tests/CrowdBenchmark.cpp
+
+# The revision test paints whole crowds, so it needs everything but main().
+${TESTDIR}/TestFiles/ReviseTest: ${TESTDIR}/tests/ReviseTest.o ${OBJECTFILES}
+	${MKDIR} -p ${TESTDIR}/TestFiles
+	${LINK.cc} -o ${TESTDIR}/TestFiles/ReviseTest -s ${TESTDIR}/tests/ReviseTest.o $(filter-out ${OBJECTDIR}/crowd3.o,${OBJECTFILES}) ${LDLIBSOPTIONS} 
+
+${TESTDIR}/tests/ReviseTest.o: tests/ReviseTest.cpp 
+	${MKDIR} -p ${TESTDIR}/tests
+	${RM} $@.d
+	$(COMPILE.cc) -g -s -I. -D__cplusplus -I/usr/include -I/usr/include/wx-2.8 -I/usr/include/c++/4.6 -I/usr/include/i386-linux-gnu -I/usr/lib/wx/include/gtk2-unicode-release-2.8 `pkg-config --cflags opencv` `wx-config --cflags --cxxflags --debug=no`    -MMD -MP -MF $@.d -o ${TESTDIR}/tests/ReviseTest.o tests/ReviseTest.cpp
+
+# Run Test Targets
+.test-conf:
+	@if [ "${TEST}" = "" ]; \
+	then  \
+	    ${TESTDIR}/TestFiles/PixelKernelsTest && \
+	    ${TESTDIR}/TestFiles/ReviseTest; \
+	else  \
+	    ./${TEST}; \
+	fi
+
 # Clean Targets
 .clean-conf: ${CLEAN_SUBPROJECTS}
 	${RM} -r ${CND_BUILDDIR}/${CND_CONF}
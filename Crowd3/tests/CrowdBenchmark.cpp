@@ -0,0 +1,353 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Times the slow parts of Crowd3 on fixed inputs, away from the GUI, so that
+ * changes to them can be measured. Built by "make build-tests" but not run by
+ * "make test": it needs folders of images.<p><code>
+ * CrowdBenchmark compose peopleFolder [width height rows]<p>
+ * CrowdBenchmark scan photoFolder dataFolder workFolder [detector ...]<p></code>
+ * compose: paints one crowd layout from the person images (*.png) in
+ * peopleFolder with every compositor, timing each, and compares their images.<p>
+ * scan: searches every file under photoFolder for people with each face
+ * detector (each one with a data file in dataFolder if none is named),
+ * without and then with the thumbnail pre-screen, timing each search.
+ * dataFolder holds the detector files. The image database, converted cascades
+ * and person images are written to workFolder, which should be an empty
+ * folder kept for the purpose.
+ */
+
+#include "Compositor.h"
+#include "FaceDetector.h"
+#include "ImageDB.h"
+#include "ScanEngine.h"
+#include <wx/init.h>
+#include <wx/stopwatch.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+/** The crowd image size and number of rows when none are given. */
+const wxInt32 BENCHWIDTH = 4000;
+const wxInt32 BENCHHEIGHT = 3000;
+const wxInt32 BENCHROWS = 6;
+
+/** A crowd row: the people in it and the canvas rows they cover. */
+struct BenchRow {
+    vector<Placement> people;
+    wxInt32 top;
+    wxInt32 bottom;
+};
+
+/**
+ * Lay out a crowd the same way on every run. People in rows nearer the front
+ * are larger and lower. Each row is filled from left to right with the next
+ * person images in name order, overlapping by a third.
+ * @param files The person image files, sorted.
+ * @param width The crowd image width.
+ * @param height The crowd image height.
+ * @param rowCount The number of rows.
+ * @return The rows, back row first.
+ */
+static vector<BenchRow> layOut(const wxArrayString& files, wxInt32 width,
+                               wxInt32 height, wxInt32 rowCount) {
+    vector<BenchRow> rows;
+    size_t next = 0;
+    for (wxInt32 r = rowCount - 1; r >= 0; r--) {
+        double depth = rowCount > 1 ? (double) r / (rowCount - 1) : 0.0;
+        wxInt32 personHeight = (wxInt32) (height * (0.6 - 0.4 * depth));
+        wxInt32 baseline = (wxInt32) (height * (1.0 - 0.45 * depth)) + personHeight / 4;
+        BenchRow row;
+        row.top = max(0, baseline - personHeight);
+        row.bottom = min(height, baseline);
+        size_t misses = 0;
+        for (wxInt32 left = -personHeight / 4; left < width && misses < files.Count(); ) {
+            Placement at;
+            wxInt32 fileWidth;
+            wxInt32 fileHeight;
+            at.file = files[next % files.Count()];
+            next++;
+            if ( ! Tools::pngSize(at.file, fileWidth, fileHeight) || fileHeight <= 0) {
+                misses++;
+                continue;
+            }
+            misses = 0;
+            at.row = r;
+            at.left = left;
+            at.top = baseline - personHeight;
+            at.width = max(1, personHeight * fileWidth / fileHeight);
+            at.height = personHeight;
+            row.people.push_back(at);
+            left = left + max(1, at.width * 2 / 3);
+        }
+        rows.push_back(row);
+    }
+    return rows;
+}
+
+/**
+ * Paint a crowd layout, back row first, blurring each row but the front one
+ * by its depth as it is finished.
+ * @param aCompositor The compositor.
+ * @param rows The layout.
+ * @param width The crowd image width.
+ * @param height The crowd image height.
+ * @return The number of person images that could not be read.
+ */
+static wxInt32 paint(Compositor *aCompositor, const vector<BenchRow>& rows,
+                     wxInt32 width, wxInt32 height) {
+    wxInt32 unread = 0;
+    aCompositor->clear(width, height);
+    for (size_t i = 0; i < rows.size(); i++) {
+        const BenchRow& row = rows[i];
+        for (size_t p = 0; p < row.people.size(); p++) {
+            if ( ! aCompositor->paintPerson(row.people[p].file, row.people[p],
+                                            false, false)) {
+                unread++;
+            }
+        }
+        wxInt32 depth = rows.size() - 1 - i;
+        if (depth > 0 && row.bottom > row.top) {
+            aCompositor->blurBand(row.top, row.bottom - row.top, depth);
+        }
+    }
+    return unread;
+}
+
+/**
+ * Paint one crowd layout with every compositor, timing each, and compare
+ * their images. The layout is painted once beforehand, so that no compositor
+ * pays for a cold disk cache.
+ * @return The exit status.
+ */
+static int compose(int argc, char **argv) {
+    if (argc != 3 && argc != 6) {
+        return 2;
+    }
+    wxInt32 width = argc == 6 ? atoi(argv[3]) : BENCHWIDTH;
+    wxInt32 height = argc == 6 ? atoi(argv[4]) : BENCHHEIGHT;
+    wxInt32 rowCount = argc == 6 ? atoi(argv[5]) : BENCHROWS;
+    wxArrayString files;
+    wxDir::GetAllFiles(Tools::str2wx(argv[2]), &files, _T("*.png"), wxDIR_FILES);
+    files.Sort();
+    if (files.IsEmpty() || width <= 0 || height <= 0 || rowCount <= 0) {
+        fprintf(stderr, "No person images, or a bad crowd size.\n");
+        return 1;
+    }
+    vector<BenchRow> rows = layOut(files, width, height, rowCount);
+    size_t people = 0;
+    for (size_t i = 0; i < rows.size(); i++) {
+        people = people + rows[i].people.size();
+    }
+    printf("%dx%d crowd, %d rows, %d people\n", width, height, rowCount, (int) people);
+
+    wxArrayString names = Compositor::available();
+    Mat firstImage;
+    long firstTime = 0;
+    for (size_t i = 0; i < names.Count(); i++) {
+        Compositor *aCompositor = Compositor::create(names[i]);
+        if (i == 0) {
+            paint(aCompositor, rows, width, height); // Warm the disk cache.
+        }
+        wxStopWatch watch;
+        wxInt32 unread = paint(aCompositor, rows, width, height);
+        long time = watch.Time();
+        Mat pixels = aCompositor->getImage().mat();
+        printf("%s: %ld ms", Tools::wx2str(names[i]).c_str(), time);
+        if (i == 0) {
+            firstImage = pixels.clone();
+            firstTime = time;
+        }
+        else {
+            // Speed relative to the first compositor, and the mean difference
+            // of their pixel values.
+            double difference = norm(firstImage, pixels, NORM_L1) / (pixels.total() * 3);
+            printf(", %.1fx the speed of %s, mean difference %.2f",
+                   firstTime / (double) max(1L, time),
+                   Tools::wx2str(names[0]).c_str(), difference);
+        }
+        if (unread > 0) {
+            printf(", %d person images unread", unread);
+        }
+        printf("\n");
+        delete aCompositor;
+    }
+    return 0;
+}
+
+/** Counts what a search finds. */
+class CountingListener : public ScanListener {
+public:
+    CountingListener() {
+        files = 0;
+        unread = 0;
+        people = 0;
+        errors = 0;
+    }
+
+    /** Count a searched file. */
+    virtual void scanned(const ScanResult& result) {
+        files++;
+        if ( ! result.readOK || result.skipped) {
+            unread++;
+        }
+        if ( ! result.error.empty()) {
+            errors++;
+        }
+        if (result.firstID >= 0) {
+            people = people + result.lastID - result.firstID + 1;
+        }
+    }
+
+    /** Never stop the search. */
+    virtual bool progress() {
+        return true;
+    }
+
+    /** The number of files searched. */
+    wxInt32 files;
+
+    /** The number of those that were not photos, or too small to search. */
+    wxInt32 unread;
+
+    /** The number of people found. */
+    wxInt32 people;
+
+    /** The number of files whose image IDs could not be reserved. */
+    wxInt32 errors;
+};
+
+/**
+ * Search files for people the way the Find People command does, and report
+ * the time taken and what was found.
+ * @param files The files.
+ * @param detector The face detector.
+ * @param prescreenDetector The pre-screen's detector, or NULL for none.
+ * @param workFolder The folder for person images, with a trailing separator.
+ */
+static void search(const wxArrayString& files, FaceDetector *detector,
+                   FaceDetector *prescreenDetector, const string& workFolder) {
+    CountingListener listener;
+    ScanEngine engine;
+    wxStopWatch watch;
+    engine.start(detector, prescreenDetector, workFolder, &listener);
+    for (size_t i = 0; i < files.Count(); i++) {
+        engine.submit(Tools::wx2str(files[i]));
+        engine.poll();
+    }
+    engine.finish(true);
+    long time = watch.Time();
+    printf("%s%s: %ld ms, %.1f files/s, %d files, %d not searched, %d people",
+           detector->name().c_str(), prescreenDetector != NULL ? " with pre-screen" : "",
+           time, listener.files * 1000.0 / max(1L, time), listener.files,
+           listener.unread, listener.people);
+    if (listener.errors > 0) {
+        printf(", %d files without image IDs", listener.errors);
+    }
+    printf("\n");
+}
+
+/**
+ * Search one folder of photos with each face detector, timing each search.
+ * Every file is read once beforehand, so that no search pays for a cold disk
+ * cache.
+ * @return The exit status.
+ */
+static int scan(int argc, char **argv) {
+    if (argc < 5) {
+        return 2;
+    }
+    string dataFolder = string(argv[3]) + Tools::wx2str(SEPARATOR);
+    string workFolder = string(argv[4]) + Tools::wx2str(SEPARATOR);
+    vector<string> names;
+    for (int i = 5; i < argc; i++) {
+        names.push_back(argv[i]);
+    }
+    if (names.empty()) {
+        names = FaceDetector::available(dataFolder);
+    }
+    wxArrayString files;
+    wxDir::GetAllFiles(Tools::str2wx(argv[2]), &files);
+    files.Sort();
+    if (files.IsEmpty() ||
+            ! ImageDB::open(workFolder + Tools::wx2str(DATABASE), 0)) {
+        fprintf(stderr, "No photos, or the image database could not be opened.\n");
+        return 1;
+    }
+
+    // Warm the disk cache.
+    vector<char> buffer(1 << 16);
+    for (size_t i = 0; i < files.Count(); i++) {
+        ifstream in(Tools::wx2str(files[i]).c_str(), ios::in | ios::binary);
+        while (in.read(&buffer[0], buffer.size())) {}
+    }
+    printf("%d files\n", (int) files.Count());
+
+    int status = 0;
+    for (size_t n = 0; n < names.size(); n++) {
+        string error;
+        FaceDetector *detector = FaceDetector::create(names[n], dataFolder, workFolder, error);
+        FaceDetector *prescreenDetector = FaceDetector::create(names[n], dataFolder,
+                                                               workFolder, error);
+        if (detector == NULL || prescreenDetector == NULL) {
+            fprintf(stderr, "%s: %s\n", names[n].c_str(), error.c_str());
+            status = 1;
+        }
+        else {
+            search(files, detector, NULL, workFolder);
+            search(files, detector, prescreenDetector, workFolder);
+        }
+        delete detector;
+        delete prescreenDetector;
+    }
+    ImageDB::close();
+    return status;
+}
+
+/** Run the benchmark the first argument names. */
+int main(int argc, char **argv) {
+    wxInitializer initializer;
+    if ( ! initializer) {
+        fprintf(stderr, "wxWidgets could not be initialized.\n");
+        return 1;
+    }
+    wxInitAllImageHandlers();
+    int status = 2;
+    if (argc > 1 && string(argv[1]) == "compose") {
+        status = compose(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "scan") {
+        status = scan(argc, argv);
+    }
+    if (status == 2) {
+        fprintf(stderr, "Usage: CrowdBenchmark compose peopleFolder [width height rows]\n"
+                "       CrowdBenchmark scan photoFolder dataFolder workFolder [detector ...]\n");
+    }
+    return status;
+}
@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Checks that the SSE2, AVX2 and AVX-512 pixel kernels give exactly the
+ * scalar reference's results, on rows of every length up to a few hundred
+ * pixels, starting at every alignment, with set pixels in the vector blocks
+ * and in the tails after them. Levels the processor does not support are
+ * skipped. Run by "make test"; the output is in the NetBeans simple test
+ * format, and the exit status is nonzero if a kernel differs.
+ */
+
+#include "PixelKernels.h"
+#include <iostream>
+#include <sstream>
+
+/** The longest row tested, in pixels. */
+const wxInt32 MAXPIXELS = 300;
+
+/** Rows start up to this many bytes into their buffer. */
+const wxInt32 MAXOFFSET = 64;
+
+/** Bytes after a row that kernels must neither read nor write. */
+const wxInt32 GUARDBYTES = 3 * 64;
+
+/** The size of a row buffer. */
+const wxInt32 BUFFERBYTES = MAXOFFSET + 3 * MAXPIXELS + GUARDBYTES;
+
+/** Guard bytes are set, and not the colour looked for. */
+const unsigned char GUARD = 0xFF;
+
+/** The colour firstOther() looks past, and markEqual() marks. */
+const unsigned char COLOUR[3] = {1, 1, 1};
+
+/** The number of differences reported before the rest are only counted. */
+const wxInt32 MAXREPORTS = 10;
+
+/** The state of the pseudo-random numbers, the same on every run. */
+static wxUint32 seed = 12345;
+
+/**
+ * @param range The number of values.
+ * @return A pseudo-random number from 0 to range - 1.
+ */
+static wxUint32 draw(wxUint32 range) {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) % range;
+}
+
+/** What every kernel gives for one row. */
+struct Results {
+    wxInt32 first;
+    wxInt32 last;
+    wxInt32 count;
+    wxInt32 other;
+    vector<unsigned char> marks;
+    vector<unsigned char> equalMarks;
+    vector<wxInt32> sums;
+};
+
+/**
+ * Run every kernel on a row at the level in use. Marks and sums start with
+ * the same contents every time, all through their buffers, so kernels that
+ * write outside the row or change what they should leave alone are caught.
+ * @param buffer The row's buffer.
+ * @param offset The byte where the row starts.
+ * @param count The row's length in pixels.
+ * @param weight The weight for accumulate().
+ * @return The results.
+ */
+static Results run(const vector<unsigned char>& buffer, wxInt32 offset,
+                   wxInt32 count, wxInt32 weight) {
+    Results r;
+    const unsigned char *pixels = &buffer[offset];
+    r.first = PixelKernels::firstSet(pixels, count);
+    r.last = PixelKernels::lastSet(pixels, count);
+    r.count = PixelKernels::countSet(pixels, count);
+    r.other = PixelKernels::firstOther(pixels, count, COLOUR);
+    r.marks.resize(BUFFERBYTES);
+    r.sums.resize(BUFFERBYTES);
+    for (wxInt32 i = 0; i < BUFFERBYTES; i++) {
+        r.marks[i] = i % 3 == 0 ? 1 : 0;
+        r.sums[i] = i * 7919 - 1000000;
+    }
+    r.equalMarks = r.marks;
+    PixelKernels::markSet(&r.marks[offset], pixels, count);
+    PixelKernels::markEqual(&r.equalMarks[offset], pixels, 3 * count, COLOUR[0]);
+    PixelKernels::accumulate(&r.sums[offset], pixels, 3 * count, weight);
+    return r;
+}
+
+/**
+ * Name the first kernel whose results differ.
+ * @param a The reference's results.
+ * @param b The results being checked.
+ * @return The kernel's name, or an empty string if all agree.
+ */
+static string differs(const Results& a, const Results& b) {
+    return a.first != b.first ? "firstSet" :
+           a.last != b.last ? "lastSet" :
+           a.count != b.count ? "countSet" :
+           a.other != b.other ? "firstOther" :
+           a.marks != b.marks ? "markSet" :
+           a.equalMarks != b.equalMarks ? "markEqual" :
+           a.sums != b.sums ? "accumulate" : "";
+}
+
+/**
+ * Fill a buffer with a row, and guard bytes before and after it.
+ * @param buffer The buffer.
+ * @param offset The byte where the row starts.
+ * @param count The row's length in pixels.
+ * @param kind 0: black. 1: black with a few set bytes. 2: random bytes.
+ * 3: the colour with a few other bytes. 4: black with one set pixel.
+ * @param at For kind 4, the set pixel.
+ */
+static void makeRow(vector<unsigned char>& buffer, wxInt32 offset,
+                    wxInt32 count, wxInt32 kind, wxInt32 at) {
+    buffer.assign(BUFFERBYTES, GUARD);
+    for (wxInt32 b = 0; b < 3 * count; b++) {
+        unsigned char background = kind == 3 ? COLOUR[b % 3] : 0;
+        unsigned char odd = (unsigned char) (1 + draw(255));
+        buffer[offset + b] = kind == 2 ? (unsigned char) draw(256) :
+                             (kind == 1 || kind == 3) && draw(40) == 0 ? odd :
+                             background;
+    }
+    if (kind == 4) {
+        // Set one byte of the pixel only, a different one at each position.
+        buffer[offset + 3 * at + at % 3] = (unsigned char) (1 + at % 255);
+    }
+}
+
+/**
+ * Compare one row at one level with the reference, and report a difference.
+ * @param aLevel The level.
+ * @param buffer The row's buffer.
+ * @param offset The byte where the row starts.
+ * @param count The row's length in pixels.
+ * @param failures The number of differences so far, counted up.
+ */
+static void check(PixelKernels::Level aLevel, const vector<unsigned char>& buffer,
+                  wxInt32 offset, wxInt32 count, wxInt32& failures) {
+    wxInt32 weight = draw(32768);
+    PixelKernels::use(PixelKernels::SCALAR);
+    Results expected = run(buffer, offset, count, weight);
+    PixelKernels::use(aLevel);
+    Results actual = run(buffer, offset, count, weight);
+    string kernel = differs(expected, actual);
+    if ( ! kernel.empty()) {
+        failures++;
+        if (failures <= MAXREPORTS) {
+            cout << "    " << kernel << " differs: " << count << " pixels at offset "
+                    << offset << endl;
+        }
+    }
+}
+
+/**
+ * Check a level's kernels against the reference.
+ * @param aLevel The level.
+ * @return The number of rows on which some kernel differs.
+ */
+static wxInt32 testLevel(PixelKernels::Level aLevel) {
+    vector<unsigned char> buffer;
+    wxInt32 failures = 0;
+    // Every length, each kind of row, each start from aligned to 63 bytes off.
+    for (wxInt32 count = 0; count <= MAXPIXELS; count++) {
+        for (wxInt32 kind = 0; kind < 4; kind++) {
+            wxInt32 offset = (count + 17 * kind) % MAXOFFSET;
+            makeRow(buffer, offset, count, kind, 0);
+            check(aLevel, buffer, offset, count, failures);
+        }
+    }
+    // One set pixel at every position, in the blocks and in the tails, of
+    // rows around the block sizes.
+    const wxInt32 COUNTS[] = {1, 2, 3, 15, 16, 17, 31, 32, 33, 47, 48, 49,
+                              63, 64, 65, 127, 128, 129, 255, 256, 257};
+    for (size_t c = 0; c < sizeof(COUNTS) / sizeof(COUNTS[0]); c++) {
+        for (wxInt32 at = 0; at < COUNTS[c]; at++) {
+            wxInt32 offset = draw(MAXOFFSET);
+            makeRow(buffer, offset, COUNTS[c], 4, at);
+            check(aLevel, buffer, offset, COUNTS[c], failures);
+        }
+    }
+    return failures;
+}
+
+/** Test each vector level the processor supports. */
+int main(int argc, char **argv) {
+    const PixelKernels::Level LEVELS[] = {PixelKernels::SSE2, PixelKernels::AVX2,
+                                          PixelKernels::AVX512};
+    wxInt32 failed = 0;
+    cout << "%SUITE_STARTING% PixelKernelsTest" << endl;
+    cout << "%SUITE_STARTED%" << endl;
+    for (size_t i = 0; i < sizeof(LEVELS) / sizeof(LEVELS[0]); i++) {
+        string name = PixelKernels::name(LEVELS[i]);
+        if (LEVELS[i] > PixelKernels::supported()) {
+            cout << name << " is not supported here, or not compiled; skipped." << endl;
+            continue;
+        }
+        cout << "%TEST_STARTED% " << name << " (PixelKernelsTest)" << endl;
+        wxInt32 failures = testLevel(LEVELS[i]);
+        if (failures > 0) {
+            failed++;
+            cout << "%TEST_FAILED% time=0 testname=" << name << " (PixelKernelsTest) "
+                    "message=" << failures << " rows differ from the reference" << endl;
+        }
+        cout << "%TEST_FINISHED% time=0 " << name << " (PixelKernelsTest)" << endl;
+    }
+    cout << "%SUITE_FINISHED% time=0" << endl;
+    return failed == 0 ? 0 : 1;
+}
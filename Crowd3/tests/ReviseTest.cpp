@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2012, Dennis Damico
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the copyright holder nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Checks that a crowd image revised after replacePeople() or swapPeople() is
+ * exactly the crowd image a full render of the same crowd paints, with every
+ * compositor, at full resolution and in drafts, with perspective blur. The
+ * person and background images are made up and written to a new folder under
+ * the system temporary folder, which stands in for the user's home folder.
+ * Run by "make test"; the output is in the NetBeans simple test format, and
+ * the exit status is nonzero if a revision differs.
+ */
+
+#include "CrowdMaker.h"
+#include "Settings.h"
+#include "Tools.h"
+#include <wx/dir.h>
+#include <wx/filefn.h>
+#include <wx/init.h>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+/** The number of different person images. */
+const wxInt32 PERSONFILES = 12;
+
+/** The crowd image size and number of people. */
+const wxInt32 CROWDWIDTH = 900;
+const wxInt32 CROWDHEIGHT = 600;
+const wxInt32 CROWDPEOPLE = 80;
+
+/** The number of edits checked in each test. Edits alternate between
+ * replacing and swapping people. */
+const wxInt32 EDITS = 6;
+
+/** Lets every render run to the end. */
+class QuietListener : public CrowdListener {
+public:
+    bool personAdded(wxInt32 peopleAdded) {
+        return true;
+    }
+    void rowAdded(Compositor& aCrowd) {}
+};
+
+/**
+ * Write made up person images: opaque bodies up to the image edges, so that
+ * a changed person changes the pixels along the edge of its area, with round
+ * heads fading out at the edge and fully transparent corners.
+ * @param folder The folder to write them to.
+ * @param files The returned file names.
+ * @return true if they were written, else false.
+ */
+static bool writePeople(const wxString& folder, wxArrayString& files) {
+    for (wxInt32 f = 0; f < PERSONFILES; f++) {
+        wxInt32 width = 40 + 7 * f;
+        wxInt32 height = 2 * width + 5 * (f % 3);
+        wxImage aPerson(width, height, false);
+        aPerson.InitAlpha();
+        unsigned char *rgb = aPerson.GetData();
+        unsigned char *alpha = aPerson.GetAlpha();
+        wxInt32 headRadius = width / 2;
+        for (wxInt32 y = 0; y < height; y++) {
+            for (wxInt32 x = 0; x < width; x++) {
+                wxInt32 i = y * width + x;
+                rgb[3 * i] = (unsigned char) (40 + 17 * f + x);
+                rgb[3 * i + 1] = (unsigned char) (200 - 13 * f + y);
+                rgb[3 * i + 2] = (unsigned char) (90 + 31 * f + x * y);
+                if (y >= 2 * headRadius) {
+                    alpha[i] = 255; // The body.
+                    continue;
+                }
+                double dx = x + 0.5 - headRadius;
+                double dy = y + 0.5 - headRadius;
+                double edge = headRadius - sqrt(dx * dx + dy * dy);
+                alpha[i] = (unsigned char) (edge <= 0 ? 0 : edge >= 2 ? 255 : 127 * edge);
+            }
+        }
+        wxString aFile = wxString::Format(_T("person%d.png"), f);
+        if ( ! aPerson.SaveFile(folder + SEPARATOR + aFile, wxBITMAP_TYPE_PNG)) {
+            return false;
+        }
+        files.Add(aFile);
+    }
+    return true;
+}
+
+/**
+ * Write a made up background image with detail everywhere, so that a wrongly
+ * restored or blurred background pixel shows.
+ * @param path The file to write.
+ * @return true if it was written, else false.
+ */
+static bool writeBackground(const wxString& path) {
+    wxImage aBackground(CROWDWIDTH, CROWDHEIGHT, false);
+    unsigned char *rgb = aBackground.GetData();
+    for (wxInt32 i = 0; i < 3 * CROWDWIDTH * CROWDHEIGHT; i++) {
+        rgb[i] = (unsigned char) rand();
+    }
+    return aBackground.SaveFile(path, wxBITMAP_TYPE_PNG);
+}
+
+/**
+ * Revise a crowd image after each of a few edits, paint the same crowd again
+ * without revising, and compare the two.
+ * @param maker The crowd maker, set up for the test.
+ * @param files The person image files to choose from.
+ * @return A description of the first difference, or "" if there is none.
+ */
+static string checkRevisions(CrowdMaker& maker, wxArrayString& files) {
+    QuietListener listener;
+    maker.setIncremental(true);
+    if ( ! maker.makeCrowdImage(&files) || ! maker.renderCrowdImage(&listener)) {
+        return "the first crowd image was not painted";
+    }
+    for (wxInt32 e = 0; e < EDITS; e++) {
+        if (e % 2 == 0) {
+            maker.replacePeople(1 + e / 2);
+        }
+        else {
+            maker.swapPeople(1 + e / 2);
+        }
+        maker.renderCrowdImage(&listener);
+        Mat revised = maker.getCrowdImage().mat().clone();
+        
+        // Paint the same crowd in full, then again to keep it for the next
+        // revision.
+        maker.setIncremental(false);
+        maker.renderCrowdImage(&listener);
+        Mat full = maker.getCrowdImage().mat().clone();
+        maker.setIncremental(true);
+        maker.renderCrowdImage(&listener);
+        
+        ostringstream problem;
+        if (revised.size() != full.size()) {
+            problem << "edit " << e << ": the revised image is " << revised.cols << "x"
+                    << revised.rows << ", the full render " << full.cols << "x" << full.rows;
+            return problem.str();
+        }
+        Mat difference;
+        absdiff(revised, full, difference);
+        Mat gray = difference.reshape(1);
+        wxInt32 differing = countNonZero(gray);
+        if (differing > 0) {
+            double worst = 0;
+            minMaxLoc(gray, NULL, &worst);
+            problem << "edit " << e << ": " << differing << " channel values differ, by up to "
+                    << worst;
+            return problem.str();
+        }
+    }
+    return "";
+}
+
+/**
+ * Delete the folder standing in for the home folder, and everything in it.
+ * @param home The folder.
+ */
+static void removeHome(const wxString& home) {
+    wxArrayString paths;
+    wxDir::GetAllFiles(home, &paths, wxEmptyString, wxDIR_FILES | wxDIR_DIRS | wxDIR_HIDDEN);
+    for (size_t i = 0; i < paths.GetCount(); i++) {
+        wxRemoveFile(paths[i]);
+    }
+    wxRmdir(Tools::crowd3Folder());
+    wxRmdir(home);
+}
+
+int main(int argc, char **argv) {
+    // Settings and person images go to the made up home folder, not the user's.
+    char home[] = "/tmp/crowd3testXXXXXX";
+    if (mkdtemp(home) == NULL || setenv("HOME", home, 1) != 0) {
+        cerr << "No temporary home folder could be made." << endl;
+        return 1;
+    }
+    wxInitializer initializer;
+    if ( ! initializer) {
+        cerr << "wxWidgets could not be initialized." << endl;
+        return 1;
+    }
+    wxInitAllImageHandlers();
+    srand(1);
+    new Settings();
+    wxString homeFolder = Tools::str2wx(home);
+    wxString backgroundPath = homeFolder + SEPARATOR + _T("background.png");
+    wxArrayString files;
+    if ( ! wxMkdir(Tools::crowd3Folder()) || ! writePeople(Tools::crowd3Folder(), files) ||
+            ! writeBackground(backgroundPath)) {
+        cerr << "The test images could not be written to " << home << "." << endl;
+        removeHome(homeFolder);
+        return 1;
+    }
+    
+    const wxSize SIZES[] = {wxDefaultSize, wxSize(CROWDWIDTH / 3, CROWDHEIGHT / 3)};
+    const char *SIZENAMES[] = {"full", "draft"};
+    wxArrayString compositors = Compositor::available();
+    wxInt32 failed = 0;
+    cout << "%SUITE_STARTING% ReviseTest" << endl;
+    cout << "%SUITE_STARTED%" << endl;
+    for (size_t c = 0; c < compositors.GetCount(); c++) {
+        for (wxInt32 s = 0; s < 2; s++) {
+            for (wxInt32 b = 0; b < 2; b++) {
+                string name = Tools::wx2str(compositors[c]) + "_" + SIZENAMES[s] +
+                        (b == 0 ? "_plain" : "_background");
+                cout << "%TEST_STARTED% " << name << " (ReviseTest)" << endl;
+                CrowdMaker maker;
+                srand(1 + c);
+                maker.setCompositor(compositors[c]);
+                maker.setLayeredRows(false);
+                maker.setOcclusionCulling(false);
+                maker.setPerspective(true);
+                maker.setBackgroundPath(b == 0 ? wxString() : backgroundPath);
+                maker.setImageSize(CROWDWIDTH, CROWDHEIGHT);
+                maker.setPeopleCount(CROWDPEOPLE);
+                maker.setDraftSize(SIZES[s]);
+                string problem = checkRevisions(maker, files);
+                if (problem.length() > 0) {
+                    failed++;
+                    cout << "%TEST_FAILED% time=0 testname=" << name << " (ReviseTest) "
+                            "message=" << problem << endl;
+                }
+                cout << "%TEST_FINISHED% time=0 " << name << " (ReviseTest)" << endl;
+            }
+        }
+    }
+    cout << "%SUITE_FINISHED% time=0" << endl;
+    removeHome(homeFolder);
+    return failed == 0 ? 0 : 1;
+}
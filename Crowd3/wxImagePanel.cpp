@@ -32,6 +32,103 @@
 #include "wxImagePanel.h"
 #include "Tools.h"
 
+/** Posted by the scaler thread when the bitmap image is ready. GetClientData()
+ * is a new ScaledLevels* that the panel must delete, GetExtraLong() is the
+ * rescale's generation. */
+DECLARE_EVENT_TYPE(wxEVT_PANEL_SCALED, -1)
+DEFINE_EVENT_TYPE(wxEVT_PANEL_SCALED)
+
+/** The resize timer's id. */
+const wxInt32 ID_RESIZETIMER = wxID_HIGHEST + 1;
+
+/** What a scaler thread hands to the panel. Its images share pixels with no
+ * other images, so the thread can pass them to the main thread whole. */
+struct ScaledLevels {
+    /** New halved copies of the pyramid's last level, to be appended to it. */
+    std::vector<wxImage> levels;
+    
+    /** The image scaled to the target size. */
+    wxImage scaled;
+};
+
+/**
+ * Rescale a large image on a background thread. Halved copies of a pyramid
+ * level are made until one is less than twice the target size, and that copy
+ * is scaled to the target size with high quality. The copies are made into
+ * the thread's own images and handed to the panel with the result, since wx
+ * reference counts are not thread-safe: the thread never copies or destroys
+ * an image the panel holds. The panel must not change its pyramid until the
+ * thread has ended.
+ */
+class PanelScaler : public wxThread {
+public:
+    /**
+     * Create a joinable scaler thread. Call Run() to start it.
+     * @param handler The receiver of the wxEVT_PANEL_SCALED event.
+     * @param source The pyramid's last level. Only its pixels are read.
+     * @param target The pixel size of the scaled image.
+     * @param generation Copied into the posted event.
+     */
+    PanelScaler(wxEvtHandler *handler, const wxImage *source,
+            wxSize target, long generation) : wxThread(wxTHREAD_JOINABLE) {
+        myHandler = handler;
+        mySource = source;
+        myTarget = target;
+        myGeneration = generation;
+        myCancelled = false;
+    }
+    
+    /** Ask the scaler to stop as soon as possible. */
+    void cancel() {
+        myCancelled = true;
+    }
+    
+protected:
+    /** Thread body: make the new levels, scale, and post the result. */
+    virtual ExitCode Entry() {
+        ScaledLevels *result = new ScaledLevels();
+        const wxImage *level = mySource;
+        while ( ! myCancelled) {
+            wxInt32 w = level->GetWidth() / 2;
+            wxInt32 h = level->GetHeight() / 2;
+            if (w < myTarget.GetWidth() || h < myTarget.GetHeight()) {
+                break;
+            }
+            result->levels.push_back(level->Scale(w, h, wxIMAGE_QUALITY_HIGH));
+            level = &result->levels.back();
+        }
+        if (myCancelled) {
+            delete result;
+            return 0;
+        }
+        
+        // The result belongs to the panel once posted.
+        result->scaled = level->Scale(myTarget.GetWidth(), myTarget.GetHeight(),
+                                      wxIMAGE_QUALITY_HIGH);
+        wxCommandEvent scaled(wxEVT_PANEL_SCALED);
+        scaled.SetClientData(result);
+        scaled.SetExtraLong(myGeneration);
+        wxPostEvent(myHandler, scaled);
+        return 0;
+    }
+    
+private:
+    /** The receiver of the scaled event. */
+    wxEvtHandler *myHandler;
+    
+    /** The pyramid level to scale from. Owned by the panel. */
+    const wxImage *mySource;
+    
+    /** The pixel size of the scaled image. */
+    wxSize myTarget;
+    
+    /** Identifies this rescale's event among those of earlier rescales. */
+    long myGeneration;
+    
+    /** Set by cancel() to stop scaling. */
+    volatile bool myCancelled;
+};
+
 BEGIN_EVENT_TABLE(wxImagePanel, wxPanel)
 // some useful events
 /*
@@ -49,6 +146,9 @@ BEGIN_EVENT_TABLE(wxImagePanel, wxPanel)
 EVT_PAINT(wxImagePanel::paintEvent)
 //Size event
 EVT_SIZE(wxImagePanel::OnSize)
+//Debounced resize and finished rescale
+EVT_TIMER(ID_RESIZETIMER, wxImagePanel::OnResizeTimer)
+EVT_COMMAND(wxID_ANY, wxEVT_PANEL_SCALED, wxImagePanel::OnScaled)
 END_EVENT_TABLE()
  
  
@@ -69,39 +169,149 @@ END_EVENT_TABLE()
  * @param parent The frame owner of the panel.
  * @param img The image to be displayed.
  */
-wxImagePanel::wxImagePanel(wxWindow* parent, wxImage img) : wxPanel(parent) {
+wxImagePanel::wxImagePanel(wxWindow* parent, const wxImage& img)
+        : wxPanel(parent), myResizeTimer(this, ID_RESIZETIMER) {
+    myScaler = NULL;
+    myScaleGeneration = 0;
     setImage(img);
 }
 
+/** Stop any rescale in progress. */
+wxImagePanel::~wxImagePanel() {
+    myResizeTimer.Stop();
+    stopScaler();
+}
+
 /**
- * Change the image displayed in the panel.
+ * Change the image displayed in the panel. The panel shares the image's
+ * pixels rather than copying them, so the caller must not modify them.
  * @param newImage the new image to be displayed.
  */
-void wxImagePanel::setImage(wxImage newImage) {
-    myImage = newImage;
-    if (myImage.IsOk()) {
-        initializeImage();
-        Refresh();
+void wxImagePanel::setImage(const wxImage& newImage) {
+    if ( ! newImage.IsOk()) {
+        Tools::log(_T("Internal error: wxImagePanel::setImage()"));
+        return;
     }
-    else {
+    
+    // The scaler thread uses the pyramid, so stop it before replacing it.
+    stopScaler();
+    showImage(newImage);
+    myPixels = SharedImage();
+}
+
+/**
+ * Change the image displayed in the panel to one viewed without copying. The
+ * panel keeps the image, so its pixels stay valid while they are displayed.
+ * @param newImage the new image to be displayed.
+ */
+void wxImagePanel::setImage(const SharedImage& newImage) {
+    if ( ! newImage.isOk()) {
         Tools::log(_T("Internal error: wxImagePanel::setImage()"));
+        return;
     }
+    
+    stopScaler();
+    myPixels = newImage;
+    showImage(myPixels.wx());
+}
+
+/**
+ * Replace the displayed image and its pyramid, and rescale. The scaler thread
+ * must be stopped.
+ * @param newImage the new image to be displayed.
+ */
+void wxImagePanel::showImage(const wxImage& newImage) {
+    myImage = newImage;
+    myPyramid.clear();
+    myPyramid.push_back(myImage);
+    myBitsSize = wxSize(-1, -1);
+    rescale();
 }
 
 /**
- * Initialize the new image by remembering its width, height, and aspect ratio.
+ * Compute the pixel size that fits the image inside the panel, preserving
+ * aspect ratio. On high resolution displays this is larger than the panel's
+ * size in logical units.
+ * @return The fitted size, never smaller than 1x1.
  */
-void wxImagePanel::initializeImage() {
-    // Remember width and height to detect resizing.
-    myPreviousWidth = -1;
-    myPreviousHeight = -1;
+wxSize wxImagePanel::fitSize() {
+    wxSize panel = GetClientSize();
+    double pixelScale = 1.0;
+#if wxCHECK_VERSION(3, 0, 0)
+    pixelScale = GetContentScaleFactor();
+#endif
+    double scale = min(panel.GetWidth() * pixelScale / myImage.GetWidth(),
+                       panel.GetHeight() * pixelScale / myImage.GetHeight());
+    return wxSize(max(1, (wxInt32) (myImage.GetWidth() * scale)),
+                  max(1, (wxInt32) (myImage.GetHeight() * scale)));
+}
+
+/**
+ * Rebuild myImageBits at the current panel size. Use the smallest pyramid
+ * level that is at least as large as the target. If that level is small,
+ * scale it now. Otherwise start a scaler thread, keeping the old bitmap on
+ * screen until the new one arrives.
+ */
+void wxImagePanel::rescale() {
+    wxSize target = fitSize();
+    if (target == myBitsSize) {
+        return;
+    }
+    stopScaler();
+    
+    size_t level = 0;
+    while (level + 1 < myPyramid.size()
+            && myPyramid[level + 1].GetWidth() >= target.GetWidth()
+            && myPyramid[level + 1].GetHeight() >= target.GetHeight()) {
+        level++;
+    }
+    const wxImage& source = myPyramid[level];
+    myBitsSize = target;
     
-    // Remember aspect ratio of myImage to enable resizing.
-    if (myImage.GetHeight() != 0) {
-        myAspectRatio = myImage.GetWidth() / (double) myImage.GetHeight();
+    if ((double) source.GetWidth() * source.GetHeight()
+            <= (double) QUICKSCALEAREA * target.GetWidth() * target.GetHeight()) {
+        setBits(source.Scale(target.GetWidth(), target.GetHeight(),
+                             wxIMAGE_QUALITY_HIGH));
+        return;
     }
-    else {
-        myAspectRatio = 1.0;
+    
+    // Large image. Drop the levels too small for this target, then let the
+    // scaler make the next levels from the chosen one.
+    myPyramid.resize(level + 1);
+    myScaler = new PanelScaler(this, &myPyramid.back(), target, ++myScaleGeneration);
+    if (myScaler->Create() != wxTHREAD_NO_ERROR || myScaler->Run() != wxTHREAD_NO_ERROR) {
+        Tools::log(_T("Internal error: wxImagePanel::rescale()"));
+        delete myScaler;
+        myScaler = NULL;
+        setBits(source.Scale(target.GetWidth(), target.GetHeight()));
+    }
+}
+
+/**
+ * Make the bitmap drawn on the panel and redraw. On high resolution displays
+ * the bitmap is marked with the display's scale factor so that it is drawn
+ * pixel for pixel rather than enlarged.
+ * @param scaled The image scaled to fitSize().
+ */
+void wxImagePanel::setBits(const wxImage& scaled) {
+#if wxCHECK_VERSION(3, 1, 0)
+    myImageBits = wxBitmap(scaled, -1, GetContentScaleFactor());
+#else
+    myImageBits = wxBitmap(scaled);
+#endif
+    Refresh();
+}
+
+/** Cancel the scaler thread, if any, and wait for it to end. */
+void wxImagePanel::stopScaler() {
+    if (myScaler) {
+        myScaler->cancel();
+        myScaler->Wait();
+        delete myScaler;
+        myScaler = NULL;
+        
+        // Its result is lost, so the bitmap is stale.
+        myBitsSize = wxSize(-1, -1);
     }
 }
 
@@ -134,45 +344,47 @@ void wxImagePanel::paintNow() {
 /*
  * Here we do the actual rendering. I put it in a separate
  * method so that it can work no matter what type of DC
- * (e.g. wxPaintDC or wxClientDC) is used.
+ * (e.g. wxPaintDC or wxClientDC) is used. Only the cached bitmap
+ * is drawn; rescaling happens after resizing stops.
  */
 void wxImagePanel::render(wxDC& dc) {   
-    wxInt32 newWidth, newHeight;
-    dc.GetSize(&newWidth, &newHeight);
-    
-    if(newWidth != myPreviousWidth || newHeight != myPreviousHeight ) {
-        // Size change. Scale and draw the image to the new size, preserving 
-        // aspect ratio.
-        wxInt32 w, h;
-        if (myAspectRatio < 1.0) {
-            w = newHeight * myAspectRatio;
-            h = newHeight;
-        }
-        else {
-            w = newWidth;
-            h = newWidth / myAspectRatio;
-        }
-        myImageBits = wxBitmap(myImage.Scale(w, h));
-        
-        // Remember new width and height.
-        myPreviousWidth = newWidth;
-        myPreviousHeight = newHeight;
-        
-        // Draw.
-        dc.DrawBitmap(myImageBits, 0, 0, false);
-    }
-    else {
-        // No size change.  Refresh.
+    if (myImageBits.IsOk()) {
         dc.DrawBitmap(myImageBits, 0, 0, false);
     }
 }
  
 /*
- * Here we call refresh to tell the panel to draw itself again.
- * So when the user resizes the image panel the image should be resized too.
+ * The panel is being resized. Restart the resize timer so that the image is
+ * rescaled once, after the user stops dragging.
  */
 void wxImagePanel::OnSize(wxSizeEvent& event) {
+    myResizeTimer.Start(RESIZEDELAY, wxTIMER_ONE_SHOT);
     Refresh();
     event.Skip();
 }
- 
\ No newline at end of file
+
+/**
+ * Resizing has stopped. Rescale the image to the new size.
+ * @param event The timer event.
+ */
+void wxImagePanel::OnResizeTimer(wxTimerEvent& event) {
+    rescale();
+}
+
+/**
+ * The scaler thread has finished. Add its levels to the pyramid and show its
+ * image, unless a newer rescale has been requested since.
+ * @param event Carries the new levels, the scaled image and the rescale's
+ * generation.
+ */
+void wxImagePanel::OnScaled(wxCommandEvent& event) {
+    ScaledLevels *result = (ScaledLevels*) event.GetClientData();
+    if (event.GetExtraLong() == myScaleGeneration && myScaler) {
+        myScaler->Wait();
+        delete myScaler;
+        myScaler = NULL;
+        myPyramid.insert(myPyramid.end(), result->levels.begin(), result->levels.end());
+        setBits(result->scaled);
+    }
+    delete result;
+}
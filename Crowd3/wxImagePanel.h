@@ -34,36 +34,69 @@
 
 #include <wx/wx.h>
 #include <wx/sizer.h>
+#include <wx/thread.h>
+#include <vector>
+#include "SharedImage.h"
+
+/** Wait this many milliseconds after the last resize before rescaling. */
+const wxInt32 RESIZEDELAY = 200;
+
+/** Images up to this many times the panel area are rescaled immediately on
+ * the main thread. Larger images are rescaled on a worker thread. */
+const wxInt32 QUICKSCALEAREA = 4;
+
+class PanelScaler;
 
 /** A panel for image display.<p>
+ * The displayed bitmap is rescaled once after the panel stops resizing. Large
+ * images are rescaled on a worker thread from a pyramid of halved copies of
+ * the image, so resizing never stalls the user interface.<p>
  * Usage:<p><code>
  * wxImagePanel *ip = new wxImagePanel(wxFrame*, wxImage);<p>
  * </code>
  */
 class wxImagePanel : public wxPanel {
-    /** The image displayed in the panel. */
+    /** The image displayed in the panel. Shares its pixels with the caller's image. */
     wxImage myImage;
     
+    /** Keeps myImage's pixels alive when they belong to a SharedImage. */
+    SharedImage myPixels;
+    
+    /** myImage followed by copies of it, each half the size of the one
+     * before. Extended with the scaler thread's copies when it finishes. */
+    std::vector<wxImage> myPyramid;
+    
     /** The image's bitmap that is actually drawn on the panel. */
     wxBitmap myImageBits;
     
-    /** The image width after the previous resize event. */
-    wxInt32 myPreviousWidth;
+    /** The pixel size myImageBits was scaled to, or (-1, -1) if it is stale. */
+    wxSize myBitsSize;
+    
+    /** Fires once after the panel stops resizing. */
+    wxTimer myResizeTimer;
     
-    /** The image height after the previous resize event. */
-    wxInt32 myPreviousHeight;
+    /** The thread rescaling a large image, or NULL. */
+    PanelScaler *myScaler;
     
-    /** The image width divided by the image height. */
-    double myAspectRatio;
+    /** Identifies the most recently requested rescale. */
+    long myScaleGeneration;
     
-    void initializeImage();
+    wxSize fitSize();
+    void rescale();
+    void setBits(const wxImage& scaled);
+    void stopScaler();
+    void showImage(const wxImage& newImage);
     
 public:
-    wxImagePanel(wxWindow* parent, wxImage img);
-    void setImage(wxImage newImage);
+    wxImagePanel(wxWindow* parent, const wxImage& img);
+    virtual ~wxImagePanel();
+    void setImage(const wxImage& newImage);
+    void setImage(const SharedImage& newImage);
     void paintEvent(wxPaintEvent & evt);
     void paintNow();
     void OnSize(wxSizeEvent& event);
+    void OnResizeTimer(wxTimerEvent& event);
+    void OnScaled(wxCommandEvent& event);
     void render(wxDC& dc);
     
     // some useful events